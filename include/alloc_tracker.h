@@ -0,0 +1,54 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <cstddef>
+
+// Subsystems heap allocations are attributed to, see AllocScope.
+enum AllocTag {
+    ALLOC_GENERAL,
+    ALLOC_INPUT,
+    ALLOC_UPDATE,
+    ALLOC_COLLISION,
+    ALLOC_PARTICLES,
+    ALLOC_POWERUPS,
+    ALLOC_LEVEL,
+    ALLOC_RENDER,
+    ALLOC_TAG_COUNT
+};
+
+struct AllocStats {
+    unsigned int       Count[ALLOC_TAG_COUNT];
+    unsigned long long Bytes[ALLOC_TAG_COUNT];
+
+    unsigned int       TotalCount() const;
+    unsigned long long TotalBytes() const;
+};
+
+// A static allocation counter fed by the global operator new replacements in
+// alloc_tracker.cpp. Counts are collected per frame and per subsystem; once the
+// game is in steady state every frame is expected to allocate nothing. Building
+// with ALLOC_TRACKING_ASSERT aborts on the first frame that does.
+class AllocTracker {
+public:
+    static void              EndFrame();
+    static const AllocStats &LastFrame();
+    static void              SetSteadyState(bool steady);
+    static unsigned int      SteadyStateViolations();
+    static const char       *TagName(AllocTag tag);
+    static AllocTag          CurrentTag();
+    static void              SetCurrentTag(AllocTag tag);
+    static void              Record(std::size_t size);
+private:
+    AllocTracker() { }
+};
+
+// Attributes all allocations made during its lifetime (on this thread) to a subsystem.
+class AllocScope {
+public:
+    explicit AllocScope(AllocTag tag) : previous(AllocTracker::CurrentTag()) { AllocTracker::SetCurrentTag(tag); }
+    ~AllocScope() { AllocTracker::SetCurrentTag(this->previous); }
+private:
+    AllocTag previous;
+};
+
+#endif
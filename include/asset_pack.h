@@ -0,0 +1,71 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// On-disk layout of a pack, written by tools/pack_assets.cpp. A header, the
+// index sorted by name, then every asset 16-byte aligned and followed by a 0
+// byte, so text assets can be handed to C string APIs without a copy.
+const char         ASSET_PACK_MAGIC[4] = { 'P', 'P', 'A', 'K' };
+const unsigned int ASSET_PACK_VERSION  = 1;
+const unsigned int ASSET_NAME_SIZE     = 56; // including the terminating 0
+const unsigned int ASSET_ALIGNMENT     = 16;
+
+struct AssetPackHeader {
+    char         Magic[4];
+    unsigned int Version;
+    unsigned int Count;
+    unsigned int Reserved;
+};
+
+struct AssetEntry {
+    char               Name[ASSET_NAME_SIZE]; // path relative to the project root, '/' separated
+    unsigned long long Offset, Size;          // from the start of the pack, Size without the 0 byte
+    unsigned long long Hash;                  // HashAsset of the contents
+};
+
+// 64-bit FNV-1a
+unsigned long long HashAsset(const void *data, size_t size);
+
+// Bytes of one asset. Owned by the pack, valid until AssetPack::Close.
+struct AssetSpan {
+    const unsigned char *Data;
+    size_t               Size;
+};
+
+// A static singleton around one read-only mapping of the asset pack. Lookups
+// binary search the index and return spans into the mapping.
+class AssetPack {
+public:
+    // maps the pack; false when it is missing or malformed, assets then come from loose files
+    static bool Open(const char *file);
+    static void Close();
+    static bool IsOpen();
+    // loose files are looked up under this directory, "../" by default
+    static void        SetRoot(const std::string &root);
+    static std::string Root();
+    static bool Find(const char *name, AssetSpan &span);
+    // rehashes every asset, slow, for packs of unknown origin
+    static bool Verify();
+private:
+    AssetPack() { }
+};
+
+// One asset for a loader: a span into the pack when it has the asset, otherwise
+// the loose file read from disk, 0 terminated as well.
+class AssetData {
+public:
+    AssetData(const char *name);
+    bool                 Valid() const { return this->data != nullptr; }
+    const unsigned char *Data() const { return this->data; }
+    size_t               Size() const { return this->size; }
+    // "" when the asset could not be loaded
+    const char          *Text() const { return this->data ? (const char*)this->data : ""; }
+private:
+    const unsigned char       *data;
+    size_t                     size;
+    std::vector<unsigned char> loose;
+};
+
+#endif
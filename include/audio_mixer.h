@@ -0,0 +1,134 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "memory_tracker.h"
+
+const unsigned int AUDIO_RATE       = 48000; // frames a second, every sound is at this rate
+const unsigned int AUDIO_BLOCK      = 256;   // frames mixed at a time, about 5 ms
+const unsigned int AUDIO_MAX_VOICES = 32;    // playing at once, more take over the least important
+const unsigned int AUDIO_MAX_SOUNDS = 64;
+const unsigned int AUDIO_QUEUE_SIZE = 256;   // commands in flight, a power of two
+
+typedef unsigned int SoundId;
+typedef unsigned int VoiceId; // one playing of a sound, for Stop
+const SoundId NO_SOUND = 0xFFFFFFFF;
+const VoiceId NO_VOICE = 0;
+
+// Receives every mixed block as interleaved stereo 16-bit frames. A sink for
+// a sound device blocks until the device takes the block, which paces the
+// mixer; see AudioMixer::SetSink.
+typedef void (*AudioSink)(void *context, const short *frames, unsigned int count);
+
+// A cue synthesized at load time, the game ships no sound files.
+struct ToneDesc {
+    float Seconds;
+    float StartHz, EndHz; // swept linearly over the tone
+    float Decay;          // of the volume, per second
+    float Square;         // 0 for a sine, 1 for a square wave
+    float Gain;
+
+    ToneDesc() : Seconds(0.1f), StartHz(440.0f), EndHz(440.0f), Decay(0.0f), Square(0.0f), Gain(0.5f) { }
+};
+
+struct AudioStats {
+    unsigned long long Blocks;
+    unsigned int       Voices, PeakVoices;
+    unsigned int       Stolen;   // voices cut off for a more important one
+    unsigned int       Rejected; // plays that lost out to the voices playing
+    unsigned int       Dropped;  // commands that found the queue full
+    unsigned int       Late;     // blocks mixed after they were due
+};
+
+// A software mixer on a thread of its own. Sounds are mono PCM loaded before
+// Start and kept whole in memory; voices play them with a gain and a pan into
+// a fixed stereo block, with SSE or NEON where the target has it, which goes
+// to the sink as 16-bit frames. The game thread is the single producer of a
+// lock-free command queue the mixer drains before every block, so Play and
+// Stop never wait and a full queue drops the command. With every voice busy
+// a play takes over the voice of lowest priority, the one closest to its end
+// among equals, if that is no higher than its own. The mixer thread never
+// allocates and never locks. Without a sound device the blocks go into a WAV
+// file or nowhere, paced by the clock as a device would.
+class AudioMixer
+{
+public:
+    AudioMixer();
+    // stops the thread and finishes the file
+    ~AudioMixer();
+    // samples at AUDIO_RATE, copied; NO_SOUND once started or full
+    SoundId    Load(const float *samples, unsigned int count);
+    SoundId    LoadTone(const ToneDesc &tone);
+    // pick one sink before Start
+    bool       OpenFile(const char *path);
+    void       OpenNull();
+    void       SetSink(AudioSink sink, void *context);
+    void       Start();
+    // pan from -1, left, to 1, right; NO_VOICE if the command was dropped
+    VoiceId    Play(SoundId sound, float gain, float pan, unsigned int priority);
+    void       Stop(VoiceId voice);
+    void       StopAll();
+    AudioStats Stats() const;
+private:
+    enum CommandType {
+        COMMAND_PLAY,
+        COMMAND_STOP,
+        COMMAND_STOP_ALL
+    };
+    struct Command {
+        CommandType  Type;
+        VoiceId      Voice;
+        SoundId      Sound;
+        float        Left, Right;
+        unsigned int Priority;
+    };
+    struct Sound {
+        unsigned int Offset, Count; // in the bank
+    };
+    struct Voice {
+        VoiceId      Id;
+        const float *Samples;
+        unsigned int Count, Position;
+        float        Left, Right;
+        unsigned int Priority;
+    };
+
+    // everything loaded back to back, never resized once started
+    std::vector<float>        bank;
+    std::vector<Sound>        sounds;
+    MemoryToken               memory;
+    AudioSink                 sink;
+    void                     *sinkContext;
+    bool                      paced; // by the clock, a device sink paces itself
+    FILE                     *file;
+    std::vector<char>         fileBuffer; // stdio's, so writing never allocates
+    unsigned long long        fileFrames;
+    std::thread               thread;
+    std::atomic<bool>         quit;
+    // game thread to mixer, free running and wrapped on access
+    Command                   commands[AUDIO_QUEUE_SIZE];
+    std::atomic<unsigned int> head, tail;
+    VoiceId                   nextVoice;
+    unsigned int              dropped;
+    // the mixer thread's own
+    Voice                     voices[AUDIO_MAX_VOICES];
+    unsigned int              voiceCount;
+    alignas(16) float         mix[AUDIO_BLOCK * 2];
+    alignas(16) short         frames[AUDIO_BLOCK * 2];
+    std::atomic<unsigned long long> blocks;
+    std::atomic<unsigned int> playing, peakVoices, stolen, rejected, late;
+
+    bool push(const Command &command);
+    void run();
+    void execute(const Command &command);
+    void start(const Command &command);
+    void mixBlock();
+    static void writeFile(void *mixer, const short *frames, unsigned int count);
+    static void discard(void *mixer, const short *frames, unsigned int count);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+#include <tuple>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+enum Direction {
+    UP,
+    RIGHT,
+    DOWN,
+    LEFT
+};
+
+typedef std::tuple<bool, Direction, glm::vec2> Collision;
+
+// boxes tested per step by the batched kernel, picked at compile time
+#if defined(__AVX2__)
+const unsigned int COLLISION_LANES = 8;
+#elif defined(__SSE2__) || defined(_M_X64) || defined(__ARM_NEON)
+const unsigned int COLLISION_LANES = 4;
+#else
+const unsigned int COLLISION_LANES = 1;
+#endif
+// storage is always padded for the widest kernel
+const unsigned int COLLISION_PADDING = 8;
+
+// Axis aligned boxes packed as separate min/max arrays. Disabled boxes and the
+// padding past Count are parked far outside the world so nothing can hit them.
+struct BoxBounds {
+    std::vector<float> MinX, MinY, MaxX, MaxY;
+    unsigned int       Count;
+
+    BoxBounds() : Count(0) { }
+    void Clear();
+    unsigned int Add(glm::vec2 position, glm::vec2 size);
+    void Set(unsigned int index, glm::vec2 position, glm::vec2 size);
+    void Disable(unsigned int index);
+    // heap reserved by the columns
+    size_t Bytes() const;
+};
+
+// circle vs single AABB using squared distances, the direction comes from sign comparisons
+Collision    CollideCircleAABB(glm::vec2 center, float radius, glm::vec2 min, glm::vec2 max);
+Direction    SignDirection(glm::vec2 target);
+// Earliest fraction of motion in [0, 1] at which a moving circle touches the box,
+// with the box's outward normal there. A circle already overlapping the box
+// hits at 0 unless it is moving out; false if there is no contact on the way.
+bool         SweepCircleAABB(glm::vec2 center, float radius, glm::vec2 motion, glm::vec2 min, glm::vec2 max, float &time, glm::vec2 &normal);
+// writes the (ascending) indices of the boxes from first on overlapping the circle, returns how
+// many were written; when that is maxHits, call again from one past the last to get the rest
+unsigned int CollideCircleBoxes(const BoxBounds &bounds, glm::vec2 center, float radius, unsigned int *hits, unsigned int maxHits, unsigned int first = 0);
+// one box at a time, reference for the batched kernel
+unsigned int CollideCircleBoxesScalar(const BoxBounds &bounds, glm::vec2 center, float radius, unsigned int *hits, unsigned int maxHits, unsigned int first = 0);
+
+// boxes handed to SweepCircleBoxes' exact test per call of the kernel
+const unsigned int SWEEP_BATCH = 64;
+// false for a box the sweep passes through
+typedef bool (*BoxFilter)(void *context, unsigned int box);
+// The earliest box a circle moving by motion touches before time, of those the
+// filter lets through (nullptr for all), ties to the lower index. Every box the
+// swept circle overlaps is tested, however many there are. Returns the box, or
+// NO_BOX and leaves time and normal alone.
+const unsigned int NO_BOX = 0xFFFFFFFF;
+unsigned int SweepCircleBoxes(const BoxBounds &bounds, glm::vec2 center, float radius, glm::vec2 motion, BoxFilter filter, void *context,
+                              float &time, glm::vec2 &normal);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef ECS_H
+#define ECS_H
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "texture2D.h"
+#include "sprite_renderer.h"
+#include "collision.h"
+#include "power_up.h"
+
+// components, kept small so a system only streams what it reads
+
+struct Transform {
+    glm::vec2 Position, Size;
+    float     Rotation;
+};
+
+struct Motion {
+    glm::vec2 Velocity;
+};
+
+struct Sprite {
+    const Texture2D *Texture; // owned by the ResourceManager
+    glm::vec3        Color;
+};
+
+struct BrickState {
+    bool Solid;
+    bool Destroyed;
+};
+
+struct BallState {
+    float Radius;
+    bool  Stuck;
+    bool  Sticky, PassThrough;
+};
+
+// Archetype tables. Every component lives in its own dense array and row i of
+// each array belongs to the same entity, so an entity is just its row.
+
+struct BrickTable {
+    std::vector<Transform>  Transforms;
+    std::vector<Sprite>     Sprites;
+    std::vector<BrickState> States;
+    BoxBounds               Bounds; // packed copy of the live bricks for the collision kernel
+
+    unsigned int Size() const { return this->States.size(); }
+    unsigned int Add(glm::vec2 position, glm::vec2 size, const Texture2D &texture, glm::vec3 color, bool solid);
+    void         Clear();
+    // heap reserved by the columns
+    size_t       Bytes() const;
+};
+
+struct BallTable {
+    std::vector<Transform> Transforms;
+    std::vector<Motion>    Motions;
+    std::vector<Sprite>    Sprites;
+    std::vector<BallState> States;
+
+    unsigned int Size() const { return this->States.size(); }
+    unsigned int Add(glm::vec2 position, float radius, glm::vec2 velocity, const Texture2D &texture);
+    void         Reset(unsigned int ball, glm::vec2 position, glm::vec2 velocity);
+    // swaps the last ball into the hole
+    void         Remove(unsigned int ball);
+    void         Reserve(unsigned int count);
+    void         Clear();
+    size_t       Bytes() const;
+};
+
+// power-ups come and go every few seconds, removal swaps the last row into the hole
+struct PowerUpTable {
+    std::vector<Transform>   Transforms;
+    std::vector<Motion>      Motions;
+    std::vector<Sprite>      Sprites;
+    std::vector<PowerUpType> Types;
+
+    unsigned int Size() const { return this->Types.size(); }
+    unsigned int Add(PowerUpType type, glm::vec2 position, const Texture2D &texture);
+    void         Remove(unsigned int powerUp);
+    void         Reserve(unsigned int count);
+    void         Clear();
+    size_t       Bytes() const;
+};
+
+// systems
+
+void MoveBodies(std::vector<Transform> &transforms, const std::vector<Motion> &motions, float dt);
+void DrawSprites(SpriteRenderer &renderer, const std::vector<Transform> &transforms, const std::vector<Sprite> &sprites);
+// AABB - AABB overlap, touching edges count
+bool Overlaps(const Transform &one, const Transform &two);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game.h"
+#include "input_queue.h"
+#include "memory_tracker.h"
+#include "perf_hud.h"
+
+const unsigned int FLIGHT_FRAMES    = 512;  // frames kept, a power of two
+const unsigned int FLIGHT_EVENTS    = 4096; // input events kept, a power of two
+const unsigned int FLIGHT_KEYFRAME  = 128;  // frames between game snapshots
+const unsigned int FLIGHT_KEYFRAMES = FLIGHT_FRAMES / FLIGHT_KEYFRAME;
+const unsigned int FLIGHT_AFTER     = 60;   // frames kept after a hitch before it is dumped
+
+// What the recorder keeps per frame.
+struct FrameRecord {
+    unsigned int Frame;
+    // what a replay feeds back in
+    double       InputTime;  // handed to ProcessInput, negative if it was not called
+    double       LatchTime;  // late latch in Render, negative without
+    float        Step;       // handed to Update
+    unsigned int FirstEvent; // input events consumed during the frame, oldest first
+    unsigned int EventCount;
+    // what it cost
+    PerfSample   Perf;
+    // the game once the frame was done, a replay compares StateHash
+    unsigned int Level, Balls, PowerUps;
+    float        PaddleX;
+    unsigned int Random;
+    unsigned int StateHash;
+};
+
+// A hitch and the frames around it, as written to disk and read back by Load.
+struct FlightDump {
+    unsigned int             HitchFrame;
+    float                    Budget;
+    GameSnapshot             Start;  // the game before the first frame
+    std::vector<FrameRecord> Frames;
+    std::vector<InputEvent>  Events; // FrameRecord::FirstEvent indexes these
+};
+
+// A flight recorder for frames that run over budget. The game thread writes
+// every frame into a fixed ring, without locks or allocations, and saves a
+// snapshot of the game every FLIGHT_KEYFRAME frames. FLIGHT_AFTER frames after
+// a hitch the window from the oldest snapshot on is copied out and a thread of
+// its own writes it to disk; while that runs, further hitches are only counted.
+// A dump replays through the game's input path from its snapshot, see Load.
+class FlightRecorder
+{
+public:
+    float        Budget;  // milliseconds
+    unsigned int Dumps;   // written so far
+    unsigned int Missed;  // hitches not dumped, a dump was in flight
+
+    FlightRecorder(const Game &game, const std::string &directory, float budget);
+    ~FlightRecorder();
+    // the frame in progress, the game fills in what it handed out
+    FrameRecord  &Current() { return this->frames[this->frame % FLIGHT_FRAMES]; }
+    void          RecordEvent(const InputEvent &event);
+    // closes the current frame; perf has the frame time the budget is checked against
+    void          EndFrame(const PerfSample &perf);
+    // the snapshot to save the game into before the frame in progress runs, null
+    // if this frame takes none
+    GameSnapshot *Keyframe();
+    static bool   Load(const char *file, FlightDump &dump);
+private:
+    std::string             directory;
+    FrameRecord             frames[FLIGHT_FRAMES];
+    InputEvent              events[FLIGHT_EVENTS];
+    unsigned int            frame;     // in progress
+    unsigned int            eventHead; // free running, wrapped on access
+    GameSnapshot            keyframes[FLIGHT_KEYFRAMES];
+    unsigned int            keyframeFrames[FLIGHT_KEYFRAMES];
+    unsigned int            hitch, dumpFrame; // pending hitch and the frame it is dumped after
+    bool                    hitchPending;
+    // handed to the writer
+    FlightDump              dump;
+    std::thread             writer;
+    std::mutex              mutex;
+    std::condition_variable wake;
+    std::atomic<bool>       writing;
+    bool                    quit;
+    MemoryToken             memory;
+
+    void beginFrame();
+    bool copyWindow();
+    void run();
+    bool write(const char *file) const;
+};
+
+#endif
@@ -1,11 +1,23 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "game_level.h"
 #include "power_up.h"
+#include "collision.h"
+#include "ecs.h"
+#include "timer_wheel.h"
+#include "input_queue.h"
+#include "post_processor.h"
+#include "stream_buffer.h"
+#include "memory_tracker.h"
+#include "random.h"
 
 enum GameState {
     GAME_ACTIVE,
@@ -13,41 +25,190 @@ enum GameState {
     GAME_WIN
 };
 
-enum Direction {
-    UP,
-    RIGHT,
-    DOWN,
-    LEFT
-};
-
-typedef std::tuple<bool, Direction, glm::vec2> Collision;
-
 const glm::vec2 PLAYER_SIZE(100.0f, 20.0f);
 const float PLAYER_VELOCITY(500.0f);
 
 const glm::vec2 INITIAL_BALL_VELOCITY(100.0f, -350.0f);
 const float BALL_RADIUS = 12.5f;
+const unsigned int MAX_BALLS = 1024;
+// balls split off each existing ball by the multi-ball power-up, and the angle between them
+const unsigned int MULTIBALL_SPLIT = 2;
+const float MULTIBALL_ANGLE = 0.35f; // radians
+// below this many balls the step runs on the calling thread
+const unsigned int PARALLEL_BALLS = 64;
+const unsigned int BALL_GRAIN = 32;
+// balls that cast a shadow on the background, any beyond that are left out
+const unsigned int MAX_SHADOW_BALLS = 16;
+
+const unsigned int MAX_PARTICLES = 2048;
+const unsigned int MAX_POWERUPS = 512;
+// impacts resolved per ball per step; a ball out of impacts waits for the next
+// step instead of moving unchecked
+const unsigned int MAX_BALL_IMPACTS = 8;
+const float SWEEP_SKIN = 0.01f; // pixels kept between a ball and what it bounced off
+const unsigned int MAX_TIMERS = 1024;
+
+const float SHAKE_TIME = 0.05f;
+const double LATENCY_REPORT_INTERVAL = 2.0; // seconds
+const float DEFAULT_GPU_BUDGET = 12.0f; // milliseconds, leaves room for the swap at 60 Hz
+const unsigned int STREAM_BUFFER_SIZE = 1 << 20; // bytes of per-frame vertex data in flight
+const float DEFAULT_HITCH_BUDGET = 50.0f; // milliseconds, longer frames are dumped by the flight recorder
+const float DEFAULT_REWIND_SECONDS = 10.0f; // of play kept for rewinding
+
+// a pending game timer by what it does, so it survives a trip through a file
+enum GameTimerKind {
+    TIMER_POWERUP_EXPIRED,
+    TIMER_SHAKE_EXPIRED
+};
+
+struct GameTimer {
+    unsigned long long Expires; // tick of the game's timer wheel
+    unsigned int       Kind;
+    unsigned int       Data;
+};
+
+// Everything gameplay depends on: a game restored from it plays on exactly
+// like the original given the same steps and input. Particles and render
+// state are left out. Saving into the same snapshot again reuses its memory.
+struct GameSnapshot {
+    GameState                  State;
+    unsigned int               Level;
+    unsigned int               StressBalls;
+    bool                       Keys[1024];
+    double                     InputTime;
+    unsigned int               Random;
+    Transform                  Paddle;
+    glm::vec3                  PaddleColor;
+    BallTable                  Balls;
+    PowerUpTable               PowerUps;
+    unsigned int               ActiveEffects[POWERUP_TYPE_COUNT];
+    bool                       Shake, Confuse, Chaos;
+    double                     TimerElapsed;
+    unsigned long long         TimerTick;
+    std::vector<GameTimer>     Timers;
+    std::vector<unsigned char> Destroyed; // per brick, the levels one after another
+};
 
 class Game
 {
 public:
     GameState               State;	
-    bool                    Keys[1024];
+    bool                    Keys[1024]; // updated from Input as events are consumed
+    InputQueue              Input;
     unsigned int            Width, Height;
     std::vector<GameLevel>  Levels;
     unsigned int            Level;
-    std::vector<PowerUp>    PowerUps;
+    Transform               Paddle;
+    Sprite                  PaddleSprite;
+    BallTable               Balls;
+    PowerUpTable            PowerUps;
+    unsigned int            ActiveEffects[POWERUP_TYPE_COUNT]; // active timed power-ups per type
+    TimerWheel              Timers; // expiry of every timed effect
+    unsigned int            StressBalls; // extra balls launched with every new serve
+    bool                    LateLatch; // sample input again right before the paddle is drawn
+    bool                    MeasureLatency; // report input-to-present latency every few seconds
+    float                   GPUBudget; // milliseconds of GPU time per frame, 0 keeps full resolution
+    AntiAliasing            AAMode; // picked before Init, SetAntiAliasing afterwards
+    bool                    ShowPerfHud;
+    Random                  Rng; // gameplay only, particles draw from rand()
+    float                   HitchBudget; // milliseconds a frame may take before the flight recorder dumps, 0 turns it off
+    std::string             HitchDirectory; // where the dumps go
+    float                   RewindSeconds; // history kept for rewinding while Backspace is held, 0 turns it off
+    // the state is published after every update to this POSIX shared memory and
+    // Unix datagram socket for other processes, see StateStream; empty for neither
+    std::string             StreamName, StreamSocket;
+    // where the mixed audio goes: "null" for nowhere, otherwise a WAV file; empty for no audio
+    std::string             AudioOutput;
     Game(unsigned int width, unsigned int height);
     ~Game();
     void Init();
-    void ProcessInput(float dt);
+    // releases GL resources, must run while the context is still current
+    void Clear();
+    // consumes input events up to time (glfwGetTime clock)
+    void ProcessInput(double time);
     void Update(float dt);
     void Render();
+    // call once the frame is swapped, only does work with MeasureLatency
+    void Present();
+    // call last in every frame, after AllocTracker and GLBackend closed theirs;
+    // feeds the performance HUD and the flight recorder
+    void EndFrame();
+    // consumes input up to time without acting on keys, what late latching does in Render
+    void LatchInput(double time);
+    // sizes a snapshot for the largest game, so Save never allocates
+    void ReserveSnapshot(GameSnapshot &snapshot) const;
+    void Save(GameSnapshot &snapshot) const;
+    // the levels must be loaded, Init does that
+    void Restore(const GameSnapshot &snapshot);
+    // of the state Save keeps for the current level, to compare two runs frame by frame
+    unsigned int StateHash() const;
+    // window framebuffer size, the world keeps its size and is letterboxed into it;
+    // applied when the next frame starts rendering
+    void Resize(unsigned int width, unsigned int height);
+    // starts the scene over at full resolution
+    void SetAntiAliasing(AntiAliasing mode);
+    // GPUBudget once the game runs, 0 stays at full resolution
+    void SetGPUBudget(float milliseconds);
+    // smoothed GPU milliseconds of the last frames and bytes held by the scene targets
+    float  GPUTime() const;
+    size_t TargetBytes() const;
+    // how often the per-frame vertex ring had to wait for the GPU
+    const StreamStats &StreamBufferStats() const;
+    // applies what the balls hit during the step: bricks, shake, sparks and power-up pickups
     void DoCollisions();
     void ResetLevel();
     void ResetPlayer();
-    void SpawnPowerUps(GameObject &block);
+    // launches a free ball carrying the active ball effects, false once MAX_BALLS are in play
+    bool SpawnBall(glm::vec2 position, glm::vec2 velocity);
+    void SpawnPowerUps(glm::vec2 position);
     void UpdatePowerUps(float dt);
+private:
+    // what one ball touched during a step, resolved in ball order by DoCollisions
+    struct BallContacts {
+        unsigned int Count;
+        unsigned int Bricks[MAX_BALL_IMPACTS];
+        bool         Paddle;
+
+        bool Has(unsigned int brick) const { return std::find(this->Bricks, this->Bricks + this->Count, brick) != this->Bricks + this->Count; }
+    };
+    std::vector<BallContacts> contacts;
+    // what canHit needs to know about the ball being swept
+    struct BrickSweep {
+        const BrickTable   *Bricks;
+        const BallContacts *Contact;
+    };
+    float                     stepTime;
+    double                    inputTime; // the paddle has been integrated up to here
+    // oldest paddle key event not yet drawn, and the one in the frame being presented
+    double                    undrawnInput, drawnInput;
+    double                    latencySum, latencyMin, latencyMax, latencyReport;
+    unsigned int              latencyCount;
+
+    void initEmitters();
+    void initSounds();
+    void advanceInput(double time);
+    // the state after an update into the rewind history and out on the state stream
+    void publishState();
+    // steps back one state of the rewind history, input stays live
+    void rewind();
+    void updateShadows();
+    void movePaddle(double dt);
+    void stepBalls(unsigned int begin, unsigned int end);
+    void sweepBall(unsigned int ball, const BrickTable &bricks);
+    static void onStepBalls(void *game, unsigned int begin, unsigned int end);
+    static bool canHit(void *sweep, unsigned int brick);
+    void spawnPowerUp(PowerUpType type, glm::vec2 position);
+    // a cue panned to where it happened, if there is audio
+    void playSound(unsigned int sound, float x, unsigned int priority);
+    TimerId shakeTimer;
+    MemoryToken entityMemory; // the entity tables, sized once in Init
+    GameSnapshot tickState; // what goes in and out of the rewind history and the state stream
+    MemoryToken tickMemory;
+
+    void activatePowerUp(PowerUpType type);
+    void deactivatePowerUp(PowerUpType type);
+    static void onPowerUpExpired(void *game, unsigned int type);
+    static void onShakeExpired(void *game, unsigned int data);
 };
 
 #endif
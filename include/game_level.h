@@ -5,21 +5,48 @@
 #include <glad/glad.h>
 #include "glm/glm.hpp"
 
-#include "game_object.h"
+#include "ecs.h"
+#include "memory_tracker.h"
 #include "sprite_renderer.h"
 #include "resource_manager.h"
 
+// distinct brick textures a level can use, keep in sync with shaders/brick.fs
+const unsigned int BRICK_TEXTURES = 4;
 
+// What the GPU keeps per brick from load to unload.
+struct BrickInstance {
+    glm::vec2    Position, Size;
+    unsigned int Color; // RGBA8, see PackColor
+    unsigned int Layer; // index into the level's textures
+};
+
+
+// The bricks are uploaded once when the level loads and stay on the GPU. A
+// destroyed brick only clears its byte in a visibility buffer, the changed
+// bytes go up with the next Draw, which draws the whole wall in one call.
 class GameLevel
 {
 public:
-    std::vector<GameObject> Bricks;
-    GameLevel() { }
+    BrickTable Bricks;
+    GameLevel();
     void Load(const char *file, unsigned int levelWidth, unsigned int levelHeight);
-    void Draw(SpriteRenderer &renderer);
+    // restores every brick, no file access
+    void Reset();
+    void Destroy(unsigned int brick);
+    void Draw(Shader &shader);
     bool IsCompleted();
+    // breakable bricks still standing
+    unsigned int BricksLeft() const;
 private:
+    VertexArrayHandle          VAO;
+    BufferHandle               instanceVBO, visibleVBO;
+    std::vector<unsigned char> visible; // CPU copy of the visibility buffer
+    unsigned int               dirtyBegin, dirtyEnd; // bytes not uploaded yet
+    const Texture2D           *textures[BRICK_TEXTURES];
+    unsigned int               textureCount;
+    MemoryToken                memory; // the brick table and visibility copy
     void init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight);
+    void upload();
 };
 
 #endif
@@ -0,0 +1,56 @@
+#ifndef GL_BACKEND_H
+#define GL_BACKEND_H
+
+#include <glad/glad.h>
+
+// Kinds of GL object names the recording backend keeps track of.
+enum GLObjectKind {
+    GLOBJECT_BUFFER,
+    GLOBJECT_TEXTURE,
+    GLOBJECT_VERTEX_ARRAY,
+    GLOBJECT_FRAMEBUFFER,
+    GLOBJECT_RENDERBUFFER,
+    GLOBJECT_QUERY,
+    GLOBJECT_SHADER,
+    GLOBJECT_PROGRAM,
+    GLOBJECT_SYNC,
+    GLOBJECT_KIND_COUNT
+};
+
+struct GLStats {
+    unsigned int       DrawCalls;
+    unsigned int       Instances;      // summed over instanced draws
+    unsigned int       Binds;          // programs, vertex arrays, buffers, textures, framebuffers
+    unsigned int       RedundantBinds; // binds of what was bound already
+    unsigned int       UniformUploads;
+    unsigned long long BytesUploaded;  // buffer and texture data handed to GL
+};
+
+// Every GL call goes through GLAD's table of function pointers, so that table
+// is the dispatch layer and a backend is whatever fills it. The GLAD backend
+// loads the driver. The recording backend needs no context or GPU: it hands
+// out object names, keeps buffer contents so maps work, counts the calls per
+// frame and reports misuse, like binding a deleted name or drawing without a
+// vertex array, while nothing is drawn. On the driver, CountCalls puts
+// counters in front of the draw, bind and uniform entry points instead.
+class GLBackend {
+public:
+    // the real driver, needs a current context
+    static bool           UseGLAD(GLADloadproc loader);
+    static void           UseRecording();
+    static bool           Recording();
+    // counts draws, binds and uniform uploads on the driver too, at the cost of
+    // one more call each; the recorder always counts
+    static void           CountCalls(bool count);
+    static void           EndFrame();
+    // redundant binds and uploaded bytes only come from the recorder
+    static const GLStats &LastFrame();
+    // only kept by the recording backend
+    static unsigned int   LiveObjects(GLObjectKind kind);
+    static unsigned int   Errors();
+    static const char    *KindName(GLObjectKind kind);
+private:
+    GLBackend() { }
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef GL_HANDLE_H
+#define GL_HANDLE_H
+
+#include <glad/glad.h>
+
+#include "memory_tracker.h"
+
+// How each kind of GL object name is created and deleted. Names that can hold
+// storage leave the MemoryTracker with it.
+struct TextureTraits {
+    static unsigned int Create() { unsigned int id; glGenTextures(1, &id); return id; }
+    static void Destroy(unsigned int id) { MemoryTracker::Release(GLOBJECT_TEXTURE, id); glDeleteTextures(1, &id); }
+};
+struct BufferTraits {
+    static unsigned int Create() { unsigned int id; glGenBuffers(1, &id); return id; }
+    static void Destroy(unsigned int id) { MemoryTracker::Release(GLOBJECT_BUFFER, id); glDeleteBuffers(1, &id); }
+};
+struct VertexArrayTraits {
+    static unsigned int Create() { unsigned int id; glGenVertexArrays(1, &id); return id; }
+    static void Destroy(unsigned int id) { glDeleteVertexArrays(1, &id); }
+};
+struct FramebufferTraits {
+    static unsigned int Create() { unsigned int id; glGenFramebuffers(1, &id); return id; }
+    static void Destroy(unsigned int id) { glDeleteFramebuffers(1, &id); }
+};
+struct RenderbufferTraits {
+    static unsigned int Create() { unsigned int id; glGenRenderbuffers(1, &id); return id; }
+    static void Destroy(unsigned int id) { MemoryTracker::Release(GLOBJECT_RENDERBUFFER, id); glDeleteRenderbuffers(1, &id); }
+};
+struct QueryTraits {
+    static unsigned int Create() { unsigned int id; glGenQueries(1, &id); return id; }
+    static void Destroy(unsigned int id) { glDeleteQueries(1, &id); }
+};
+struct ProgramTraits {
+    static unsigned int Create() { return glCreateProgram(); }
+    static void Destroy(unsigned int id) { glDeleteProgram(id); }
+};
+
+// Move-only owner of a single GL object name, the object is deleted with the
+// handle. Converts to the raw name so it can be passed straight to GL calls.
+template <typename Traits>
+class GLHandle
+{
+public:
+    GLHandle() : id(0) { }
+    explicit GLHandle(unsigned int id) : id(id) { }
+    GLHandle(GLHandle &&other) noexcept : id(other.id) { other.id = 0; }
+    GLHandle &operator=(GLHandle &&other) noexcept {
+        if (this != &other) {
+            this->Reset();
+            this->id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    }
+    GLHandle(const GLHandle &) = delete;
+    GLHandle &operator=(const GLHandle &) = delete;
+    ~GLHandle() { this->Reset(); }
+
+    static GLHandle Create() { return GLHandle(Traits::Create()); }
+
+    void Reset() {
+        if (this->id != 0) {
+            Traits::Destroy(this->id);
+            this->id = 0;
+        }
+    }
+    operator unsigned int() const { return this->id; }
+
+private:
+    unsigned int id;
+};
+
+typedef GLHandle<TextureTraits>      TextureHandle;
+typedef GLHandle<BufferTraits>       BufferHandle;
+typedef GLHandle<VertexArrayTraits>  VertexArrayHandle;
+typedef GLHandle<FramebufferTraits>  FramebufferHandle;
+typedef GLHandle<RenderbufferTraits> RenderbufferHandle;
+typedef GLHandle<QueryTraits>        QueryHandle;
+typedef GLHandle<ProgramTraits>      ProgramHandle;
+
+#endif // GL_HANDLE_H
@@ -0,0 +1,29 @@
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+const unsigned int INPUT_QUEUE_SIZE = 256;
+
+struct InputEvent {
+    double Time;    // seconds on the glfwGetTime clock
+    int    Key;
+    bool   Pressed;
+};
+
+// Key transitions in arrival order, stamped when the window system handed them
+// over. Lives in a fixed ring; when full the newest event is dropped and counted.
+class InputQueue
+{
+public:
+    unsigned int Dropped;
+
+    InputQueue() : Dropped(0), head(0), tail(0) { }
+    bool Push(int key, bool pressed, double time);
+    // takes the oldest event stamped at or before time
+    bool Pop(double time, InputEvent &event);
+    bool Empty() const { return this->head == this->tail; }
+private:
+    InputEvent   events[INPUT_QUEUE_SIZE];
+    unsigned int head, tail; // free running, wrapped on access
+};
+
+#endif
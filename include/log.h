@@ -0,0 +1,88 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <initializer_list>
+#include <string>
+
+enum LogLevel {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_ERROR
+};
+
+// Calls below this level are compiled out, arguments included. Build with
+// -DLOG_MIN_LEVEL=LOG_LEVEL_WARNING, say, to drop more.
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+// LOG_ERROR("SHADER", "Compile-time error", {{ "type", type }, { "log", infoLog }});
+// The category, message and keys are kept by pointer until the line is
+// written, so they must be string literals; values are copied.
+#define LOG_DEBUG(...)   do { if (LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG)   Log::Write(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#define LOG_INFO(...)    do { if (LOG_MIN_LEVEL <= LOG_LEVEL_INFO)    Log::Write(LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#define LOG_WARNING(...) do { if (LOG_MIN_LEVEL <= LOG_LEVEL_WARNING) Log::Write(LOG_LEVEL_WARNING, __VA_ARGS__); } while (0)
+#define LOG_ERROR(...)   do { if (LOG_MIN_LEVEL <= LOG_LEVEL_ERROR)   Log::Write(LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+
+const unsigned int LOG_MAX_THREADS = 16;      // threads logging at the same time
+const unsigned int LOG_RING_BYTES  = 1 << 16; // per thread, a power of two
+const unsigned int LOG_MAX_FIELDS  = 8;
+const unsigned int LOG_MAX_TEXT    = 2048;    // longer text values are cut
+
+enum LogValueType {
+    LOG_VALUE_INT,
+    LOG_VALUE_UINT,
+    LOG_VALUE_FLOAT,
+    LOG_VALUE_BOOL,
+    LOG_VALUE_TEXT
+};
+
+// A key and a typed value, formatted by the writer thread.
+struct LogField {
+    const char  *Key;
+    LogValueType Type;
+    union {
+        long long          Int;
+        unsigned long long UInt;
+        double             Float;
+        bool               Bool;
+        const char        *Text; // copied by Write
+    };
+
+    LogField(const char *key, int value)                : Key(key), Type(LOG_VALUE_INT), Int(value) { }
+    LogField(const char *key, long value)               : Key(key), Type(LOG_VALUE_INT), Int(value) { }
+    LogField(const char *key, long long value)          : Key(key), Type(LOG_VALUE_INT), Int(value) { }
+    LogField(const char *key, unsigned int value)       : Key(key), Type(LOG_VALUE_UINT), UInt(value) { }
+    LogField(const char *key, unsigned long value)      : Key(key), Type(LOG_VALUE_UINT), UInt(value) { }
+    LogField(const char *key, unsigned long long value) : Key(key), Type(LOG_VALUE_UINT), UInt(value) { }
+    LogField(const char *key, float value)              : Key(key), Type(LOG_VALUE_FLOAT), Float(value) { }
+    LogField(const char *key, double value)             : Key(key), Type(LOG_VALUE_FLOAT), Float(value) { }
+    LogField(const char *key, bool value)               : Key(key), Type(LOG_VALUE_BOOL), Bool(value) { }
+    LogField(const char *key, const char *value)        : Key(key), Type(LOG_VALUE_TEXT), Text(value ? value : "") { }
+    LogField(const char *key, const std::string &value) : Key(key), Type(LOG_VALUE_TEXT), Text(value.c_str()) { }
+};
+
+// A static logger that keeps logging off the calling thread. Each thread
+// writes its records into a ring of its own, without locks or allocations,
+// and a writer thread merges the rings in order, formats the lines as
+// LEVEL::CATEGORY: message key=value ... and writes them to stdout. A full
+// ring drops the record and counts it rather than wait. Nothing logged is
+// lost at exit, and after Shutdown lines are written on the calling thread.
+class Log {
+public:
+    static void         Write(LogLevel level, const char *category, const char *message, std::initializer_list<LogField> fields = {});
+    // returns once everything logged so far is written
+    static void         Flush();
+    static void         Shutdown();
+    static unsigned int Dropped();
+    static const char  *LevelName(LogLevel level);
+private:
+    Log() { }
+};
+
+#endif
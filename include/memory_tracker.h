@@ -0,0 +1,116 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <cstdio>
+
+#include "gl_backend.h"
+
+// Subsystems memory is attributed to, see MemoryScope.
+enum MemoryOwner {
+    MEMORY_GENERAL,
+    MEMORY_ASSETS,         // textures loaded through the ResourceManager
+    MEMORY_RENDER_TARGETS, // PostProcessor framebuffers
+    MEMORY_STREAM,         // per-frame vertex ring
+    MEMORY_TEXT,
+    MEMORY_PARTICLES,
+    MEMORY_LEVEL,
+    MEMORY_ENTITIES,       // ball and power-up tables
+    MEMORY_RECORDER,
+    MEMORY_REWIND,
+    MEMORY_STATE_STREAM,
+    MEMORY_AUDIO,          // the mixer's sound bank
+    MEMORY_OWNER_COUNT
+};
+
+const unsigned int MEMORY_MAX_RECORDS  = 256;
+const unsigned int MEMORY_LABEL_LENGTH = 24;
+
+// One block of GPU storage or of long-lived CPU memory.
+struct MemoryRecord {
+    MemoryOwner        Owner;
+    GLObjectKind       Kind;    // GLOBJECT_KIND_COUNT for CPU memory
+    unsigned int       Name;    // GL name, or the MemoryToken's id
+    unsigned int       Format;  // GL internal format, 0 for buffers and CPU memory
+    unsigned int       Width, Height, Samples;
+    unsigned long long Bytes;
+    char               Label[MEMORY_LABEL_LENGTH];
+};
+
+struct MemoryStats {
+    unsigned long long GPUBytes[MEMORY_OWNER_COUNT];
+    unsigned long long CPUBytes[MEMORY_OWNER_COUNT];
+    unsigned int       Records[MEMORY_OWNER_COUNT];
+    unsigned long long PeakGPUBytes, PeakCPUBytes;
+
+    unsigned long long TotalGPUBytes() const;
+    unsigned long long TotalCPUBytes() const;
+};
+
+// A static ledger of what the game keeps in memory, by owner. Storage calls
+// report GPU memory, keyed by GL name, and the handles in gl_handle.h take it
+// off again when they delete the name. GPU sizes are what the formats need,
+// with RGB padded to four bytes as drivers store it; drivers may add more.
+// CPU memory is reported through MemoryTokens by whoever sizes a pool. Only
+// touched from the thread that owns the GL context, and never allocates.
+class MemoryTracker {
+public:
+    // a new storage call on a name replaces its record
+    static void               TrackTexture(unsigned int name, unsigned int format, unsigned int width, unsigned int height);
+    static void               TrackRenderbuffer(unsigned int name, unsigned int format, unsigned int width, unsigned int height, unsigned int samples);
+    static void               TrackBuffer(unsigned int name, unsigned long long bytes);
+    static void               Release(GLObjectKind kind, unsigned int name);
+    static void               Label(GLObjectKind kind, unsigned int name, const char *label);
+    static const MemoryStats &Stats();
+    static unsigned int       RecordCount();
+    static const MemoryRecord &Record(unsigned int index);
+    // every record and the totals per owner
+    static void               Report(FILE *out);
+    // reports what the owner, or everyone for MEMORY_OWNER_COUNT, still holds
+    // and returns how many records that is
+    static unsigned int       CheckLeaks(const char *when, MemoryOwner owner);
+    static const char        *OwnerName(MemoryOwner owner);
+    static const char        *FormatName(unsigned int format);
+    static MemoryOwner        CurrentOwner();
+    static void               SetCurrentOwner(MemoryOwner owner);
+private:
+    MemoryTracker() { }
+    friend class MemoryToken;
+    static void track(MemoryOwner owner, GLObjectKind kind, unsigned int name, unsigned int format, unsigned int width, unsigned int height,
+                      unsigned int samples, unsigned long long bytes);
+};
+
+// Attributes everything tracked during its lifetime to an owner.
+class MemoryScope {
+public:
+    explicit MemoryScope(MemoryOwner owner) : previous(MemoryTracker::CurrentOwner()) { MemoryTracker::SetCurrentOwner(owner); }
+    ~MemoryScope() { MemoryTracker::SetCurrentOwner(this->previous); }
+private:
+    MemoryOwner previous;
+};
+
+// Move-only stake in the ledger for CPU memory a pool reserved, the record
+// goes with the token, so it follows its owner through moves like a GLHandle.
+class MemoryToken {
+public:
+    MemoryToken() : id(0) { }
+    MemoryToken(MemoryToken &&other) noexcept : id(other.id) { other.id = 0; }
+    MemoryToken &operator=(MemoryToken &&other) noexcept {
+        if (this != &other) {
+            this->Reset();
+            this->id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    }
+    MemoryToken(const MemoryToken &) = delete;
+    MemoryToken &operator=(const MemoryToken &) = delete;
+    ~MemoryToken() { this->Reset(); }
+
+    // states the bytes held now, attributed to the current MemoryScope
+    void Track(const char *label, unsigned long long bytes);
+    void Reset();
+private:
+    unsigned int id;
+};
+
+#endif
@@ -7,35 +7,121 @@
 
 #include "shader.h"
 #include "texture2D.h"
-#include "game_object.h"
+#include "memory_tracker.h"
 
 
 struct Particle {
     glm::vec2 Position, Velocity;
     glm::vec4 Color;
     float     Life;
+    float     Fade; // alpha lost per second
 
-    Particle() : Position(0.0f), Velocity(0.0f), Color(1.0f), Life(0.0f) { }
+    Particle() : Position(0.0f), Velocity(0.0f), Color(1.0f), Life(0.0f), Fade(0.0f) { }
 };
 
+const unsigned int   MAX_EMITTERS       = 16;
+const unsigned int   MAX_SPAWN_REQUESTS = 128;
+const unsigned short NO_EMITTER         = 0xFFFF;
 
+// Describes how an emitter spawns particles, all ranges are sampled uniformly.
+struct EmitterDesc {
+    float        Rate;                  // continuous emission in particles per second
+    unsigned int Budget;                // max live particles owned by this emitter
+    unsigned int Priority;              // when the pool is full, higher priorities cull lower ones
+    float        LifeMin, LifeMax;      // seconds
+    float        SpeedMin, SpeedMax;    // pixels per second
+    glm::vec2    Direction;             // center of the emission cone
+    float        Spread;                // half-angle of the cone in degrees, 180 = all directions
+    float        Inherit;               // fraction of the source velocity added to each particle
+    float        Jitter;                // random positional offset in pixels
+    float        BrightMin, BrightMax;  // color multiplier
+    glm::vec3    Color;
+    float        Fade;
+
+    EmitterDesc()
+        : Rate(0.0f), Budget(100), Priority(0), LifeMin(1.0f), LifeMax(1.0f), SpeedMin(0.0f), SpeedMax(0.0f),
+          Direction(0.0f, -1.0f), Spread(180.0f), Inherit(0.0f), Jitter(0.0f), BrightMin(1.0f), BrightMax(1.0f),
+          Color(1.0f), Fade(1.0f) { }
+};
+
+
+// A fixed-size particle pool shared by any number of emitters. Emitters queue
+// spawn requests (per-second rates or bursts) which are served once per Update,
+// highest priority first, within each emitter's budget; when the pool is full
+// particles of lower priority emitters are culled to make room.
+//
+// Particles are either integrated on the CPU (one draw per particle) or, when
+// constructed with a transform feedback update shader, kept entirely on the GPU:
+// two state buffers are ping-ponged every frame and drawn instanced.
 class ParticleGenerator
 {
 public:
-    ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount);
-    void Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+    bool GPU;
+
+    ParticleGenerator(Shader &shader, const Texture2D &texture, unsigned int amount);
+    ParticleGenerator(Shader &shader, Shader &updateShader, const Texture2D &texture, unsigned int amount);
+    unsigned int AddEmitter(const EmitterDesc &desc);
+    // continuous emission from a source for one frame, fractional particles are rounded stochastically
+    void Emit(unsigned int emitter, float dt, glm::vec2 position, glm::vec2 velocity = glm::vec2(0.0f));
+    void Burst(unsigned int emitter, unsigned int count, glm::vec2 position, glm::vec2 velocity = glm::vec2(0.0f), glm::vec3 tint = glm::vec3(1.0f));
+    void Update(float dt);
     void Draw();
+    unsigned int LiveCount() const { return this->live; }
+    // copies out the whole pool, from the GPU in that mode; stalls, for tests
+    void ReadBack(std::vector<Particle> &state) const;
 
 private:
+    struct SpawnRequest {
+        unsigned int Emitter, Count;
+        unsigned int Order; // submitted since the last spawn, breaks priority ties
+        glm::vec2    Position, Velocity;
+        glm::vec3    Tint;
+    };
+    struct EmitterState {
+        EmitterDesc  Desc;
+        unsigned int Live, Pending;
+    };
+    struct SpawnedParticle {
+        unsigned int Slot;
+        Particle     Data;
+    };
+
     std::vector<Particle> particles;
     unsigned int amount;
-    Shader shader;
-    Texture2D texture;
-    unsigned int VAO;
+    Shader &shader;
+    const Texture2D &texture;
+    VertexArrayHandle VAO;
+    BufferHandle quadVBO;
+    // pool bookkeeping, kept on the CPU in both modes
+    std::vector<float>          slotLife;
+    std::vector<unsigned short> slotOwner;
+    std::vector<unsigned int>   freeSlots;
+    std::vector<unsigned int>   victims;
+    unsigned int                victimCursor;
+    bool                        victimsBuilt;
+    std::vector<EmitterState>   emitters;
+    std::vector<SpawnRequest>   requests;
+    unsigned int                submitted; // requests queued since the last spawn
+    unsigned int                live;
+    // GPU path
+    Shader *updateShader;
+    BufferHandle stateVBO[2];
+    VertexArrayHandle updateVAO[2], renderVAO[2];
+    unsigned int current;
+    std::vector<SpawnedParticle> spawnBatch;
+    std::vector<Particle>        uploadStaging;
+    MemoryToken                  memory; // the CPU side of the pool
 
     void init();
-    unsigned int firstUnusedParticle();
-    void respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+    void initGPU();
+    void trackMemory();
+    void spawnRequests();
+    void uploadSpawnBatch();
+    void integrateGPU(float dt);
+    int  allocateSlot(unsigned int priority);
+    void buildVictims();
+    void releaseSlot(unsigned int slot);
+    void respawnParticle(Particle &particle, const EmitterDesc &desc, const SpawnRequest &request);
 };
 
 #endif
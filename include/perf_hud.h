@@ -0,0 +1,80 @@
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include <chrono>
+
+#include "glm/glm.hpp"
+
+#include "shader.h"
+#include "stream_buffer.h"
+#include "text_renderer.h"
+
+// CPU work timed per frame, see PerfScope
+enum PerfSection {
+    PERF_UPDATE,
+    PERF_COLLISION, // part of PERF_UPDATE
+    PERF_PARTICLES, // part of PERF_UPDATE
+    PERF_RENDER,
+    PERF_HUD,
+    PERF_SECTION_COUNT
+};
+
+// frames in the frame time graph
+const unsigned int PERF_HISTORY = 120;
+// seconds the numbers are averaged over, the graph moves every frame
+const double PERF_REFRESH = 0.25;
+const unsigned int PERF_LINES = 15;
+const unsigned int PERF_LINE_LENGTH = 32;
+
+// One frame as the HUD shows it.
+struct PerfSample {
+    float        FrameTime;                    // milliseconds from the previous EndFrame
+    float        GPUTime;                      // milliseconds, smoothed
+    float        Sections[PERF_SECTION_COUNT]; // CPU milliseconds
+    unsigned int DrawCalls, Binds, Uniforms;
+    unsigned int Particles, Bricks, Allocations;
+    unsigned long long GPUMemory, CPUMemory;   // bytes held, see MemoryTracker
+};
+
+// Adds the time spent while it lives to a section of the current frame. Only
+// for the main thread, a section that spreads over the workers is timed from
+// the thread that waits for them.
+class PerfScope {
+public:
+    explicit PerfScope(PerfSection section) : section(section), start(std::chrono::steady_clock::now()) { }
+    ~PerfScope();
+private:
+    PerfSection                           section;
+    std::chrono::steady_clock::time_point start;
+};
+
+// An overlay with the frame rate, a frame time graph and what the frame spent
+// its time on, for seeing why a machine struggles without a profiler. It is all
+// text and flat rectangles from one TextRenderer, so it draws with one call,
+// and the numbers are only formatted a few times a second; drawing it is
+// timed as PERF_HUD and shown on it.
+class PerfHud
+{
+public:
+    PerfHud(Shader &shader, StreamBuffer &stream);
+    // closes the frame: fills in sample's frame time and the section times
+    // collected since the last call, call it every frame even while hidden
+    void EndFrame(PerfSample &sample);
+    // into the bound framebuffer, sized in its pixels
+    void Draw(unsigned int width, unsigned int height);
+private:
+    Shader                               &shader;
+    TextRenderer                          text;
+    PerfSample                            history[PERF_HISTORY];
+    unsigned int                          newest;
+    PerfSample                            sum; // of the frames since the numbers were refreshed
+    unsigned int                          summed;
+    char                                  lines[PERF_LINES][PERF_LINE_LENGTH];
+    unsigned int                          lineCount;
+    unsigned int                          width, height; // the projection is set up for
+    std::chrono::steady_clock::time_point lastFrame, refreshed;
+    bool                                  started;
+    void refresh();
+};
+
+#endif
@@ -8,25 +8,88 @@
 #include "sprite_renderer.h"
 #include "shader.h"
 
+#include <cstddef>
+
+enum AntiAliasing {
+    AA_OFF,
+    AA_FXAA,    // post pass over the single-sample scene
+    AA_MSAA_2,
+    AA_MSAA_4,
+    AA_MSAA_8,
+    AA_MODE_COUNT
+};
+
+extern const char *ANTI_ALIASING_NAMES[AA_MODE_COUNT];
+
+// internal resolution steps, largest first; targets only ever exist at these scales
+const unsigned int RESOLUTION_STEPS = 5;
+const float        RESOLUTION_SCALES[RESOLUTION_STEPS] = { 1.0f, 0.85f, 0.7f, 0.6f, 0.5f };
+const unsigned int RESOLUTION_COOLDOWN = 30; // frames between two scale changes
+const float        RESOLUTION_HEADROOM = 0.85f; // step up only if the larger scale should fit in this much of the budget
+const unsigned int GPU_TIMER_QUERIES = 4; // frames a timing may take to come back without stalling
+
+// Renders the scene into an offscreen target and applies the effects while
+// upscaling it to the window. With DynamicResolution the target shrinks or
+// grows a step at a time to keep the measured GPU time inside GPUBudget.
+// Anti-aliasing is either a multisampled scene resolved with a blit or an
+// FXAA pass over the resolved scene.
 class PostProcessor
 {
 public:
-    Shader PostProcessingShader;
-    Texture2D Texture;
-    unsigned int Width, Height;
+    Shader &PostProcessingShader;
+    unsigned int Width, Height; // window framebuffer
     bool Confuse, Chaos, Shake;
+    bool DynamicResolution;
+    float GPUBudget; // milliseconds for scene plus post-processing
+    float GPUTime;   // smoothed measurement, milliseconds
+
+    Shader &FXAAShader;
 
-    PostProcessor(Shader shader, unsigned int width, unsigned int height);
+    // width and height are the world size, the output keeps its aspect ratio
+    PostProcessor(Shader &shader, Shader &fxaaShader, unsigned int width, unsigned int height, AntiAliasing antiAliasing = AA_MSAA_4);
 
     void BeginRender();
     void EndRender();
     void Render(float time);
+    // takes effect at the next BeginRender, which drops every target and
+    // reallocates the current scale at the new size; safe in the middle of a frame
+    void Resize(unsigned int width, unsigned int height);
+    float Scale() const { return RESOLUTION_SCALES[this->step]; }
+    // MSAA counts beyond GL_MAX_SAMPLES fall back to the largest supported one;
+    // starts over at full resolution
+    void SetAntiAliasing(AntiAliasing antiAliasing);
+    AntiAliasing GetAntiAliasing() const { return this->antiAliasing; }
+    unsigned int Samples() const { return this->samples; }
+    // estimated memory of the allocated targets, drivers keep RGB8 in four bytes
+    size_t TargetBytes() const;
 
 private:
-    unsigned int MSFBO, FBO; // MSFBO = Multisampled FBO
-    unsigned int RBO; // RBO is used for multisampled color buffer
-    unsigned int VAO;
+    struct RenderTarget {
+        FramebufferHandle  MSFBO, FBO; // MSFBO = Multisampled FBO, only with MSAA
+        RenderbufferHandle RBO; // RBO is used for multisampled color buffer
+        Texture2D          Texture;
+        FramebufferHandle  FXAAFBO; // only with FXAA
+        Texture2D          FXAATexture;
+        unsigned int       Width, Height;
+    };
+    RenderTarget      targets[RESOLUTION_STEPS];
+    unsigned int      step, cooldown;
+    AntiAliasing      antiAliasing;
+    unsigned int      samples, maxSamples;
+    QueryHandle       timers[GPU_TIMER_QUERIES];
+    unsigned int      frame;
+    bool              resample; // next timing replaces the average, the scale just changed
+    float             aspect;
+    unsigned int      viewportX, viewportY, viewportWidth, viewportHeight; // letterboxed output
+    unsigned int      pendingWidth, pendingHeight; // the window size Resize got, 0 once applied
+    VertexArrayHandle VAO;
+    BufferHandle      VBO;
     void initRenderData();
+    void releaseTargets();
+    void resize(unsigned int width, unsigned int height);
+    RenderTarget &target();
+    void readTimings();
+    void updateScale(float milliseconds);
 };
 
 #endif
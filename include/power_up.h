@@ -2,21 +2,35 @@
 #define POWER_UP_H
 
 #include "glm/glm.hpp"
-#include "game_object.h"
 
-#include <string>
+const glm::vec2 POWERUP_SIZE(60.0f, 20.0f);
+const glm::vec2 POWERUP_VELOCITY(0.0f, 150.0f);
 
-const glm::vec2 SIZE(60.0f, 20.0f);
-const glm::vec2 VELOCITY(0.0f, 150.0f);
+enum PowerUpType : unsigned char {
+    POWERUP_SPEED,
+    POWERUP_STICKY,
+    POWERUP_PASS_THROUGH,
+    POWERUP_GROW,
+    POWERUP_CONFUSE,
+    POWERUP_CHAOS,
+    POWERUP_MULTIBALL,
+    POWERUP_TYPE_COUNT
+};
+
+class Game;
+typedef void (*PowerUpEffect)(Game &game);
 
-class PowerUp : public GameObject {
-    public:
-        std::string Type;
-        float       Duration;
-        bool        Activated;
-        
-        PowerUp(std::string type, glm::vec3 color, float duration, glm::vec2 position, Texture2D texture)
-            : GameObject(position, SIZE, texture, color, VELOCITY), Type(type), Duration(duration), Activated() {  }
+// Static description of a power-up type, one entry per PowerUpType in POWERUP_DEFS.
+struct PowerUpDef {
+    const char    *Texture;     // resource name
+    const char    *TextureFile;
+    float          Duration;    // seconds, 0 for instant effects that never expire
+    unsigned int   SpawnOdds;   // rolled independently per destroyed brick, 1 in SpawnOdds
+    glm::vec3      Color;
+    PowerUpEffect  Activate;
+    PowerUpEffect  Deactivate;  // runs when the last active power-up of this type expires
 };
 
+extern const PowerUpDef POWERUP_DEFS[POWERUP_TYPE_COUNT];
+
 #endif // POWER_UP_H
@@ -0,0 +1,20 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+// A xorshift generator whose whole state is one word, so gameplay randomness
+// can be saved with the game and replayed.
+struct Random {
+    unsigned int State; // never 0
+
+    explicit Random(unsigned int seed = 0x9E3779B9u) : State(seed ? seed : 1) { }
+    unsigned int Next() {
+        this->State ^= this->State << 13;
+        this->State ^= this->State >> 17;
+        this->State ^= this->State << 5;
+        return this->State;
+    }
+    // true once in chance draws on average
+    bool OneIn(unsigned int chance) { return this->Next() % chance == 0; }
+};
+
+#endif
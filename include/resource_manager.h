@@ -9,19 +9,23 @@
 #include "texture2D.h"
 #include "shader.h"
 
-// A static singleton ResourceManager class 
+// A static singleton ResourceManager class, the single owner of all shaders and
+// textures. Everything else holds references, which stay valid until Clear().
+// Files are asset names, served from the AssetPack or loose files.
 class ResourceManager {
 public:
     static std::map<std::string, Shader>    Shaders;
     static std::map<std::string, Texture2D> Textures;
-    static Shader    LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name);
-    static Shader    GetShader(std::string name);
-    static Texture2D LoadTexture(const char *file, bool alpha, std::string name);
-    static Texture2D GetTexture(std::string name);
+    static Shader    &LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name);
+    static Shader    &LoadFeedbackShader(const char *vShaderFile, const char **varyings, unsigned int count, std::string name);
+    static Shader    &GetShader(std::string name);
+    static Texture2D &LoadTexture(const char *file, bool alpha, std::string name);
+    static Texture2D &GetTexture(std::string name);
     static void      Clear();
 private:
     ResourceManager() { }
     static Shader    loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile = nullptr);
+    static Shader    loadFeedbackShaderFromFile(const char *vShaderFile, const char **varyings, unsigned int count);
     static Texture2D loadTextureFromFile(const char *file, bool alpha);
 };
 
@@ -0,0 +1,58 @@
+#ifndef REWIND_BUFFER_H
+#define REWIND_BUFFER_H
+
+#include <vector>
+
+#include "game.h"
+#include "memory_tracker.h"
+
+const unsigned int REWIND_RATE     = 240;       // updates a second the history is sized for
+const unsigned int REWIND_KEYFRAME = 60;        // updates between states stored whole
+const unsigned int REWIND_BYTES    = 512 << 10; // for the encoded states, the oldest go when it runs out
+
+// The game's recent past for rewinding, one encoded state per update, see
+// StateCodec. Every REWIND_KEYFRAME updates a state is stored whole, those in
+// between as a delta against it, so reading any state back decodes at most
+// one keyframe and one delta. States live back to back in a byte ring and the
+// oldest keyframe goes with its deltas when the ring or the entry count runs
+// out. Everything is sized up front, Push and Read never allocate.
+class RewindBuffer
+{
+public:
+    RewindBuffer(const Game &game, unsigned int capacity, unsigned int bytes);
+    // appends the state after an update
+    void         Push(const GameSnapshot &snapshot);
+    // states held, the newest is 0 back
+    unsigned int Size() const { return this->count; }
+    // decodes the state back updates before the newest into a snapshot
+    // reserved with Game::ReserveSnapshot, false if it is not held
+    bool         Read(unsigned int back, GameSnapshot &snapshot);
+    // forgets the newest states, play continues from the one before
+    void         Drop(unsigned int states);
+    void         Clear();
+    // bytes the held states take in the ring
+    unsigned int UsedBytes() const;
+private:
+    struct Entry {
+        unsigned int Offset, Size;
+        unsigned int Base, BaseSize; // the keyframe a delta applies to
+        unsigned int Distance;       // updates since that keyframe, 0 for a keyframe
+    };
+    std::vector<Entry>         entries; // ring of states, oldest first
+    unsigned int               first, count;
+    std::vector<unsigned char> bytes;   // ring of encodings, in the order of the entries
+    unsigned int               head;
+    unsigned int               lost;    // states too large for the ring
+    // scratch: the state being pushed, its delta, and a state rebuilt by Read
+    std::vector<unsigned char> encoded, delta, rebuilt;
+    MemoryToken                memory;
+
+    Entry       &entry(unsigned int back) { return this->entries[(this->first + this->count - 1 - back) % this->entries.size()]; }
+    const Entry &entry(unsigned int back) const { return this->entries[(this->first + this->count - 1 - back) % this->entries.size()]; }
+    // where size bytes fit after the newest state, or NO_OFFSET
+    unsigned int allocate(unsigned int size) const;
+    // drops the oldest keyframe and every delta against it
+    void         dropOldest();
+};
+
+#endif
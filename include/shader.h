@@ -7,21 +7,28 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+#include "gl_handle.h"
+
+// Owns its GL program, so it can be moved but not copied.
 class Shader
 {
 public:
-    unsigned int ID; 
+    ProgramHandle ID; 
 
     Shader() { }
 
     Shader  &Use();
 
     void    Compile(const char *vertexSource, const char *fragmentSource, const char *geometrySource = nullptr); // note: geometry source code is optional 
+    // vertex-only program whose outputs are captured with transform feedback (interleaved)
+    void    CompileFeedback(const char *vertexSource, const char **varyings, unsigned int count);
+    bool    IsLinked() const;
 
     void    SetFloat    (const char *name, float value, bool useShader = false);
     void    SetInteger  (const char *name, int value, bool useShader = false);
     void    SetVector2f (const char *name, float x, float y, bool useShader = false);
     void    SetVector2f (const char *name, const glm::vec2 &value, bool useShader = false);
+    void    SetVector2fv(const char *name, const glm::vec2 *values, unsigned int count, bool useShader = false);
     void    SetVector3f (const char *name, float x, float y, float z, bool useShader = false);
     void    SetVector3f (const char *name, const glm::vec3 &value, bool useShader = false);
     void    SetVector4f (const char *name, float x, float y, float z, float w, bool useShader = false);
@@ -3,22 +3,43 @@
 
 #include <glad/glad.h>
 #include "glm/glm.hpp"
-#include "glm/gtc/matrix_transform.hpp"
 
 #include "texture2D.h"
 #include "shader.h"
+#include "stream_buffer.h"
 
+// sprites queued before a draw call is issued
+const unsigned int SPRITE_BATCH = 1024;
 
+// What the GPU gets per sprite, the vertex shader builds the quad from it.
+struct SpriteInstance {
+    glm::vec2    Position, Size;
+    float        Rotation; // radians around the quad center, 0 skips the rotation
+    unsigned int Color;    // RGBA8, red in the lowest byte
+};
+
+unsigned int PackColor(glm::vec3 color, float alpha = 1.0f);
+
+// Writes sprites straight into the stream buffer and draws runs that share a
+// texture with one instanced call. Nothing reaches the screen before Flush, so
+// call it before drawing with anything else, or another renderer of the same
+// stream.
 class SpriteRenderer
 {
 public:
-    SpriteRenderer(Shader &&shader);
-    ~SpriteRenderer();
-    void DrawSprite(Texture2D &&texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f));
-    void DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color);
+    SpriteRenderer(Shader &shader, StreamBuffer &stream);
+    void DrawSprite(const Texture2D &texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f));
+    // the next instance of the batch for texture, for renderers whose shader reads
+    // the fields differently; write every field, null when the stream is full
+    SpriteInstance *Queue(const Texture2D &texture);
+    void Flush();
 private:
-    Shader       shader; 
-    unsigned int quadVAO;
+    Shader            &shader; 
+    StreamBuffer      &stream;
+    VertexArrayHandle  quadVAO;
+    SpriteInstance    *instances; // mapped batch, null between batches
+    unsigned int       count;
+    const Texture2D   *texture; // shared by the queued sprites
     void initRenderData();
 };
 
@@ -0,0 +1,41 @@
+#ifndef STATE_CODEC_H
+#define STATE_CODEC_H
+
+#include "game.h"
+
+const unsigned char STATE_VERSION = 1;
+
+// A compact binary form of a GameSnapshot and deltas between two of them.
+//
+// The encoding packs what Save keeps into fixed little fields: keys and
+// destroyed bricks as bitsets, the tables column by column, so a ball that
+// moves changes a few bytes in place. A delta is the XOR of two encodings,
+// stored as runs of zero bytes and the literal bytes in between, so bytes a
+// tick did not touch cost nothing. Nothing here allocates, every buffer
+// belongs to the caller and MaxBytes sizes them.
+class StateCodec {
+public:
+    // largest encoding of a game with these many bricks, balls and power-ups
+    // and timers at their limits
+    static unsigned int MaxBytes(unsigned int bricks);
+    // returns the size written to out, which must hold MaxBytes
+    static unsigned int Encode(const GameSnapshot &snapshot, unsigned char *out);
+    // the snapshot must be reserved, see Game::ReserveSnapshot; false for a
+    // malformed encoding or one larger than the reservation, the snapshot is
+    // then in no useful state
+    static bool         Decode(const unsigned char *data, unsigned int size, GameSnapshot &snapshot);
+    // writes the delta from base to state into out, 0 if it would take more
+    // than capacity bytes; the state is better stored whole then
+    static unsigned int Delta(const unsigned char *base, unsigned int baseSize, const unsigned char *state, unsigned int stateSize,
+                              unsigned char *out, unsigned int capacity);
+    // rebuilds the state a delta was taken from base, 0 if the delta is
+    // malformed or the state larger than capacity
+    static unsigned int Apply(const unsigned char *base, unsigned int baseSize, const unsigned char *delta, unsigned int deltaSize,
+                              unsigned char *out, unsigned int capacity);
+    // FNV-1a of an encoding, to check one rebuilt elsewhere
+    static unsigned int Checksum(const unsigned char *data, unsigned int size);
+private:
+    StateCodec() { }
+};
+
+#endif
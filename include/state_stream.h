@@ -0,0 +1,119 @@
+#ifndef STATE_STREAM_H
+#define STATE_STREAM_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "memory_tracker.h"
+
+const unsigned int STREAM_VERSION    = 2;
+const unsigned int STREAM_RING_BYTES = 2 << 20; // shared memory ring, a multiple of 8
+const unsigned int STREAM_KEYFRAME   = 240;     // updates between states sent whole
+const unsigned int STREAM_MAX_BRICKS = 1 << 16; // across the levels, what readers size their buffers for
+
+enum StreamMessageType {
+    STREAM_KEYFRAME_STATE, // a StateCodec encoding
+    STREAM_DELTA_STATE,    // a StateCodec delta against the state of the previous tick
+    STREAM_PADDING         // skips the rest of the ring
+};
+
+// Every message, in the ring and in a datagram, starts with this.
+struct StreamMessage {
+    unsigned int       Size;     // header and payload, padded to 8
+    unsigned int       Type;
+    unsigned long long Tick;     // one per published state, a gap means one was missed
+    unsigned int       Checksum; // FNV-1a of the whole encoding, to check a rebuilt state against
+    unsigned int       PayloadSize;
+};
+
+// The start of the shared memory, the ring follows it.
+struct StreamHeader {
+    char                            Magic[4]; // "PSTM"
+    unsigned int                    Version;
+    unsigned int                    Capacity;   // ring bytes
+    unsigned int                    MaxMessage; // the most one write takes, padding and message
+    // ring bytes written, free running; a message is complete once Head is past it
+    alignas(64) std::atomic<unsigned long long> Head;
+    // the end of the write in progress, stored before any of its bytes; what
+    // a reader copies from behind it by more than Capacity may be torn
+    std::atomic<unsigned long long>             Reserved;
+};
+
+// the largest message a game with up to STREAM_MAX_BRICKS sends
+unsigned int StreamMaxMessage();
+
+// Publishes the game state after every update for other processes on the
+// machine, an overlay or a recorder, as StateCodec encodings: whole every
+// STREAM_KEYFRAME ticks and as deltas against the previous tick in between.
+//
+// Through shared memory the game is the single producer of a ring that it
+// overwrites without ever looking at its readers, who copy a message out
+// and then check Reserved to see whether it was overwritten meanwhile. Through
+// a Unix datagram socket every message is a datagram sent without waiting,
+// one the receiver has no room for is dropped. A reader that misses a tick
+// waits for the next keyframe. Publish never blocks and never allocates.
+class StateStream
+{
+public:
+    unsigned long long Ticks;   // published
+    unsigned long long Dropped; // datagrams the socket did not take
+
+    StateStream(const Game &game);
+    ~StateStream();
+    // creates the named shared memory, replacing one left behind
+    bool OpenSharedMemory(const char *name);
+    // sends to a receiver bound to path, see StateStreamReader
+    bool OpenSocket(const char *path);
+    void Publish(const GameSnapshot &snapshot);
+private:
+    std::string                name;   // of the shared memory, unlinked again on close
+    StreamHeader              *header;
+    unsigned char             *ring;
+    size_t                     mappedBytes;
+    int                        socket;
+    std::string                path;
+    // the state of the last tick and of this one, and the message being built
+    std::vector<unsigned char> previous, current, message;
+    unsigned int               previousSize;
+    MemoryToken                memory;
+
+    void write(const unsigned char *data, unsigned int size);
+};
+
+// The reading end for another process, see tools/stream_viewer.cpp; it lives
+// in state_stream_reader.cpp and needs nothing of the game to link. Read
+// hands out rebuilt encodings one tick at a time, checked against their
+// checksum, for StateCodec::Decode.
+class StateStreamReader
+{
+public:
+    unsigned long long Tick;     // of the state Read returned last
+    unsigned long long Missed;   // ticks between verified states that could not be rebuilt
+    unsigned long long Verified; // states rebuilt that matched their checksum
+
+    StateStreamReader();
+    ~StateStreamReader();
+    // maps a ring the game created, starting at its newest message
+    bool OpenSharedMemory(const char *name);
+    // binds path and receives what the game sends there
+    bool OpenSocket(const char *path);
+    // the next state, false if there is none yet; size is its length in bytes
+    bool Read(const unsigned char *&state, unsigned int &size);
+private:
+    const StreamHeader        *header;
+    const unsigned char       *ring;
+    size_t                     mappedBytes;
+    unsigned long long         position; // in the ring, free running
+    int                        socket;
+    std::string                path;
+    bool                       synced;   // holds a state deltas can apply to
+    std::vector<unsigned char> message, state, rebuilt;
+    unsigned int               stateSize;
+
+    bool next(); // the next message into message
+    bool apply();
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include "gl_handle.h"
+
+// frames whose data may still be read by the GPU, more stall the writer
+const unsigned int STREAM_MAX_FENCES = 8;
+const unsigned int STREAM_ALIGNMENT  = 16;
+
+struct StreamStats {
+    unsigned int Stalls;         // waits on a fence because the ring was full
+    unsigned int Overflows;      // frames that did not fit the ring on their own
+    unsigned int Wraps;
+    unsigned int PeakFrameBytes; // the ring wants a few of these to never stall
+};
+
+// A ring of GPU memory for data written once per frame. Writers map a range at
+// the head and write straight into it; every frame is fenced on EndFrame and
+// its range is only reused once the fence signals. With ARB_buffer_storage the
+// buffer is mapped once, persistently, otherwise each range is mapped
+// unsynchronized, which is safe because the fences already keep the GPU off it.
+// One range can be mapped at a time.
+class StreamBuffer
+{
+public:
+    StreamStats Stats;
+
+    StreamBuffer(GLenum target, unsigned int size);
+    ~StreamBuffer();
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+    // room for up to bytes at the head, waits for the GPU only when the ring is full;
+    // null if the range could not be mapped, and then there is nothing to Unmap
+    void        *Map(unsigned int bytes);
+    // ends the current map, keeping the first used bytes; returns their offset in the buffer
+    unsigned int Unmap(unsigned int used);
+    // fences what was written since the last call, once the frame's draws are issued
+    void         EndFrame();
+    unsigned int ID() const { return this->buffer; }
+    unsigned int Size() const { return this->size; }
+    bool         Persistent() const { return this->persistent != nullptr; }
+
+private:
+    struct Fence {
+        GLsync       Sync;
+        unsigned int Begin; // where the fenced frame's data starts
+    };
+    BufferHandle  buffer;
+    GLenum        target;
+    unsigned int  size;
+    char         *persistent; // whole buffer, null when each range is mapped on its own
+    unsigned int  head, frameBegin, frameBytes;
+    unsigned int  mapped; // bytes of the open map, 0 when none
+    Fence         fences[STREAM_MAX_FENCES];
+    unsigned int  firstFence, fenceCount;
+
+    bool fits(unsigned int bytes) const;
+    void fence();
+    void retire(bool wait);
+};
+
+#endif
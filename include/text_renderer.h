@@ -0,0 +1,42 @@
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include "glm/glm.hpp"
+
+#include "texture2D.h"
+#include "shader.h"
+#include "sprite_renderer.h"
+#include "stream_buffer.h"
+
+// The built-in font covers ASCII from the space to the underscore, the cell
+// after the last glyph is solid and used for rectangles.
+const unsigned int FONT_FIRST_CHAR    = 32;
+const unsigned int FONT_GLYPHS        = 64;
+const unsigned int FONT_SOLID         = FONT_GLYPHS;
+const unsigned int FONT_GLYPH_WIDTH   = 5; // pixels
+const unsigned int FONT_GLYPH_HEIGHT  = 7;
+const unsigned int FONT_ADVANCE       = 6; // glyph plus spacing
+const unsigned int FONT_CELL          = 8; // pixels per atlas cell, the glyph sits in its top left
+const unsigned int FONT_COLUMNS       = 16;
+
+// Draws text and flat rectangles as sprites from a small bitmap font. Every
+// glyph and rectangle shares the font texture, so a screen full of text is one
+// instanced draw. The text shader reads the sprite rotation as the glyph's
+// atlas cell, nothing rotates.
+class TextRenderer
+{
+public:
+    TextRenderer(Shader &shader, StreamBuffer &stream);
+    // position is the top left of the first glyph, scale is screen pixels per font
+    // pixel; lower case is drawn as upper case and anything else outside the font
+    // as '?'. Returns where the next character would go.
+    float DrawText(const char *text, glm::vec2 position, float scale, glm::vec3 color = glm::vec3(1.0f), float alpha = 1.0f);
+    void  DrawRect(glm::vec2 position, glm::vec2 size, glm::vec3 color, float alpha = 1.0f);
+    void  Flush();
+private:
+    Texture2D      font;
+    SpriteRenderer sprites;
+    void initFont();
+};
+
+#endif
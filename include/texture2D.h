@@ -3,9 +3,13 @@
 
 #include <glad/glad.h>
 
+#include "gl_handle.h"
+
+// Owns its GL texture, so it can be moved but not copied. Game objects refer
+// to textures through const pointers into the ResourceManager.
 class Texture2D {
     public:
-        unsigned int ID;
+        TextureHandle ID;
         unsigned int Width, Height;
         unsigned int Internal_Format;
         unsigned int Image_Format;
@@ -16,6 +20,8 @@ class Texture2D {
 
         Texture2D();
 
+        // creates the GL texture on first use, the storage is reported to the
+        // MemoryTracker under the current MemoryScope
         void Generate(unsigned int width, unsigned int height, unsigned char* data);
 
         void Bind() const;
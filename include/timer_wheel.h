@@ -0,0 +1,77 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+#include <vector>
+
+typedef void (*TimerCallback)(void *context, unsigned int data);
+// generation in the high bits, slot + 1 in the low bits, 0 is never a valid timer
+typedef unsigned int TimerId;
+const TimerId NO_TIMER = 0;
+
+const unsigned int TIMER_WHEEL_BITS   = 6;
+const unsigned int TIMER_WHEEL_SLOTS  = 1 << TIMER_WHEEL_BITS;
+const unsigned int TIMER_WHEEL_LEVELS = 4;
+const float        TIMER_TICK         = 1.0f / 256.0f; // seconds
+
+// A scheduled timer as a snapshot sees it.
+struct PendingTimer {
+    unsigned long long Expires; // tick
+    TimerCallback      Callback;
+    void              *Context;
+    unsigned int       Data;
+};
+
+// A hierarchical timing wheel for one-shot callbacks in game time. Timers
+// within 64 ticks of now sit in the finest wheel, later ones in coarser wheels
+// and are cascaded down as time approaches them, so advancing costs O(1) per
+// tick plus the timers that actually expire. Timers live in a fixed pool.
+class TimerWheel
+{
+public:
+    TimerWheel(unsigned int capacity);
+    // calls callback(context, data) once delay seconds of game time have passed; NO_TIMER if the pool is full
+    TimerId      Schedule(float delay, TimerCallback callback, void *context, unsigned int data = 0);
+    // false if the timer already fired or was cancelled
+    bool         Cancel(TimerId timer);
+    bool         IsActive(TimerId timer) const;
+    void         Advance(float dt);
+    void         Clear();
+    unsigned int ActiveCount() const { return this->active; }
+
+    // for snapshots: the clock, the pool walked slot by slot (false for a free
+    // slot), and putting both back
+    double             Elapsed() const { return this->elapsed; }
+    unsigned long long Tick() const { return this->currentTick; }
+    unsigned int       Capacity() const { return this->capacity; }
+    bool               Pending(unsigned int slot, PendingTimer &timer) const;
+    // drops every timer and sets the clock
+    void               Reset(double elapsed, unsigned long long tick);
+    TimerId            ScheduleAt(unsigned long long tick, TimerCallback callback, void *context, unsigned int data = 0);
+
+private:
+    struct Node {
+        unsigned int       Prev, Next;
+        unsigned long long Expires;
+        TimerCallback      Callback;
+        void              *Context;
+        unsigned int       Data;
+        unsigned int       Generation;
+    };
+    // timers first, then one list sentinel per wheel slot, then the firing list
+    std::vector<Node>  nodes;
+    unsigned int       capacity;
+    unsigned int       freeList;
+    unsigned int       active;
+    unsigned long long currentTick; // next tick to process
+    double             elapsed;
+    bool               dispatching; // callbacks of currentTick are running
+
+    unsigned int sentinel(unsigned int level, unsigned int slot) const;
+    unsigned int firingList() const;
+    void         insert(unsigned int node);
+    void         link(unsigned int list, unsigned int node);
+    void         unlink(unsigned int node);
+    void         cascade(unsigned int level);
+    void         release(unsigned int node);
+};
+
+#endif
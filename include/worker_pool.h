@@ -0,0 +1,40 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef void (*WorkerJob)(void *context, unsigned int begin, unsigned int end);
+
+// A fixed set of threads started once, so handing them work never touches the
+// heap. Ranges are split into chunks that threads claim from a shared counter.
+class WorkerPool
+{
+public:
+    // 0 picks one thread less than the hardware has, the caller is the last one
+    WorkerPool(unsigned int threads = 0);
+    ~WorkerPool();
+    // calls job(context, begin, end) over [0, count) in chunks of grain and
+    // returns once every chunk ran; the calling thread works along
+    void         ParallelFor(unsigned int count, unsigned int grain, WorkerJob job, void *context);
+    unsigned int Threads() const { return this->workers.size() + 1; }
+
+private:
+    std::vector<std::thread>  workers;
+    std::mutex                mutex;
+    std::condition_variable   wake, done;
+    WorkerJob                 job;
+    void                     *context;
+    unsigned int              count, grain;
+    std::atomic<unsigned int> next;
+    unsigned int              pending; // workers that have not finished the current range
+    unsigned long long        generation;
+    bool                      quit;
+
+    void run();
+    void work();
+};
+
+#endif
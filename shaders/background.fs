@@ -1,27 +1,34 @@
 #version 330 core
 in vec2 TexCoords;
 in vec4 FragPos;
+in vec4 SpriteColor;
 out vec4 color;
 
+// keep in sync with MAX_SHADOW_BALLS
+const int MAX_BALLS = 16;
+
 uniform sampler2D image;
-uniform vec3 spriteColor;
-uniform vec2 ballPos;
+uniform vec2 ballPos[MAX_BALLS];
+uniform int ballCount;
 uniform float aspect;
 uniform bool shadow;
 
 void main() {
     vec2 scaledFrag = vec2(FragPos.x, FragPos.y / aspect);
-    vec2 scaledBall = vec2(ballPos.x, ballPos.y / aspect);
 
-    float dist = distance(scaledFrag, scaledBall);
+    float dist = 1.0;
+    for (int i = 0; i < ballCount; ++i) {
+        vec2 scaledBall = vec2(ballPos[i].x, ballPos[i].y / aspect);
+        dist = min(dist, distance(scaledFrag, scaledBall));
+    }
     if (shadow) {
         if (dist <= 0.05) {
-            color = vec4(spriteColor, 0.6) * texture(image, TexCoords);
+            color = vec4(SpriteColor.rgb, 0.6) * texture(image, TexCoords);
         } else {
-            color = vec4(spriteColor, 1.0) * texture(image, TexCoords);
+            color = SpriteColor * texture(image, TexCoords);
         }
     }
     else {
-        color = vec4(spriteColor, 1.0) * texture(image, TexCoords);
+        color = SpriteColor * texture(image, TexCoords);
     }
 }
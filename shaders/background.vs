@@ -1,14 +1,31 @@
 #version 330 core
-layout (location = 0) in vec4 vertex;
+layout (location = 0) in vec4  rect;     // position xy, size zw
+layout (location = 1) in float rotation; // radians
+layout (location = 2) in vec4  tint;
 
 out vec2 TexCoords;
 out vec4 FragPos;
+out vec4 SpriteColor;
 
-uniform mat4 model;
 uniform mat4 projection;
 
+const vec2 CORNERS[6] = vec2[](
+    vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(0.0, 0.0),
+    vec2(0.0, 1.0), vec2(1.0, 1.0), vec2(1.0, 0.0)
+);
+
 void main() {
-    TexCoords = vertex.zw;
-    FragPos = vec4(vertex.xy, 0.0, 1.0); 
-    gl_Position = projection * model * vec4(vertex.xy, 0.0, 1.0);
+    vec2 corner = CORNERS[gl_VertexID];
+    vec2 local = corner * rect.zw;
+    if (rotation != 0.0) {
+        vec2 center = 0.5 * rect.zw;
+        float s = sin(rotation);
+        float c = cos(rotation);
+        local = center + mat2(c, s, -s, c) * (local - center);
+    }
+    TexCoords = corner;
+    // ball positions are sent in the same unit square
+    FragPos = vec4(corner, 0.0, 1.0);
+    SpriteColor = tint;
+    gl_Position = projection * vec4(rect.xy + local, 0.0, 1.0);
 }
@@ -0,0 +1,22 @@
+#version 330 core
+in vec2      TexCoords;
+in vec4      SpriteColor;
+flat in uint Layer;
+out vec4 color;
+
+// keep in sync with BRICK_TEXTURES
+uniform sampler2D images[4];
+
+void main() {
+    // sampler arrays may only be indexed with constants here
+    vec4 texel;
+    if (Layer == 0u)
+        texel = texture(images[0], TexCoords);
+    else if (Layer == 1u)
+        texel = texture(images[1], TexCoords);
+    else if (Layer == 2u)
+        texel = texture(images[2], TexCoords);
+    else
+        texel = texture(images[3], TexCoords);
+    color = SpriteColor * texel;
+}
@@ -0,0 +1,25 @@
+#version 330 core
+layout (location = 0) in vec4  rect; // position xy, size zw
+layout (location = 1) in vec4  tint;
+layout (location = 2) in uint  layer;
+layout (location = 3) in float visible;
+
+out vec2      TexCoords;
+out vec4      SpriteColor;
+flat out uint Layer;
+
+uniform mat4 projection;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(0.0, 0.0),
+    vec2(0.0, 1.0), vec2(1.0, 1.0), vec2(1.0, 0.0)
+);
+
+void main() {
+    vec2 corner = CORNERS[gl_VertexID];
+    TexCoords = corner;
+    SpriteColor = tint;
+    Layer = layer;
+    // destroyed bricks collapse to a point and are never rasterized
+    gl_Position = projection * vec4(rect.xy + corner * rect.zw * visible, 0.0, 1.0);
+}
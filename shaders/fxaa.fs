@@ -0,0 +1,40 @@
+#version 330 core
+in vec2  TexCoords;
+out vec4 color;
+
+uniform sampler2D scene;
+uniform vec2      inverseSize; // 1 / texture size in pixels
+
+const float SPAN_MAX   = 8.0;
+const float REDUCE_MUL = 1.0 / 8.0;
+const float REDUCE_MIN = 1.0 / 128.0;
+const vec3  LUMA       = vec3(0.299, 0.587, 0.114);
+
+// blurs along the local edge direction found from the luma of the four diagonal neighbours
+void main() {
+    vec3 rgbNW = texture(scene, TexCoords + vec2(-1.0, -1.0) * inverseSize).rgb;
+    vec3 rgbNE = texture(scene, TexCoords + vec2( 1.0, -1.0) * inverseSize).rgb;
+    vec3 rgbSW = texture(scene, TexCoords + vec2(-1.0,  1.0) * inverseSize).rgb;
+    vec3 rgbSE = texture(scene, TexCoords + vec2( 1.0,  1.0) * inverseSize).rgb;
+    vec3 rgbM  = texture(scene, TexCoords).rgb;
+    float lumaNW = dot(rgbNW, LUMA);
+    float lumaNE = dot(rgbNE, LUMA);
+    float lumaSW = dot(rgbSW, LUMA);
+    float lumaSE = dot(rgbSE, LUMA);
+    float lumaM  = dot(rgbM,  LUMA);
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * (0.25 * REDUCE_MUL), REDUCE_MIN);
+    float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    dir = clamp(dir * rcpDirMin, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * inverseSize;
+
+    vec3 rgbA = 0.5 * (texture(scene, TexCoords + dir * (1.0 / 3.0 - 0.5)).rgb +
+                       texture(scene, TexCoords + dir * (2.0 / 3.0 - 0.5)).rgb);
+    vec3 rgbB = rgbA * 0.5 + 0.25 * (texture(scene, TexCoords + dir * -0.5).rgb +
+                                     texture(scene, TexCoords + dir *  0.5).rgb);
+    float lumaB = dot(rgbB, LUMA);
+    // the wider tap crossed into another edge, fall back to the narrow one
+    color = vec4((lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec4  vertex;
+// per-instance, read straight from the transform feedback buffer
+layout (location = 1) in vec2  offset;
+layout (location = 2) in vec4  color;
+layout (location = 3) in float life;
+
+out vec2 TexCoords;
+out vec4 ParticleColor;
+
+uniform mat4 projection;
+
+void main()
+{
+    float scale = 10.0f;
+    TexCoords = vertex.zw;
+    ParticleColor = color;
+    if (life > 0.0)
+        gl_Position = projection * vec4((vertex.xy * scale) + offset, 0.0, 1.0);
+    else
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0); // dead particles collapse outside the clip volume
+}
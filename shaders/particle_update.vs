@@ -0,0 +1,29 @@
+#version 330 core
+layout (location = 0) in vec2  position;
+layout (location = 1) in vec2  velocity;
+layout (location = 2) in vec4  color;
+layout (location = 3) in float life;
+layout (location = 4) in float fade;
+
+// captured with transform feedback, same layout as struct Particle
+out vec2  outPosition;
+out vec2  outVelocity;
+out vec4  outColor;
+out float outLife;
+out float outFade;
+
+uniform float dt;
+
+void main() {
+    outVelocity = velocity;
+    outFade = fade;
+    outLife = life - dt;
+    if (outLife > 0.0) {
+        outPosition = position + velocity * dt;
+        outColor = vec4(color.rgb, color.a - dt * fade);
+    }
+    else {
+        outPosition = position;
+        outColor = color;
+    }
+}
@@ -0,0 +1,26 @@
+#version 330 core
+layout (location = 0) in vec4  rect; // position xy, size zw
+layout (location = 1) in float cell; // atlas cell, sent where sprites keep their rotation
+layout (location = 2) in vec4  tint;
+
+out vec2 TexCoords;
+out vec4 SpriteColor;
+
+uniform mat4 projection;
+uniform int  columns;   // cells per atlas row
+uniform vec2 cellSize;  // in texture coordinates
+uniform vec2 glyphSize;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(0.0, 0.0),
+    vec2(0.0, 1.0), vec2(1.0, 1.0), vec2(1.0, 0.0)
+);
+
+void main() {
+    vec2 corner = CORNERS[gl_VertexID];
+    int index = int(cell + 0.5);
+    vec2 origin = vec2(index % columns, index / columns) * cellSize;
+    TexCoords = origin + corner * glyphSize;
+    SpriteColor = tint;
+    gl_Position = projection * vec4(rect.xy + corner * rect.zw, 0.0, 1.0);
+}
@@ -0,0 +1,115 @@
+#include "../include/alloc_tracker.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// all state is constant-initialized, operator new can run before main
+static std::atomic<unsigned int>       counts[ALLOC_TAG_COUNT];
+static std::atomic<unsigned long long> bytes[ALLOC_TAG_COUNT];
+static thread_local AllocTag           currentTag = ALLOC_GENERAL;
+static AllocStats                      lastFrame;
+static bool                            steadyState = false;
+static unsigned int                    violations = 0;
+
+unsigned int AllocStats::TotalCount() const {
+    unsigned int total = 0;
+    for (unsigned int i = 0; i < ALLOC_TAG_COUNT; ++i)
+        total += this->Count[i];
+    return total;
+}
+
+unsigned long long AllocStats::TotalBytes() const {
+    unsigned long long total = 0;
+    for (unsigned int i = 0; i < ALLOC_TAG_COUNT; ++i)
+        total += this->Bytes[i];
+    return total;
+}
+
+void AllocTracker::EndFrame() {
+    for (unsigned int i = 0; i < ALLOC_TAG_COUNT; ++i) {
+        lastFrame.Count[i] = counts[i].exchange(0, std::memory_order_relaxed);
+        lastFrame.Bytes[i] = bytes[i].exchange(0, std::memory_order_relaxed);
+    }
+    if (steadyState && lastFrame.TotalCount() > 0) {
+        ++violations;
+#ifdef ALLOC_TRACKING_ASSERT
+        // stdio instead of iostream, no allocations while reporting
+        std::fprintf(stderr, "ERROR::ALLOC_TRACKER: steady-state frame allocated %u times (%llu bytes)\n",
+            lastFrame.TotalCount(), lastFrame.TotalBytes());
+        for (unsigned int i = 0; i < ALLOC_TAG_COUNT; ++i)
+            if (lastFrame.Count[i] > 0)
+                std::fprintf(stderr, "    %-10s %u (%llu bytes)\n", TagName((AllocTag)i), lastFrame.Count[i], lastFrame.Bytes[i]);
+        std::abort();
+#endif
+    }
+}
+
+const AllocStats &AllocTracker::LastFrame() {
+    return lastFrame;
+}
+
+void AllocTracker::SetSteadyState(bool steady) {
+    steadyState = steady;
+}
+
+unsigned int AllocTracker::SteadyStateViolations() {
+    return violations;
+}
+
+const char *AllocTracker::TagName(AllocTag tag) {
+    static const char *names[ALLOC_TAG_COUNT] = {
+        "general", "input", "update", "collision", "particles", "powerups", "level", "render"
+    };
+    return tag < ALLOC_TAG_COUNT ? names[tag] : "unknown";
+}
+
+AllocTag AllocTracker::CurrentTag() {
+    return currentTag;
+}
+
+void AllocTracker::SetCurrentTag(AllocTag tag) {
+    currentTag = tag;
+}
+
+void AllocTracker::Record(std::size_t size) {
+    counts[currentTag].fetch_add(1, std::memory_order_relaxed);
+    bytes[currentTag].fetch_add(size, std::memory_order_relaxed);
+}
+
+// global allocation hooks
+
+static void *trackedAlloc(std::size_t size) {
+    AllocTracker::Record(size);
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new(std::size_t size) {
+    void *p = trackedAlloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size) {
+    void *p = trackedAlloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return trackedAlloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return trackedAlloc(size);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
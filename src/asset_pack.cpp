@@ -0,0 +1,192 @@
+#include "../include/asset_pack.h"
+#include "../include/log.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const unsigned char *packData = nullptr;
+static size_t               packSize = 0;
+static const AssetEntry    *packIndex = nullptr;
+static unsigned int         packCount = 0;
+static std::string          looseRoot = "../";
+#ifdef _WIN32
+static HANDLE               packFile = INVALID_HANDLE_VALUE, packMapping = NULL;
+#endif
+
+unsigned long long HashAsset(const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char*)data;
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool mapFile(const char *file) {
+#ifdef _WIN32
+    packFile = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (packFile == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(packFile, &size) || size.QuadPart == 0)
+        return false;
+    packMapping = CreateFileMappingA(packFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (packMapping == NULL)
+        return false;
+    packData = (const unsigned char*)MapViewOfFile(packMapping, FILE_MAP_READ, 0, 0, 0);
+    packSize = (size_t)size.QuadPart;
+    return packData != nullptr;
+#else
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file alive
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+    packData = (const unsigned char*)mapping;
+    packSize = status.st_size;
+    return true;
+#endif
+}
+
+static void unmapFile() {
+#ifdef _WIN32
+    if (packData)
+        UnmapViewOfFile(packData);
+    if (packMapping != NULL)
+        CloseHandle(packMapping);
+    if (packFile != INVALID_HANDLE_VALUE)
+        CloseHandle(packFile);
+    packMapping = NULL;
+    packFile = INVALID_HANDLE_VALUE;
+#else
+    if (packData)
+        munmap((void*)packData, packSize);
+#endif
+    packData = nullptr;
+    packSize = 0;
+    packIndex = nullptr;
+    packCount = 0;
+}
+
+bool AssetPack::Open(const char *file) {
+    Close();
+    if (!mapFile(file)) {
+        unmapFile();
+        return false;
+    }
+    const AssetPackHeader *header = (const AssetPackHeader*)packData;
+    if (packSize < sizeof(AssetPackHeader) || std::memcmp(header->Magic, ASSET_PACK_MAGIC, 4) != 0 || header->Version != ASSET_PACK_VERSION
+        || (packSize - sizeof(AssetPackHeader)) / sizeof(AssetEntry) < header->Count) {
+        LOG_ERROR("ASSET_PACK", "Not an asset pack of this version", {{ "file", file }, { "version", ASSET_PACK_VERSION }});
+        unmapFile();
+        return false;
+    }
+    const AssetEntry *index = (const AssetEntry*)(packData + sizeof(AssetPackHeader));
+    for (unsigned int i = 0; i < header->Count; ++i) {
+        // every span handed out has its terminating 0 inside the mapping
+        // and lookups rely on the index being sorted
+        if (index[i].Offset > packSize || index[i].Size >= packSize - index[i].Offset || index[i].Name[ASSET_NAME_SIZE - 1] != 0
+            || (i > 0 && std::strncmp(index[i - 1].Name, index[i].Name, ASSET_NAME_SIZE) >= 0)) {
+            LOG_ERROR("ASSET_PACK", "Corrupt index entry", {{ "file", file }, { "entry", i }});
+            unmapFile();
+            return false;
+        }
+    }
+    packIndex = index;
+    packCount = header->Count;
+    return true;
+}
+
+void AssetPack::Close() {
+    unmapFile();
+}
+
+bool AssetPack::IsOpen() {
+    return packIndex != nullptr;
+}
+
+void AssetPack::SetRoot(const std::string &root) {
+    looseRoot = root;
+}
+
+std::string AssetPack::Root() {
+    return looseRoot;
+}
+
+bool AssetPack::Find(const char *name, AssetSpan &span) {
+    unsigned int first = 0, last = packCount;
+    while (first < last) {
+        unsigned int middle = (first + last) / 2;
+        int order = std::strncmp(packIndex[middle].Name, name, ASSET_NAME_SIZE);
+        if (order == 0) {
+            span.Data = packData + packIndex[middle].Offset;
+            span.Size = packIndex[middle].Size;
+            return true;
+        }
+        if (order < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return false;
+}
+
+bool AssetPack::Verify() {
+    bool valid = true;
+    for (unsigned int i = 0; i < packCount; ++i)
+        if (HashAsset(packData + packIndex[i].Offset, packIndex[i].Size) != packIndex[i].Hash) {
+            LOG_ERROR("ASSET_PACK", "Hash mismatch", {{ "asset", packIndex[i].Name }});
+            valid = false;
+        }
+    return valid;
+}
+
+AssetData::AssetData(const char *name)
+    : data(nullptr), size(0)
+{
+    AssetSpan span;
+    if (AssetPack::IsOpen() && AssetPack::Find(name, span)) {
+        this->data = span.Data;
+        this->size = span.Size;
+        return;
+    }
+    std::string path = looseRoot + name;
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        LOG_ERROR("ASSET", "Failed to open", {{ "path", path }});
+        return;
+    }
+    std::fseek(file, 0, SEEK_END);
+    long length = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (length >= 0) {
+        this->loose.resize(length + 1);
+        if (std::fread(this->loose.data(), 1, length, file) == (size_t)length) {
+            this->loose[length] = 0;
+            this->data = this->loose.data();
+            this->size = length;
+        }
+        else
+            LOG_ERROR("ASSET", "Failed to read", {{ "path", path }});
+    }
+    std::fclose(file);
+}
@@ -0,0 +1,312 @@
+#include "../include/audio_mixer.h"
+#include "../include/log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+const std::chrono::nanoseconds AUDIO_BLOCK_TIME(1000000000ull * AUDIO_BLOCK / AUDIO_RATE);
+const unsigned int AUDIO_FILE_BUFFER = 64 << 10;
+const unsigned int WAV_HEADER_BYTES  = 44;
+const double       PI                = 3.14159265358979323846;
+
+static_assert((AUDIO_QUEUE_SIZE & (AUDIO_QUEUE_SIZE - 1)) == 0, "the queue wraps with a mask");
+static_assert(AUDIO_BLOCK % 4 == 0, "blocks are mixed four frames at a time");
+
+static void putWavHeader(FILE *file, unsigned long long frames) {
+    unsigned int dataBytes = (unsigned int)std::min(frames * 4, 0xFFFFFFFFull - WAV_HEADER_BYTES);
+    unsigned int riffBytes = dataBytes + WAV_HEADER_BYTES - 8;
+    unsigned int formatBytes = 16, rate = AUDIO_RATE, byteRate = AUDIO_RATE * 4;
+    unsigned short format = 1, channels = 2, align = 4, bits = 16;
+    // RIFF is little endian, like every target the game builds for
+    std::fwrite("RIFF", 1, 4, file);
+    std::fwrite(&riffBytes, 4, 1, file);
+    std::fwrite("WAVEfmt ", 1, 8, file);
+    std::fwrite(&formatBytes, 4, 1, file);
+    std::fwrite(&format, 2, 1, file);
+    std::fwrite(&channels, 2, 1, file);
+    std::fwrite(&rate, 4, 1, file);
+    std::fwrite(&byteRate, 4, 1, file);
+    std::fwrite(&align, 2, 1, file);
+    std::fwrite(&bits, 2, 1, file);
+    std::fwrite("data", 1, 4, file);
+    std::fwrite(&dataBytes, 4, 1, file);
+}
+
+AudioMixer::AudioMixer()
+    : sink(nullptr), sinkContext(nullptr), paced(true), file(nullptr), fileFrames(0), quit(false), head(0), tail(0), nextVoice(NO_VOICE),
+      dropped(0), voiceCount(0), blocks(0), playing(0), peakVoices(0), stolen(0), rejected(0), late(0)
+{
+    this->sounds.reserve(AUDIO_MAX_SOUNDS);
+}
+
+AudioMixer::~AudioMixer() {
+    if (this->thread.joinable()) {
+        this->quit.store(true, std::memory_order_release);
+        this->thread.join();
+        AudioStats stats = this->Stats();
+        LOG_INFO("AUDIO", "Mixer stopped", {{ "blocks", stats.Blocks }, { "peak_voices", stats.PeakVoices }, { "stolen", stats.Stolen },
+            { "rejected", stats.Rejected }, { "dropped", stats.Dropped }, { "late", stats.Late }});
+    }
+    if (this->file) {
+        std::fseek(this->file, 0, SEEK_SET);
+        putWavHeader(this->file, this->fileFrames);
+        std::fclose(this->file);
+    }
+}
+
+SoundId AudioMixer::Load(const float *samples, unsigned int count) {
+    if (this->thread.joinable() || this->sounds.size() == AUDIO_MAX_SOUNDS) {
+        LOG_WARNING("AUDIO", "Sound not loaded", {{ "reason", this->thread.joinable() ? "mixer running" : "too many sounds" }});
+        return NO_SOUND;
+    }
+    Sound sound = { (unsigned int)this->bank.size(), count };
+    this->bank.insert(this->bank.end(), samples, samples + count);
+    this->sounds.push_back(sound);
+    MemoryScope memoryScope(MEMORY_AUDIO);
+    this->memory.Track("sound bank", this->bank.capacity() * sizeof(float));
+    return this->sounds.size() - 1;
+}
+
+SoundId AudioMixer::LoadTone(const ToneDesc &tone) {
+    std::vector<float> samples((unsigned int)(tone.Seconds * AUDIO_RATE));
+    double phase = 0.0;
+    for (unsigned int i = 0; i < samples.size(); ++i) {
+        float t = (float)i / AUDIO_RATE;
+        float hz = tone.StartHz + (tone.EndHz - tone.StartHz) * t / tone.Seconds;
+        phase += 2.0 * PI * hz / AUDIO_RATE;
+        float sine = (float)std::sin(phase);
+        float wave = sine + tone.Square * ((sine < 0.0f ? -1.0f : 1.0f) - sine);
+        // a few milliseconds of fade in and out keep the edges from clicking
+        float edge = std::min(1.0f, std::min(i, (unsigned int)samples.size() - i) / (0.002f * AUDIO_RATE));
+        samples[i] = wave * tone.Gain * edge * std::exp(-tone.Decay * t);
+    }
+    return this->Load(samples.data(), samples.size());
+}
+
+bool AudioMixer::OpenFile(const char *path) {
+    this->file = std::fopen(path, "wb");
+    if (!this->file) {
+        LOG_ERROR("AUDIO", "Failed to open the audio file", {{ "path", path }});
+        return false;
+    }
+    this->fileBuffer.resize(AUDIO_FILE_BUFFER);
+    std::setvbuf(this->file, this->fileBuffer.data(), _IOFBF, this->fileBuffer.size());
+    // the sizes are filled in once the mixer stops
+    putWavHeader(this->file, 0);
+    this->SetSink(writeFile, this);
+    this->paced = true;
+    return true;
+}
+
+void AudioMixer::OpenNull() {
+    this->SetSink(discard, this);
+    this->paced = true;
+}
+
+void AudioMixer::SetSink(AudioSink sink, void *context) {
+    this->sink = sink;
+    this->sinkContext = context;
+    this->paced = false;
+}
+
+void AudioMixer::Start() {
+    if (!this->sink)
+        this->OpenNull();
+    this->thread = std::thread(&AudioMixer::run, this);
+}
+
+bool AudioMixer::push(const Command &command) {
+    unsigned int tail = this->tail.load(std::memory_order_relaxed);
+    if (tail - this->head.load(std::memory_order_acquire) == AUDIO_QUEUE_SIZE) {
+        ++this->dropped;
+        return false;
+    }
+    this->commands[tail & (AUDIO_QUEUE_SIZE - 1)] = command;
+    this->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+VoiceId AudioMixer::Play(SoundId sound, float gain, float pan, unsigned int priority) {
+    if (sound >= this->sounds.size())
+        return NO_VOICE;
+    if (++this->nextVoice == NO_VOICE)
+        ++this->nextVoice;
+    // constant power, so a sound keeps its loudness across the field
+    float angle = (std::max(-1.0f, std::min(pan, 1.0f)) + 1.0f) * (float)PI * 0.25f;
+    Command command = { COMMAND_PLAY, this->nextVoice, sound, gain * std::cos(angle), gain * std::sin(angle), priority };
+    return this->push(command) ? command.Voice : NO_VOICE;
+}
+
+void AudioMixer::Stop(VoiceId voice) {
+    Command command = { COMMAND_STOP, voice, NO_SOUND, 0.0f, 0.0f, 0 };
+    this->push(command);
+}
+
+void AudioMixer::StopAll() {
+    Command command = { COMMAND_STOP_ALL, NO_VOICE, NO_SOUND, 0.0f, 0.0f, 0 };
+    this->push(command);
+}
+
+AudioStats AudioMixer::Stats() const {
+    AudioStats stats;
+    stats.Blocks = this->blocks.load(std::memory_order_relaxed);
+    stats.Voices = this->playing.load(std::memory_order_relaxed);
+    stats.PeakVoices = this->peakVoices.load(std::memory_order_relaxed);
+    stats.Stolen = this->stolen.load(std::memory_order_relaxed);
+    stats.Rejected = this->rejected.load(std::memory_order_relaxed);
+    stats.Dropped = this->dropped;
+    stats.Late = this->late.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void AudioMixer::run() {
+#ifndef _WIN32
+    // a block late is a click, so ask to run ahead of the game where the system lets us
+    sched_param param;
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+        LOG_DEBUG("AUDIO", "Mixer runs at normal priority");
+#endif
+    std::chrono::steady_clock::time_point due = std::chrono::steady_clock::now();
+    while (!this->quit.load(std::memory_order_acquire)) {
+        unsigned int tail = this->tail.load(std::memory_order_acquire);
+        for (unsigned int head = this->head.load(std::memory_order_relaxed); head != tail; ++head) {
+            this->execute(this->commands[head & (AUDIO_QUEUE_SIZE - 1)]);
+            this->head.store(head + 1, std::memory_order_release);
+        }
+        this->mixBlock();
+        this->sink(this->sinkContext, this->frames, AUDIO_BLOCK);
+        this->blocks.fetch_add(1, std::memory_order_relaxed);
+        this->playing.store(this->voiceCount, std::memory_order_relaxed);
+        if (!this->paced)
+            continue;
+        // behind by more than a block, the time is lost rather than caught up on
+        due += AUDIO_BLOCK_TIME;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now > due + AUDIO_BLOCK_TIME) {
+            this->late.fetch_add(1, std::memory_order_relaxed);
+            due = now;
+        }
+        std::this_thread::sleep_until(due);
+    }
+}
+
+void AudioMixer::execute(const Command &command) {
+    if (command.Type == COMMAND_PLAY)
+        this->start(command);
+    else if (command.Type == COMMAND_STOP) {
+        for (unsigned int i = 0; i < this->voiceCount; ++i)
+            if (this->voices[i].Id == command.Voice) {
+                this->voices[i] = this->voices[--this->voiceCount];
+                break;
+            }
+    }
+    else
+        this->voiceCount = 0;
+}
+
+void AudioMixer::start(const Command &command) {
+    Voice *voice = nullptr;
+    if (this->voiceCount < AUDIO_MAX_VOICES)
+        voice = &this->voices[this->voiceCount++];
+    else {
+        // the least important voice, among equals the one with the least left to play
+        Voice *victim = &this->voices[0];
+        for (unsigned int i = 1; i < AUDIO_MAX_VOICES; ++i) {
+            const Voice &other = this->voices[i];
+            if (other.Priority < victim->Priority
+                || (other.Priority == victim->Priority && other.Count - other.Position < victim->Count - victim->Position))
+                victim = &this->voices[i];
+        }
+        if (victim->Priority > command.Priority) {
+            this->rejected.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        this->stolen.fetch_add(1, std::memory_order_relaxed);
+        voice = victim;
+    }
+    const Sound &sound = this->sounds[command.Sound];
+    voice->Id = command.Voice;
+    voice->Samples = this->bank.data() + sound.Offset;
+    voice->Count = sound.Count;
+    voice->Position = 0;
+    voice->Left = command.Left;
+    voice->Right = command.Right;
+    voice->Priority = command.Priority;
+    if (this->voiceCount > this->peakVoices.load(std::memory_order_relaxed))
+        this->peakVoices.store(this->voiceCount, std::memory_order_relaxed);
+}
+
+void AudioMixer::mixBlock() {
+    std::fill(this->mix, this->mix + AUDIO_BLOCK * 2, 0.0f);
+    for (unsigned int v = 0; v < this->voiceCount; ) {
+        Voice &voice = this->voices[v];
+        unsigned int count = std::min(AUDIO_BLOCK, voice.Count - voice.Position);
+        const float *samples = voice.Samples + voice.Position;
+        float *out = this->mix;
+        unsigned int i = 0;
+        // each mono sample goes to both channels, four frames at a time
+#if defined(__SSE2__) || defined(_M_X64)
+        __m128 gains = _mm_setr_ps(voice.Left, voice.Right, voice.Left, voice.Right);
+        for (; i + 4 <= count; i += 4) {
+            __m128 s = _mm_loadu_ps(samples + i);
+            _mm_store_ps(out + i * 2, _mm_add_ps(_mm_load_ps(out + i * 2), _mm_mul_ps(_mm_unpacklo_ps(s, s), gains)));
+            _mm_store_ps(out + i * 2 + 4, _mm_add_ps(_mm_load_ps(out + i * 2 + 4), _mm_mul_ps(_mm_unpackhi_ps(s, s), gains)));
+        }
+#elif defined(__ARM_NEON)
+        float32x4_t gains = { voice.Left, voice.Right, voice.Left, voice.Right };
+        for (; i + 4 <= count; i += 4) {
+            float32x4x2_t s = vzipq_f32(vld1q_f32(samples + i), vld1q_f32(samples + i));
+            vst1q_f32(out + i * 2, vmlaq_f32(vld1q_f32(out + i * 2), s.val[0], gains));
+            vst1q_f32(out + i * 2 + 4, vmlaq_f32(vld1q_f32(out + i * 2 + 4), s.val[1], gains));
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i * 2] += samples[i] * voice.Left;
+            out[i * 2 + 1] += samples[i] * voice.Right;
+        }
+        voice.Position += count;
+        // a finished voice makes room for the last one, which is mixed next
+        if (voice.Position == voice.Count)
+            voice = this->voices[--this->voiceCount];
+        else
+            ++v;
+    }
+    // clamped before converting, out of range floats convert to the wrong sign
+    unsigned int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128 low = _mm_set1_ps(-1.0f), high = _mm_set1_ps(1.0f), scale = _mm_set1_ps(32767.0f);
+    for (; i < AUDIO_BLOCK * 2; i += 8) {
+        __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_load_ps(this->mix + i), low), high), scale));
+        __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_load_ps(this->mix + i + 4), low), high), scale));
+        _mm_store_si128(reinterpret_cast<__m128i*>(this->frames + i), _mm_packs_epi32(a, b));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t low = vdupq_n_f32(-1.0f), high = vdupq_n_f32(1.0f), scale = vdupq_n_f32(32767.0f);
+    for (; i < AUDIO_BLOCK * 2; i += 4)
+        vst1_s16(this->frames + i, vqmovn_s32(vcvtq_s32_f32(vmulq_f32(vminq_f32(vmaxq_f32(vld1q_f32(this->mix + i), low), high), scale))));
+#endif
+    for (; i < AUDIO_BLOCK * 2; ++i)
+        this->frames[i] = (short)std::lrint(std::max(-1.0f, std::min(this->mix[i], 1.0f)) * 32767.0f);
+}
+
+void AudioMixer::writeFile(void *mixer, const short *frames, unsigned int count) {
+    AudioMixer *self = static_cast<AudioMixer*>(mixer);
+    self->fileFrames += std::fwrite(frames, sizeof(short) * 2, count, self->file);
+}
+
+void AudioMixer::discard(void *, const short *, unsigned int) {
+}
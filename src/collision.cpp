@@ -0,0 +1,245 @@
+#include "../include/collision.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// far enough away that the squared distance overflows to infinity
+const float PARKED = -1.0e30f;
+
+void BoxBounds::Clear() {
+    this->MinX.clear();
+    this->MinY.clear();
+    this->MaxX.clear();
+    this->MaxY.clear();
+    this->Count = 0;
+}
+
+unsigned int BoxBounds::Add(glm::vec2 position, glm::vec2 size) {
+    if (this->Count == this->MinX.size()) {
+        unsigned int padded = this->Count + COLLISION_PADDING;
+        this->MinX.resize(padded, PARKED);
+        this->MinY.resize(padded, PARKED);
+        this->MaxX.resize(padded, PARKED);
+        this->MaxY.resize(padded, PARKED);
+    }
+    this->Set(this->Count, position, size);
+    return this->Count++;
+}
+
+void BoxBounds::Set(unsigned int index, glm::vec2 position, glm::vec2 size) {
+    this->MinX[index] = position.x;
+    this->MinY[index] = position.y;
+    this->MaxX[index] = position.x + size.x;
+    this->MaxY[index] = position.y + size.y;
+}
+
+void BoxBounds::Disable(unsigned int index) {
+    this->MinX[index] = this->MaxX[index] = PARKED;
+    this->MinY[index] = this->MaxY[index] = PARKED;
+}
+
+size_t BoxBounds::Bytes() const {
+    return (this->MinX.capacity() + this->MinY.capacity() + this->MaxX.capacity() + this->MaxY.capacity()) * sizeof(float);
+}
+
+Direction SignDirection(glm::vec2 target) {
+    // same winner as the largest dot product against up/right/down/left, ties resolved in that order
+    float x = std::abs(target.x), y = std::abs(target.y);
+    if (target.y > 0.0f && y >= x)
+        return UP;
+    if (target.x > 0.0f && x >= y)
+        return RIGHT;
+    if (target.y < 0.0f && y >= x)
+        return DOWN;
+    if (target.x < 0.0f)
+        return LEFT;
+    return UP;
+}
+
+Collision CollideCircleAABB(glm::vec2 center, float radius, glm::vec2 min, glm::vec2 max) {
+    glm::vec2 closest(std::min(std::max(center.x, min.x), max.x), std::min(std::max(center.y, min.y), max.y));
+    glm::vec2 difference = closest - center;
+    if (difference.x * difference.x + difference.y * difference.y <= radius * radius)
+        return std::make_tuple(true, SignDirection(difference), difference);
+    else
+        return std::make_tuple(false, UP, glm::vec2(0.0f, 0.0f));
+}
+
+// clips the ray's parameter range against one axis of a box, false if it never enters
+static bool clipSlab(float origin, float motion, float lo, float hi, glm::vec2 axis, float &enter, float &exit, glm::vec2 &side) {
+    if (motion == 0.0f)
+        return origin >= lo && origin <= hi;
+    float t0 = (lo - origin) / motion, t1 = (hi - origin) / motion;
+    float sign = -1.0f;
+    if (t0 > t1) {
+        std::swap(t0, t1);
+        sign = 1.0f;
+    }
+    if (t0 > enter) {
+        enter = t0;
+        side = axis * sign;
+    }
+    exit = std::min(exit, t1);
+    return true;
+}
+
+bool SweepCircleAABB(glm::vec2 center, float radius, glm::vec2 motion, glm::vec2 min, glm::vec2 max, float &time, glm::vec2 &normal) {
+    glm::vec2 closest(std::min(std::max(center.x, min.x), max.x), std::min(std::max(center.y, min.y), max.y));
+    glm::vec2 offset = center - closest;
+    float distance2 = offset.x * offset.x + offset.y * offset.y;
+    if (distance2 < radius * radius) {
+        if (distance2 > 0.0f)
+            normal = offset / std::sqrt(distance2);
+        else {
+            // centre inside the box, push out through the nearest side
+            float left = center.x - min.x, right = max.x - center.x, top = center.y - min.y, bottom = max.y - center.y;
+            float nearest = std::min(std::min(left, right), std::min(top, bottom));
+            normal = nearest == left ? glm::vec2(-1.0f, 0.0f) : nearest == right ? glm::vec2(1.0f, 0.0f)
+                   : nearest == top ? glm::vec2(0.0f, -1.0f) : glm::vec2(0.0f, 1.0f);
+        }
+        if (motion.x * normal.x + motion.y * normal.y >= 0.0f)
+            return false;
+        time = 0.0f;
+        return true;
+    }
+    if (motion.x == 0.0f && motion.y == 0.0f)
+        return false;
+    // the centre reaches the box grown by radius exactly when the circle reaches the box,
+    // so trace the centre against the grown box and fix up its rounded corners after
+    float enter = -1e30f, exit = 1e30f;
+    glm::vec2 side(0.0f);
+    if (!clipSlab(center.x, motion.x, min.x - radius, max.x + radius, glm::vec2(1.0f, 0.0f), enter, exit, side))
+        return false;
+    if (!clipSlab(center.y, motion.y, min.y - radius, max.y + radius, glm::vec2(0.0f, 1.0f), enter, exit, side))
+        return false;
+    if (enter > exit || enter > 1.0f || exit <= 0.0f)
+        return false;
+    enter = std::max(enter, 0.0f);
+    glm::vec2 hit = center + motion * enter;
+    if ((hit.x >= min.x && hit.x <= max.x) || (hit.y >= min.y && hit.y <= max.y)) {
+        time = enter;
+        normal = side;
+        return true;
+    }
+    // corner region, intersect with the circle of radius around that corner instead;
+    // missing it means leaving the grown box again through its outer edges
+    // solved from where the centre enters the grown box, next to the corner, so b * b - a * c
+    // does not cancel away the precision it does from a start far off
+    glm::vec2 corner(hit.x < min.x ? min.x : max.x, hit.y < min.y ? min.y : max.y);
+    glm::vec2 d = hit - corner;
+    float a = motion.x * motion.x + motion.y * motion.y;
+    float b = d.x * motion.x + d.y * motion.y;
+    float c = d.x * d.x + d.y * d.y - radius * radius;
+    float discriminant = b * b - a * c;
+    if (a == 0.0f || discriminant < 0.0f)
+        return false;
+    // an entry point that rounds to just inside the corner circle starts at contact
+    float root = std::sqrt(discriminant);
+    if (-b + root < 0.0f)
+        return false;
+    float t = std::max((-b - root) / a, 0.0f);
+    if (enter + t > 1.0f)
+        return false;
+    time = enter + t;
+    normal = (d + motion * t) / radius;
+    return true;
+}
+
+unsigned int CollideCircleBoxesScalar(const BoxBounds &bounds, glm::vec2 center, float radius, unsigned int *hits, unsigned int maxHits, unsigned int first) {
+    float r2 = radius * radius;
+    unsigned int count = 0;
+    for (unsigned int i = first; i < bounds.Count && count < maxHits; ++i) {
+        float dx = std::min(std::max(center.x, bounds.MinX[i]), bounds.MaxX[i]) - center.x;
+        float dy = std::min(std::max(center.y, bounds.MinY[i]), bounds.MaxY[i]) - center.y;
+        if (dx * dx + dy * dy <= r2)
+            hits[count++] = i;
+    }
+    return count;
+}
+
+// appends the lanes set in mask for the block starting at base, boxes before first are skipped
+static unsigned int collectHits(unsigned int mask, unsigned int base, unsigned int first, unsigned int boxCount, unsigned int *hits,
+                                unsigned int count, unsigned int maxHits) {
+    for (unsigned int lane = 0; mask != 0 && count < maxHits; ++lane, mask >>= 1)
+        if ((mask & 1) && base + lane >= first && base + lane < boxCount)
+            hits[count++] = base + lane;
+    return count;
+}
+
+// blocks start on a multiple of their width, which the padded storage always holds whole
+unsigned int CollideCircleBoxes(const BoxBounds &bounds, glm::vec2 center, float radius, unsigned int *hits, unsigned int maxHits, unsigned int first) {
+#if defined(__AVX2__)
+    __m256 cx = _mm256_set1_ps(center.x), cy = _mm256_set1_ps(center.y);
+    __m256 r2 = _mm256_set1_ps(radius * radius);
+    unsigned int count = 0;
+    for (unsigned int i = first & ~7u; i < bounds.Count && count < maxHits; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_min_ps(_mm256_max_ps(cx, _mm256_loadu_ps(&bounds.MinX[i])), _mm256_loadu_ps(&bounds.MaxX[i])), cx);
+        __m256 dy = _mm256_sub_ps(_mm256_min_ps(_mm256_max_ps(cy, _mm256_loadu_ps(&bounds.MinY[i])), _mm256_loadu_ps(&bounds.MaxY[i])), cy);
+        __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        unsigned int mask = _mm256_movemask_ps(_mm256_cmp_ps(d2, r2, _CMP_LE_OQ));
+        count = collectHits(mask, i, first, bounds.Count, hits, count, maxHits);
+    }
+    return count;
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y);
+    __m128 r2 = _mm_set1_ps(radius * radius);
+    unsigned int count = 0;
+    for (unsigned int i = first & ~3u; i < bounds.Count && count < maxHits; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_min_ps(_mm_max_ps(cx, _mm_loadu_ps(&bounds.MinX[i])), _mm_loadu_ps(&bounds.MaxX[i])), cx);
+        __m128 dy = _mm_sub_ps(_mm_min_ps(_mm_max_ps(cy, _mm_loadu_ps(&bounds.MinY[i])), _mm_loadu_ps(&bounds.MaxY[i])), cy);
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        unsigned int mask = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+        count = collectHits(mask, i, first, bounds.Count, hits, count, maxHits);
+    }
+    return count;
+#elif defined(__ARM_NEON)
+    float32x4_t cx = vdupq_n_f32(center.x), cy = vdupq_n_f32(center.y);
+    float32x4_t r2 = vdupq_n_f32(radius * radius);
+    unsigned int count = 0;
+    for (unsigned int i = first & ~3u; i < bounds.Count && count < maxHits; i += 4) {
+        float32x4_t dx = vsubq_f32(vminq_f32(vmaxq_f32(cx, vld1q_f32(&bounds.MinX[i])), vld1q_f32(&bounds.MaxX[i])), cx);
+        float32x4_t dy = vsubq_f32(vminq_f32(vmaxq_f32(cy, vld1q_f32(&bounds.MinY[i])), vld1q_f32(&bounds.MaxY[i])), cy);
+        float32x4_t d2 = vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy));
+        uint32x4_t  le = vcleq_f32(d2, r2);
+        unsigned int mask = (vgetq_lane_u32(le, 0) & 1) | (vgetq_lane_u32(le, 1) & 2) | (vgetq_lane_u32(le, 2) & 4) | (vgetq_lane_u32(le, 3) & 8);
+        count = collectHits(mask, i, first, bounds.Count, hits, count, maxHits);
+    }
+    return count;
+#else
+    return CollideCircleBoxesScalar(bounds, center, radius, hits, maxHits, first);
+#endif
+}
+
+unsigned int SweepCircleBoxes(const BoxBounds &bounds, glm::vec2 center, float radius, glm::vec2 motion, BoxFilter filter, void *context,
+                              float &time, glm::vec2 &normal) {
+    // broad phase with a circle around the whole path, in batches until every box in it was tested
+    glm::vec2 middle = center + motion * 0.5f;
+    float reach = radius + glm::length(motion) * 0.5f;
+    unsigned int candidates[SWEEP_BATCH];
+    unsigned int hit = NO_BOX, first = 0, count;
+    do {
+        count = CollideCircleBoxes(bounds, middle, reach, candidates, SWEEP_BATCH, first);
+        for (unsigned int i = 0; i < count; ++i) {
+            unsigned int box = candidates[i];
+            if (filter && !filter(context, box))
+                continue;
+            float t;
+            glm::vec2 n;
+            glm::vec2 min(bounds.MinX[box], bounds.MinY[box]), max(bounds.MaxX[box], bounds.MaxY[box]);
+            if (SweepCircleAABB(center, radius, motion, min, max, t, n) && t < time) {
+                time = t;
+                normal = n;
+                hit = box;
+            }
+        }
+        if (count > 0)
+            first = candidates[count - 1] + 1;
+    } while (count == SWEEP_BATCH);
+    return hit;
+}
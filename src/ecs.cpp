@@ -0,0 +1,135 @@
+#include "../include/ecs.h"
+
+
+unsigned int BrickTable::Add(glm::vec2 position, glm::vec2 size, const Texture2D &texture, glm::vec3 color, bool solid) {
+    Transform transform = { position, size, 0.0f };
+    Sprite sprite = { &texture, color };
+    BrickState state = { solid, false };
+    this->Transforms.push_back(transform);
+    this->Sprites.push_back(sprite);
+    this->States.push_back(state);
+    return this->Bounds.Add(position, size);
+}
+
+void BrickTable::Clear() {
+    this->Transforms.clear();
+    this->Sprites.clear();
+    this->States.clear();
+    this->Bounds.Clear();
+}
+
+size_t BrickTable::Bytes() const {
+    return this->Transforms.capacity() * sizeof(Transform) + this->Sprites.capacity() * sizeof(Sprite)
+        + this->States.capacity() * sizeof(BrickState) + this->Bounds.Bytes();
+}
+
+unsigned int BallTable::Add(glm::vec2 position, float radius, glm::vec2 velocity, const Texture2D &texture) {
+    Transform transform = { position, glm::vec2(radius * 2.0f), 0.0f };
+    Motion motion = { velocity };
+    Sprite sprite = { &texture, glm::vec3(1.0f) };
+    BallState state = { radius, true, false, false };
+    this->Transforms.push_back(transform);
+    this->Motions.push_back(motion);
+    this->Sprites.push_back(sprite);
+    this->States.push_back(state);
+    return this->States.size() - 1;
+}
+
+void BallTable::Reset(unsigned int ball, glm::vec2 position, glm::vec2 velocity) {
+    this->Transforms[ball].Position = position;
+    this->Motions[ball].Velocity = velocity;
+    this->States[ball].Stuck = true;
+    this->States[ball].Sticky = false;
+    this->States[ball].PassThrough = false;
+}
+
+void BallTable::Remove(unsigned int ball) {
+    unsigned int last = this->States.size() - 1;
+    this->Transforms[ball] = this->Transforms[last];
+    this->Motions[ball] = this->Motions[last];
+    this->Sprites[ball] = this->Sprites[last];
+    this->States[ball] = this->States[last];
+    this->Transforms.pop_back();
+    this->Motions.pop_back();
+    this->Sprites.pop_back();
+    this->States.pop_back();
+}
+
+void BallTable::Reserve(unsigned int count) {
+    this->Transforms.reserve(count);
+    this->Motions.reserve(count);
+    this->Sprites.reserve(count);
+    this->States.reserve(count);
+}
+
+void BallTable::Clear() {
+    this->Transforms.clear();
+    this->Motions.clear();
+    this->Sprites.clear();
+    this->States.clear();
+}
+
+size_t BallTable::Bytes() const {
+    return this->Transforms.capacity() * sizeof(Transform) + this->Motions.capacity() * sizeof(Motion)
+        + this->Sprites.capacity() * sizeof(Sprite) + this->States.capacity() * sizeof(BallState);
+}
+
+unsigned int PowerUpTable::Add(PowerUpType type, glm::vec2 position, const Texture2D &texture) {
+    Transform transform = { position, POWERUP_SIZE, 0.0f };
+    Motion motion = { POWERUP_VELOCITY };
+    Sprite sprite = { &texture, POWERUP_DEFS[type].Color };
+    this->Transforms.push_back(transform);
+    this->Motions.push_back(motion);
+    this->Sprites.push_back(sprite);
+    this->Types.push_back(type);
+    return this->Types.size() - 1;
+}
+
+void PowerUpTable::Remove(unsigned int powerUp) {
+    unsigned int last = this->Types.size() - 1;
+    this->Transforms[powerUp] = this->Transforms[last];
+    this->Motions[powerUp] = this->Motions[last];
+    this->Sprites[powerUp] = this->Sprites[last];
+    this->Types[powerUp] = this->Types[last];
+    this->Transforms.pop_back();
+    this->Motions.pop_back();
+    this->Sprites.pop_back();
+    this->Types.pop_back();
+}
+
+void PowerUpTable::Reserve(unsigned int count) {
+    this->Transforms.reserve(count);
+    this->Motions.reserve(count);
+    this->Sprites.reserve(count);
+    this->Types.reserve(count);
+}
+
+void PowerUpTable::Clear() {
+    this->Transforms.clear();
+    this->Motions.clear();
+    this->Sprites.clear();
+    this->Types.clear();
+}
+
+size_t PowerUpTable::Bytes() const {
+    return this->Transforms.capacity() * sizeof(Transform) + this->Motions.capacity() * sizeof(Motion)
+        + this->Sprites.capacity() * sizeof(Sprite) + this->Types.capacity() * sizeof(PowerUpType);
+}
+
+void MoveBodies(std::vector<Transform> &transforms, const std::vector<Motion> &motions, float dt) {
+    for (unsigned int i = 0; i < transforms.size(); ++i)
+        transforms[i].Position += motions[i].Velocity * dt;
+}
+
+void DrawSprites(SpriteRenderer &renderer, const std::vector<Transform> &transforms, const std::vector<Sprite> &sprites) {
+    for (unsigned int i = 0; i < transforms.size(); ++i)
+        renderer.DrawSprite(*sprites[i].Texture, transforms[i].Position, transforms[i].Size, transforms[i].Rotation, sprites[i].Color);
+}
+
+bool Overlaps(const Transform &one, const Transform &two) {
+    bool collisionX = one.Position.x + one.Size.x >= two.Position.x &&
+        two.Position.x + two.Size.x >= one.Position.x;
+    bool collisionY = one.Position.y + one.Size.y >= two.Position.y &&
+        two.Position.y + two.Size.y >= one.Position.y;
+    return collisionX && collisionY;
+}
@@ -0,0 +1,258 @@
+#include "../include/flight_recorder.h"
+#include "../include/log.h"
+
+#include <cstdio>
+#include <cstring>
+
+const unsigned int NO_FRAME       = 0xFFFFFFFF;
+const unsigned int FLIGHT_VERSION = 2;
+// sanity limit for array lengths read back from a dump
+const unsigned int FLIGHT_MAX_COUNT = 1 << 24;
+
+struct FlightHeader {
+    char         Magic[4]; // "PFLT"
+    unsigned int Version;
+    unsigned int HitchFrame;
+    float        Budget;
+    unsigned int FrameCount, EventCount;
+};
+
+FlightRecorder::FlightRecorder(const Game &game, const std::string &directory, float budget)
+    : Budget(budget), Dumps(0), Missed(0), directory(directory), frames(), events(), frame(0), eventHead(0), hitch(0), dumpFrame(0),
+      hitchPending(false), writing(false), quit(false)
+{
+    // everything a dump needs is sized now, recording never allocates
+    for (unsigned int i = 0; i < FLIGHT_KEYFRAMES; ++i) {
+        game.ReserveSnapshot(this->keyframes[i]);
+        this->keyframeFrames[i] = NO_FRAME;
+    }
+    game.ReserveSnapshot(this->dump.Start);
+    this->dump.Frames.reserve(FLIGHT_FRAMES);
+    this->dump.Events.reserve(FLIGHT_EVENTS);
+    MemoryScope memoryScope(MEMORY_RECORDER);
+    size_t bytes = sizeof(FlightRecorder) + this->dump.Frames.capacity() * sizeof(FrameRecord) + this->dump.Events.capacity() * sizeof(InputEvent);
+    for (unsigned int i = 0; i <= FLIGHT_KEYFRAMES; ++i) {
+        const GameSnapshot &snapshot = i < FLIGHT_KEYFRAMES ? this->keyframes[i] : this->dump.Start;
+        bytes += snapshot.Balls.Bytes() + snapshot.PowerUps.Bytes() + snapshot.Timers.capacity() * sizeof(GameTimer) + snapshot.Destroyed.capacity();
+    }
+    this->memory.Track("rings and snapshots", bytes);
+    this->beginFrame();
+    this->writer = std::thread(&FlightRecorder::run, this);
+}
+
+FlightRecorder::~FlightRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->quit = true;
+    }
+    this->wake.notify_one();
+    this->writer.join();
+}
+
+void FlightRecorder::beginFrame() {
+    FrameRecord &record = this->Current();
+    record = FrameRecord();
+    record.Frame = this->frame;
+    record.InputTime = -1.0;
+    record.LatchTime = -1.0;
+    record.FirstEvent = this->eventHead;
+}
+
+void FlightRecorder::RecordEvent(const InputEvent &event) {
+    this->events[this->eventHead++ % FLIGHT_EVENTS] = event;
+    ++this->Current().EventCount;
+}
+
+GameSnapshot *FlightRecorder::Keyframe() {
+    if (this->frame % FLIGHT_KEYFRAME != 0)
+        return nullptr;
+    unsigned int slot = this->frame / FLIGHT_KEYFRAME % FLIGHT_KEYFRAMES;
+    this->keyframeFrames[slot] = this->frame;
+    return &this->keyframes[slot];
+}
+
+void FlightRecorder::EndFrame(const PerfSample &perf) {
+    this->Current().Perf = perf;
+    // later hitches inside the window of a pending one ride along in its dump
+    if (this->Budget > 0.0f && perf.FrameTime > this->Budget && !this->hitchPending) {
+        this->hitchPending = true;
+        this->hitch = this->frame;
+        this->dumpFrame = this->frame + FLIGHT_AFTER;
+    }
+    if (this->hitchPending && this->frame == this->dumpFrame) {
+        this->hitchPending = false;
+        if (this->writing.load(std::memory_order_acquire) || !this->copyWindow())
+            ++this->Missed;
+        else {
+            ++this->Dumps;
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->writing.store(true, std::memory_order_release);
+            }
+            this->wake.notify_one();
+        }
+    }
+    ++this->frame;
+    this->beginFrame();
+}
+
+bool FlightRecorder::copyWindow() {
+    // from the oldest snapshot whose frames are all still in the ring up to now
+    unsigned int last = this->frame, first = NO_FRAME, slot = 0;
+    for (unsigned int i = 0; i < FLIGHT_KEYFRAMES; ++i) {
+        unsigned int keyframe = this->keyframeFrames[i];
+        if (keyframe != NO_FRAME && keyframe <= last && last - keyframe < FLIGHT_FRAMES && (first == NO_FRAME || keyframe < first)) {
+            first = keyframe;
+            slot = i;
+        }
+    }
+    if (first == NO_FRAME)
+        return false;
+    unsigned int firstEvent = this->frames[first % FLIGHT_FRAMES].FirstEvent;
+    if (this->eventHead - firstEvent > FLIGHT_EVENTS)
+        return false; // overwritten already, the window would not replay
+    this->dump.HitchFrame = this->hitch;
+    this->dump.Budget = this->Budget;
+    this->dump.Start = this->keyframes[slot];
+    this->dump.Frames.clear();
+    for (unsigned int f = first; f <= last; ++f) {
+        this->dump.Frames.push_back(this->frames[f % FLIGHT_FRAMES]);
+        this->dump.Frames.back().FirstEvent -= firstEvent;
+    }
+    this->dump.Events.clear();
+    for (unsigned int e = firstEvent; e != this->eventHead; ++e)
+        this->dump.Events.push_back(this->events[e % FLIGHT_EVENTS]);
+    return true;
+}
+
+void FlightRecorder::run() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->wake.wait(lock, [this] { return this->quit || this->writing.load(std::memory_order_acquire); });
+        if (!this->writing.load(std::memory_order_acquire))
+            return;
+        lock.unlock();
+        // stdio and the log only, the game's allocation tracking is not disturbed
+        char file[1024];
+        std::snprintf(file, sizeof(file), "%s/hitch-%u.flight", this->directory.c_str(), this->dump.HitchFrame);
+        const FrameRecord &hitch = this->dump.Frames[this->dump.HitchFrame - this->dump.Frames[0].Frame];
+        if (this->write(file))
+            LOG_WARNING("FLIGHT", "Hitch", {{ "frame", this->dump.HitchFrame }, { "ms", hitch.Perf.FrameTime }, { "budget_ms", this->dump.Budget },
+                { "frames", (unsigned int)this->dump.Frames.size() }, { "file", file }});
+        else
+            LOG_ERROR("FLIGHT", "Failed to write", {{ "file", file }});
+        this->writing.store(false, std::memory_order_release);
+        lock.lock();
+    }
+}
+
+// raw values and arrays in host byte order, dumps are replayed by the build that wrote them
+
+template <typename T>
+static bool put(FILE *out, const T &value) {
+    return std::fwrite(&value, sizeof(T), 1, out) == 1;
+}
+
+template <typename T>
+static bool putArray(FILE *out, const std::vector<T> &values) {
+    unsigned int count = values.size();
+    return put(out, count) && (count == 0 || std::fwrite(values.data(), sizeof(T), count, out) == count);
+}
+
+template <typename T>
+static bool get(FILE *in, T &value) {
+    return std::fread(&value, sizeof(T), 1, in) == 1;
+}
+
+template <typename T>
+static bool getArray(FILE *in, std::vector<T> &values) {
+    unsigned int count;
+    if (!get(in, count) || count > FLIGHT_MAX_COUNT)
+        return false;
+    values.resize(count);
+    return count == 0 || std::fread(values.data(), sizeof(T), count, in) == count;
+}
+
+// sprites are written by color, the textures are the game's to pick on Restore
+static bool putColors(FILE *out, const std::vector<Sprite> &sprites) {
+    bool ok = put(out, (unsigned int)sprites.size());
+    for (const Sprite &sprite : sprites)
+        ok = ok && put(out, sprite.Color);
+    return ok;
+}
+
+static bool getColors(FILE *in, std::vector<Sprite> &sprites) {
+    unsigned int count;
+    if (!get(in, count) || count > FLIGHT_MAX_COUNT)
+        return false;
+    sprites.resize(count);
+    bool ok = true;
+    for (Sprite &sprite : sprites) {
+        sprite.Texture = nullptr;
+        ok = ok && get(in, sprite.Color);
+    }
+    return ok;
+}
+
+static bool putSnapshot(FILE *out, const GameSnapshot &snapshot) {
+    return put(out, snapshot.State) && put(out, snapshot.Level) && put(out, snapshot.StressBalls) && put(out, snapshot.Keys)
+        && put(out, snapshot.InputTime) && put(out, snapshot.Random) && put(out, snapshot.Paddle) && put(out, snapshot.PaddleColor)
+        && putArray(out, snapshot.Balls.Transforms) && putArray(out, snapshot.Balls.Motions) && putColors(out, snapshot.Balls.Sprites)
+        && putArray(out, snapshot.Balls.States)
+        && putArray(out, snapshot.PowerUps.Transforms) && putArray(out, snapshot.PowerUps.Motions) && putColors(out, snapshot.PowerUps.Sprites)
+        && putArray(out, snapshot.PowerUps.Types)
+        && put(out, snapshot.ActiveEffects) && put(out, snapshot.Shake) && put(out, snapshot.Confuse) && put(out, snapshot.Chaos)
+        && put(out, snapshot.TimerElapsed) && put(out, snapshot.TimerTick) && putArray(out, snapshot.Timers) && putArray(out, snapshot.Destroyed);
+}
+
+static bool getSnapshot(FILE *in, GameSnapshot &snapshot) {
+    bool ok = get(in, snapshot.State) && get(in, snapshot.Level) && get(in, snapshot.StressBalls) && get(in, snapshot.Keys)
+        && get(in, snapshot.InputTime) && get(in, snapshot.Random) && get(in, snapshot.Paddle) && get(in, snapshot.PaddleColor)
+        && getArray(in, snapshot.Balls.Transforms) && getArray(in, snapshot.Balls.Motions) && getColors(in, snapshot.Balls.Sprites)
+        && getArray(in, snapshot.Balls.States)
+        && getArray(in, snapshot.PowerUps.Transforms) && getArray(in, snapshot.PowerUps.Motions) && getColors(in, snapshot.PowerUps.Sprites)
+        && getArray(in, snapshot.PowerUps.Types)
+        && get(in, snapshot.ActiveEffects) && get(in, snapshot.Shake) && get(in, snapshot.Confuse) && get(in, snapshot.Chaos)
+        && get(in, snapshot.TimerElapsed) && get(in, snapshot.TimerTick) && getArray(in, snapshot.Timers) && getArray(in, snapshot.Destroyed);
+    // the columns of a table must agree
+    unsigned int balls = snapshot.Balls.States.size(), powerUps = snapshot.PowerUps.Types.size();
+    return ok && snapshot.Balls.Transforms.size() == balls && snapshot.Balls.Motions.size() == balls && snapshot.Balls.Sprites.size() == balls
+        && snapshot.PowerUps.Transforms.size() == powerUps && snapshot.PowerUps.Motions.size() == powerUps && snapshot.PowerUps.Sprites.size() == powerUps;
+}
+
+bool FlightRecorder::write(const char *file) const {
+    FILE *out = std::fopen(file, "wb");
+    if (!out)
+        return false;
+    FlightHeader header = { { 'P', 'F', 'L', 'T' }, FLIGHT_VERSION, this->dump.HitchFrame, this->dump.Budget,
+        (unsigned int)this->dump.Frames.size(), (unsigned int)this->dump.Events.size() };
+    bool ok = put(out, header) && putSnapshot(out, this->dump.Start)
+        && std::fwrite(this->dump.Frames.data(), sizeof(FrameRecord), header.FrameCount, out) == header.FrameCount
+        && (header.EventCount == 0 || std::fwrite(this->dump.Events.data(), sizeof(InputEvent), header.EventCount, out) == header.EventCount);
+    return std::fclose(out) == 0 && ok;
+}
+
+bool FlightRecorder::Load(const char *file, FlightDump &dump) {
+    FILE *in = std::fopen(file, "rb");
+    if (!in)
+        return false;
+    FlightHeader header;
+    bool ok = get(in, header) && std::memcmp(header.Magic, "PFLT", 4) == 0 && header.Version == FLIGHT_VERSION
+        && header.FrameCount > 0 && header.FrameCount <= FLIGHT_MAX_COUNT && header.EventCount <= FLIGHT_MAX_COUNT
+        && getSnapshot(in, dump.Start);
+    if (ok) {
+        dump.HitchFrame = header.HitchFrame;
+        dump.Budget = header.Budget;
+        dump.Frames.resize(header.FrameCount);
+        dump.Events.resize(header.EventCount);
+        ok = std::fread(dump.Frames.data(), sizeof(FrameRecord), header.FrameCount, in) == header.FrameCount
+            && (header.EventCount == 0 || std::fread(dump.Events.data(), sizeof(InputEvent), header.EventCount, in) == header.EventCount);
+    }
+    std::fclose(in);
+    if (!ok)
+        return false;
+    for (const FrameRecord &record : dump.Frames)
+        if (record.FirstEvent > dump.Events.size() || record.EventCount > dump.Events.size() - record.FirstEvent)
+            return false;
+    return true;
+}
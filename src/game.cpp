@@ -1,132 +1,410 @@
 #include "../include/game.h"
 #include "../include/resource_manager.h"
 #include "../include/sprite_renderer.h"
-#include "../include/game_object.h"
-#include "../include/ball_object.h"
 #include "../include/particle_generator.h"
 #include "../include/post_processor.h"
 #include "../include/power_up.h"
+#include "../include/alloc_tracker.h"
+#include "../include/worker_pool.h"
+#include "../include/perf_hud.h"
+#include "../include/gl_backend.h"
+#include "../include/flight_recorder.h"
+#include "../include/rewind_buffer.h"
+#include "../include/state_stream.h"
+#include "../include/audio_mixer.h"
+#include "../include/log.h"
+
+#include "glm/gtc/matrix_transform.hpp"
 
 #include <algorithm>
-#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <utility>
 
 SpriteRenderer    *Renderer;
 SpriteRenderer    *bgRenderer;
-GameObject        *Player;
-BallObject        *Ball;
 ParticleGenerator *Particles;
 PostProcessor     *Effects;
+WorkerPool        *Workers;
+StreamBuffer      *Stream;
+PerfHud           *Hud;
+FlightRecorder    *Recorder;
+RewindBuffer      *History;
+StateStream       *Broadcast;
+AudioMixer        *Audio;
+
+unsigned int BallTrail, BrickShatter, PaddleSparks, PowerUpTrail;
+SoundId      BrickSound, SolidSound, PaddleSound, PowerUpSound;
+// when the voices run out, power-ups are heard over the paddle and the paddle over bricks
+const unsigned int BRICK_PRIORITY   = 0;
+const unsigned int PADDLE_PRIORITY  = 1;
+const unsigned int POWERUP_PRIORITY = 2;
+
+// resources used every frame are looked up once, name lookups build std::string temporaries
+Shader            *BackgroundShader;
+Shader            *BrickShader;
+const Texture2D   *BackgroundTexture;
+const Texture2D   *BallTexture;
+const Texture2D   *PowerUpTextures[POWERUP_TYPE_COUNT];
+
+// what a ball sweep ran into, besides brick indices
+const unsigned int NO_HIT     = 0xFFFFFFFF;
+const unsigned int HIT_WALL   = 0xFFFFFFFE;
+const unsigned int HIT_PADDLE = 0xFFFFFFFD;
 
 Game::Game(unsigned int width, unsigned int height) 
-    : State(GAME_ACTIVE), Keys(), Width(width), Height(height)
+    : State(GAME_ACTIVE), Keys(), Width(width), Height(height), Paddle(), PaddleSprite(), ActiveEffects(), Timers(MAX_TIMERS), StressBalls(0), LateLatch(false), MeasureLatency(false), GPUBudget(DEFAULT_GPU_BUDGET), AAMode(AA_MSAA_4), ShowPerfHud(false), HitchBudget(DEFAULT_HITCH_BUDGET), HitchDirectory("."), RewindSeconds(DEFAULT_REWIND_SECONDS), stepTime(0.0f), inputTime(-1.0), undrawnInput(-1.0), drawnInput(-1.0), latencySum(0.0), latencyMin(1e9), latencyMax(0.0), latencyReport(0.0), latencyCount(0), shakeTimer(NO_TIMER)
 { 
 
 }
 
 Game::~Game() {
-    delete Ball;
-    delete Player;
-    // delete Renderer; // TODO: fix segfault
-    // delete bgRenderer;
+    this->Clear();
+}
+
+void Game::Clear() {
+    // the levels own their brick buffers
+    this->Levels.clear();
+    delete Renderer;
+    delete bgRenderer;
+    delete Particles;
+    delete Effects;
+    delete Workers;
+    delete Recorder;
+    delete History;
+    delete Broadcast;
+    delete Audio;
+    delete Hud;
+    delete Stream;
+    Renderer = nullptr;
+    bgRenderer = nullptr;
+    Particles = nullptr;
+    Effects = nullptr;
+    Workers = nullptr;
+    Recorder = nullptr;
+    History = nullptr;
+    Broadcast = nullptr;
+    Audio = nullptr;
+    Hud = nullptr;
+    Stream = nullptr;
+    this->entityMemory.Reset();
+    this->tickMemory.Reset();
 }
 
 void Game::Init() {
-    ResourceManager::LoadShader("../shaders/sprite.vs", "../shaders/sprite.fs", nullptr, "sprite");
-    ResourceManager::LoadShader("../shaders/background.vs", "../shaders/background.fs", nullptr, "background");
-    ResourceManager::LoadShader("../shaders/particle_trail_A.vs", "../shaders/particle_trail_A.fs", nullptr, "pTrailA");
-    ResourceManager::LoadShader("../shaders/post_processing.vs", "../shaders/post_processing.fs", nullptr, "postprocessing");
+    ResourceManager::LoadShader("shaders/sprite.vs", "shaders/sprite.fs", nullptr, "sprite");
+    ResourceManager::LoadShader("shaders/background.vs", "shaders/background.fs", nullptr, "background");
+    ResourceManager::LoadShader("shaders/brick.vs", "shaders/brick.fs", nullptr, "brick");
+    ResourceManager::LoadShader("shaders/particle_trail_A.vs", "shaders/particle_trail_A.fs", nullptr, "pTrailA");
+    ResourceManager::LoadShader("shaders/post_processing.vs", "shaders/post_processing.fs", nullptr, "postprocessing");
+    ResourceManager::LoadShader("shaders/fxaa.vs", "shaders/fxaa.fs", nullptr, "fxaa");
+    ResourceManager::LoadShader("shaders/text.vs", "shaders/sprite.fs", nullptr, "text");
+    ResourceManager::LoadShader("shaders/particle_trail_A_gpu.vs", "shaders/particle_trail_A.fs", nullptr, "pTrailA_gpu");
+    const char *particleVaryings[] = { "outPosition", "outVelocity", "outColor", "outLife", "outFade" };
+    ResourceManager::LoadFeedbackShader("shaders/particle_update.vs", particleVaryings, 5, "pUpdate");
 
     glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(this->Width), 
         static_cast<float>(this->Height), 0.0f, -1.0f, 1.0f);
 
     ResourceManager::GetShader("sprite").Use().SetInteger("image", 0);
     ResourceManager::GetShader("sprite").SetMatrix4("projection", projection);
+    Shader &brick = ResourceManager::GetShader("brick").Use();
+    const char *brickImages[BRICK_TEXTURES] = { "images[0]", "images[1]", "images[2]", "images[3]" };
+    for (unsigned int i = 0; i < BRICK_TEXTURES; ++i)
+        brick.SetInteger(brickImages[i], i);
+    brick.SetMatrix4("projection", projection);
     ResourceManager::GetShader("background").Use().SetInteger("image", 0);
     ResourceManager::GetShader("background").SetMatrix4("projection", projection);
     ResourceManager::GetShader("background").SetFloat("aspect", (float)this->Width / this->Height);
     ResourceManager::GetShader("pTrailA").Use().SetInteger("sprite", 0);
     ResourceManager::GetShader("pTrailA").SetMatrix4("projection", projection);
-    ResourceManager::LoadTexture("../resources/textures/background.jpg", false, "background");
-    ResourceManager::LoadTexture("../resources/textures/pong.png", true, "pong");
-    ResourceManager::LoadTexture("../resources/textures/block.png", false, "block");
-    ResourceManager::LoadTexture("../resources/textures/block_solid.png", false, "block_solid");
-    ResourceManager::LoadTexture("../resources/textures/paddle.png", true, "paddle");
-    ResourceManager::LoadTexture("../resources/textures/weed.png", true, "particle");
-    ResourceManager::LoadTexture("../resources/textures/speed.png", true, "powerup_speed");
-    ResourceManager::LoadTexture("../resources/textures/sticky.png", true, "powerup_sticky");
-    ResourceManager::LoadTexture("../resources/textures/pass-through.png", true, "powerup_passthrough");
-    ResourceManager::LoadTexture("../resources/textures/grow.png", true, "powerup_grow");
-    ResourceManager::LoadTexture("../resources/textures/confuse.png", true, "powerup_confuse");
-    ResourceManager::LoadTexture("../resources/textures/chaos.png", true, "powerup_chaos");
-
-    Renderer = new SpriteRenderer(ResourceManager::GetShader("sprite"));
-    bgRenderer = new SpriteRenderer(ResourceManager::GetShader("background"));
-    Particles = new ParticleGenerator(ResourceManager::GetShader("pTrailA"), ResourceManager::GetTexture("particle"), 500);
-    Effects = new PostProcessor(ResourceManager::GetShader("postprocessing"), this->Width, this->Height);
-
-    GameLevel one; one.Load("../resources/levels/one.lvl", this->Width, this->Height / 2);
-    GameLevel two; two.Load("../resources/levels/two.lvl", this->Width, this->Height / 2);
-    GameLevel three; three.Load("../resources/levels/three.lvl", this->Width, this->Height / 2);
-    GameLevel four; four.Load("../resources/levels/four.lvl", this->Width, this->Height / 2);
-    GameLevel five; five.Load("../resources/levels/five.lvl", this->Width, this->Height / 2);
-    this->Levels.push_back(one);
-    this->Levels.push_back(two);
-    this->Levels.push_back(three);
-    this->Levels.push_back(four);
-    this->Levels.push_back(five);
+    ResourceManager::GetShader("pTrailA_gpu").Use().SetInteger("sprite", 0);
+    ResourceManager::GetShader("pTrailA_gpu").SetMatrix4("projection", projection);
+    ResourceManager::LoadTexture("resources/textures/background.jpg", false, "background");
+    ResourceManager::LoadTexture("resources/textures/pong.png", true, "pong");
+    ResourceManager::LoadTexture("resources/textures/block.png", false, "block");
+    ResourceManager::LoadTexture("resources/textures/block_solid.png", false, "block_solid");
+    ResourceManager::LoadTexture("resources/textures/paddle.png", true, "paddle");
+    ResourceManager::LoadTexture("resources/textures/weed.png", true, "particle");
+    for (unsigned int type = 0; type < POWERUP_TYPE_COUNT; ++type)
+        PowerUpTextures[type] = &ResourceManager::LoadTexture(POWERUP_DEFS[type].TextureFile, true, POWERUP_DEFS[type].Texture);
+
+    Stream = new StreamBuffer(GL_ARRAY_BUFFER, STREAM_BUFFER_SIZE);
+    Renderer = new SpriteRenderer(ResourceManager::GetShader("sprite"), *Stream);
+    bgRenderer = new SpriteRenderer(ResourceManager::GetShader("background"), *Stream);
+    Hud = new PerfHud(ResourceManager::GetShader("text"), *Stream);
+    // simulate particles on the GPU when the transform feedback programs linked, CPU otherwise
+    if (ResourceManager::GetShader("pUpdate").IsLinked() && ResourceManager::GetShader("pTrailA_gpu").IsLinked())
+        Particles = new ParticleGenerator(ResourceManager::GetShader("pTrailA_gpu"), ResourceManager::GetShader("pUpdate"), ResourceManager::GetTexture("particle"), MAX_PARTICLES);
+    else
+        Particles = new ParticleGenerator(ResourceManager::GetShader("pTrailA"), ResourceManager::GetTexture("particle"), MAX_PARTICLES);
+    this->initEmitters();
+    Effects = new PostProcessor(ResourceManager::GetShader("postprocessing"), ResourceManager::GetShader("fxaa"), this->Width, this->Height, this->AAMode);
+    Effects->DynamicResolution = this->GPUBudget > 0.0f;
+    Effects->GPUBudget = this->GPUBudget;
+
+    BackgroundShader = &ResourceManager::GetShader("background");
+    BrickShader = &ResourceManager::GetShader("brick");
+    BackgroundTexture = &ResourceManager::GetTexture("background");
+    BallTexture = &ResourceManager::GetTexture("pong");
+    this->PowerUps.Reserve(MAX_POWERUPS);
+    this->Balls.Reserve(MAX_BALLS);
+    this->contacts.resize(MAX_BALLS);
+    {
+        MemoryScope memoryScope(MEMORY_ENTITIES);
+        this->entityMemory.Track("balls and power-ups", this->Balls.Bytes() + this->PowerUps.Bytes() + this->contacts.capacity() * sizeof(BallContacts));
+    }
+    Workers = new WorkerPool();
+
+    GameLevel one; one.Load("resources/levels/one.lvl", this->Width, this->Height / 2);
+    GameLevel two; two.Load("resources/levels/two.lvl", this->Width, this->Height / 2);
+    GameLevel three; three.Load("resources/levels/three.lvl", this->Width, this->Height / 2);
+    GameLevel four; four.Load("resources/levels/four.lvl", this->Width, this->Height / 2);
+    GameLevel five; five.Load("resources/levels/five.lvl", this->Width, this->Height / 2);
+    this->Levels.push_back(std::move(one));
+    this->Levels.push_back(std::move(two));
+    this->Levels.push_back(std::move(three));
+    this->Levels.push_back(std::move(four));
+    this->Levels.push_back(std::move(five));
     this->Level = 0;
 
-    glm::vec2 playerPos = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
-    Player = new GameObject(playerPos, PLAYER_SIZE, ResourceManager::GetTexture("paddle"));
-    glm::vec2 ballPos = playerPos + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -BALL_RADIUS * 2.0f);
-    Ball = new BallObject(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY, ResourceManager::GetTexture("pong"));
+    this->PaddleSprite.Texture = &ResourceManager::GetTexture("paddle");
+    this->PaddleSprite.Color = glm::vec3(1.0f);
+    this->ResetPlayer();
+    if (this->HitchBudget > 0.0f) {
+        Recorder = new FlightRecorder(*this, this->HitchDirectory, this->HitchBudget);
+        this->Save(*Recorder->Keyframe());
+    }
+    if (this->RewindSeconds > 0.0f)
+        History = new RewindBuffer(*this, (unsigned int)(this->RewindSeconds * REWIND_RATE), REWIND_BYTES);
+    if (!this->StreamName.empty() || !this->StreamSocket.empty()) {
+        Broadcast = new StateStream(*this);
+        bool open = false;
+        if (!this->StreamName.empty())
+            open = Broadcast->OpenSharedMemory(this->StreamName.c_str()) || open;
+        if (!this->StreamSocket.empty())
+            open = Broadcast->OpenSocket(this->StreamSocket.c_str()) || open;
+        if (!open) {
+            delete Broadcast;
+            Broadcast = nullptr;
+        }
+    }
+    if (History || Broadcast) {
+        this->ReserveSnapshot(this->tickState);
+        // only there for rewind and the stream, counted with rewind when both run
+        MemoryScope memoryScope(History ? MEMORY_REWIND : MEMORY_STATE_STREAM);
+        this->tickMemory.Track("tick snapshot", this->tickState.Balls.Bytes() + this->tickState.PowerUps.Bytes()
+            + this->tickState.Timers.capacity() * sizeof(GameTimer) + this->tickState.Destroyed.capacity());
+        this->publishState();
+    }
+    if (!this->AudioOutput.empty()) {
+        Audio = new AudioMixer();
+        this->initSounds();
+        if (this->AudioOutput == "null")
+            Audio->OpenNull();
+        else if (!Audio->OpenFile(this->AudioOutput.c_str())) {
+            delete Audio;
+            Audio = nullptr;
+        }
+        if (Audio)
+            Audio->Start();
+    }
+}
+
+void Game::initEmitters() {
+    // budgets add up to more than the pool on purpose, priority decides who gets culled
+    EmitterDesc ballTrail;
+    ballTrail.Rate = 120.0f;
+    ballTrail.Budget = 300;
+    ballTrail.Priority = 1;
+    ballTrail.Inherit = -0.1f;
+    ballTrail.Jitter = 5.0f;
+    ballTrail.BrightMin = 0.5f;
+    ballTrail.BrightMax = 1.5f;
+    ballTrail.Fade = 2.5f;
+    BallTrail = Particles->AddEmitter(ballTrail);
+
+    EmitterDesc brickShatter;
+    brickShatter.Budget = 600;
+    brickShatter.Priority = 2;
+    brickShatter.LifeMin = 0.4f;
+    brickShatter.LifeMax = 0.9f;
+    brickShatter.SpeedMin = 60.0f;
+    brickShatter.SpeedMax = 220.0f;
+    brickShatter.Jitter = 10.0f;
+    brickShatter.BrightMin = 0.8f;
+    brickShatter.BrightMax = 1.2f;
+    brickShatter.Fade = 1.5f;
+    BrickShatter = Particles->AddEmitter(brickShatter);
+
+    EmitterDesc paddleSparks;
+    paddleSparks.Budget = 120;
+    paddleSparks.Priority = 2;
+    paddleSparks.LifeMin = 0.2f;
+    paddleSparks.LifeMax = 0.5f;
+    paddleSparks.SpeedMin = 100.0f;
+    paddleSparks.SpeedMax = 250.0f;
+    paddleSparks.Direction = glm::vec2(0.0f, -1.0f);
+    paddleSparks.Spread = 60.0f;
+    paddleSparks.Color = glm::vec3(1.0f, 0.8f, 0.4f);
+    paddleSparks.Fade = 2.5f;
+    PaddleSparks = Particles->AddEmitter(paddleSparks);
+
+    EmitterDesc powerUpTrail;
+    powerUpTrail.Rate = 40.0f;
+    powerUpTrail.Budget = 200;
+    powerUpTrail.Priority = 0;
+    powerUpTrail.LifeMin = 0.3f;
+    powerUpTrail.LifeMax = 0.6f;
+    powerUpTrail.SpeedMin = 5.0f;
+    powerUpTrail.SpeedMax = 20.0f;
+    powerUpTrail.Inherit = -0.2f;
+    powerUpTrail.Jitter = 15.0f;
+    powerUpTrail.Fade = 2.0f;
+    PowerUpTrail = Particles->AddEmitter(powerUpTrail);
 }
 
-float shakeTime = 0.0f;
+void Game::initSounds() {
+    ToneDesc brick;
+    brick.Seconds = 0.08f;
+    brick.StartHz = 900.0f;
+    brick.EndHz = 700.0f;
+    brick.Decay = 40.0f;
+    brick.Square = 0.3f;
+    brick.Gain = 0.3f;
+    BrickSound = Audio->LoadTone(brick);
+
+    ToneDesc solid;
+    solid.Seconds = 0.12f;
+    solid.StartHz = 160.0f;
+    solid.EndHz = 110.0f;
+    solid.Decay = 30.0f;
+    solid.Square = 0.6f;
+    solid.Gain = 0.35f;
+    SolidSound = Audio->LoadTone(solid);
+
+    ToneDesc paddle;
+    paddle.Seconds = 0.1f;
+    paddle.StartHz = 440.0f;
+    paddle.EndHz = 380.0f;
+    paddle.Decay = 25.0f;
+    paddle.Gain = 0.4f;
+    PaddleSound = Audio->LoadTone(paddle);
+
+    ToneDesc powerUp;
+    powerUp.Seconds = 0.25f;
+    powerUp.StartHz = 500.0f;
+    powerUp.EndHz = 1200.0f;
+    powerUp.Decay = 6.0f;
+    powerUp.Square = 0.15f;
+    powerUp.Gain = 0.35f;
+    PowerUpSound = Audio->LoadTone(powerUp);
+}
 
 void Game::Update(float dt) {
-    Ball->Move(dt, this->Width);
-    this->DoCollisions();
-    if (Ball->Position.y >= this->Height) {
+    AllocScope updateScope(ALLOC_UPDATE);
+    PerfScope updateTime(PERF_UPDATE);
+    if (Recorder)
+        Recorder->Current().Step = dt;
+    if (History && this->Keys[GLFW_KEY_BACKSPACE]) {
+        // back one update a frame instead of playing on
+        this->rewind();
+        this->updateShadows();
+        return;
+    }
+    {
+        AllocScope collisionScope(ALLOC_COLLISION);
+        PerfScope collisionTime(PERF_COLLISION);
+        // balls only write their own rows during the step, so they can be split across threads
+        unsigned int balls = this->Balls.Size();
+        this->stepTime = dt;
+        Workers->ParallelFor(balls, balls < PARALLEL_BALLS ? balls : BALL_GRAIN, onStepBalls, this);
+        this->DoCollisions();
+    }
+    // lost balls drop out of play, the last one costs the level
+    for (unsigned int i = this->Balls.Size(); i-- > 0; ) {
+        if (this->Balls.Transforms[i].Position.y < this->Height)
+            continue;
+        if (this->Balls.Size() > 1) {
+            this->Balls.Remove(i);
+            continue;
+        }
+        AllocScope levelScope(ALLOC_LEVEL);
         this->ResetLevel();
         this->ResetPlayer();
     }
-    Particles->Update(dt, *Ball, 2, glm::vec2(Ball->Radius / 2.0f));
-    this->UpdatePowerUps(dt);
-    if (shakeTime > 0.0f) {
-        shakeTime -= dt;
-        if (shakeTime <= 0.0f)
-            Effects->Shake = false;
+    {
+        AllocScope particleScope(ALLOC_PARTICLES);
+        PerfScope particleTime(PERF_PARTICLES);
+        for (unsigned int i = 0; i < this->Balls.Size(); ++i)
+            Particles->Emit(BallTrail, dt, this->Balls.Transforms[i].Position + glm::vec2(this->Balls.States[i].Radius / 2.0f), this->Balls.Motions[i].Velocity);
+        Particles->Update(dt);
     }
-    glm::vec2 ballPos = glm::vec2(Ball->Position.x / this->Width, Ball->Position.y / this->Height);
-    ResourceManager::GetShader("background").Use();
-    ResourceManager::GetShader("background").SetVector2f("ballPos", ballPos);
+    {
+        AllocScope powerUpScope(ALLOC_POWERUPS);
+        this->UpdatePowerUps(dt);
+    }
+    // fires the expiry of shake and timed power-ups that are due
+    this->Timers.Advance(dt);
+    this->publishState();
+    this->updateShadows();
+}
+
+void Game::publishState() {
+    if (!History && !Broadcast)
+        return;
+    this->Save(this->tickState);
+    if (History)
+        History->Push(this->tickState);
+    if (Broadcast)
+        Broadcast->Publish(this->tickState);
+}
+
+void Game::rewind() {
+    // the newest state is the one on screen, so the one before it is a step back
+    if (History->Size() < 2)
+        return;
+    History->Drop(1);
+    if (!History->Read(0, this->tickState))
+        return;
+    // the keys held now keep the rewind going, and the paddle integrates input from now on
+    bool keys[1024];
+    std::copy(this->Keys, this->Keys + 1024, keys);
+    double inputTime = this->inputTime;
+    this->Restore(this->tickState);
+    std::copy(keys, keys + 1024, this->Keys);
+    this->inputTime = inputTime;
+    // watchers see the rewind play out
+    if (Broadcast) {
+        this->Save(this->tickState);
+        Broadcast->Publish(this->tickState);
+    }
+}
+
+void Game::updateShadows() {
+    // the background shades under the first few balls only
+    glm::vec2 shadows[MAX_SHADOW_BALLS];
+    unsigned int shadowCount = std::min(this->Balls.Size(), MAX_SHADOW_BALLS);
+    for (unsigned int i = 0; i < shadowCount; ++i)
+        shadows[i] = this->Balls.Transforms[i].Position / glm::vec2(this->Width, this->Height);
+    BackgroundShader->Use();
+    BackgroundShader->SetVector2fv("ballPos", shadows, shadowCount);
+    BackgroundShader->SetInteger("ballCount", shadowCount);
 }
 
-void Game::ProcessInput(float dt) {
+void Game::ProcessInput(double time) {
+    AllocScope inputScope(ALLOC_INPUT);
+    if (Recorder)
+        Recorder->Current().InputTime = time;
+    this->advanceInput(time);
     if (this->State == GAME_ACTIVE)
     {
-        float velocity = PLAYER_VELOCITY * dt;
-        // movement
-        if (this->Keys[GLFW_KEY_A]) {
-            if (Player->Position.x >= 0.0f) {
-                Player->Position.x -= velocity;
-                if (Ball->Stuck)
-                    Ball->Position.x -= velocity;
-            }
-        }
-        if (this->Keys[GLFW_KEY_D]) {
-            if (Player->Position.x <= this->Width - Player->Size.x) {
-                Player->Position.x += velocity;
-                if (Ball->Stuck)
-                    Ball->Position.x += velocity;
-            }
-        }
         // ball
         if (this->Keys[GLFW_KEY_SPACE])
-            Ball->Stuck = false;
+            for (BallState &ball : this->Balls.States)
+                ball.Stuck = false;
         if (this->Keys[GLFW_KEY_R])
-            Ball->Reset(Player->Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -BALL_RADIUS * 2.0f), INITIAL_BALL_VELOCITY);
+            this->Balls.Reset(0, this->Paddle.Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -BALL_RADIUS * 2.0f), INITIAL_BALL_VELOCITY);
         // level utils
         for (unsigned int i = 0; i < Levels.size(); ++i) {
             if (this->Keys[GLFW_KEY_1 + i]) 
@@ -135,262 +413,585 @@ void Game::ProcessInput(float dt) {
     }
 }
 
-void Game::Render() {
-    if(this->State == GAME_ACTIVE) {
-        Effects->BeginRender();
-        bgRenderer->DrawSprite(ResourceManager::GetTexture("background"), glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f);
-        this->Levels[this->Level].Draw(*Renderer);
-        Player->Draw(*Renderer);
-        Particles->Draw();
-        Ball->Draw(*Renderer);
-        for (PowerUp &powerUp : this->PowerUps)
-            if (!powerUp.Destroyed)
-                powerUp.Draw(*Renderer);
-        Effects->EndRender();
-        Effects->Render(glfwGetTime());
+void Game::advanceInput(double time) {
+    if (this->inputTime < 0.0)
+        this->inputTime = time;
+    // the paddle moves piecewise between key transitions, so a tap shorter than
+    // a frame still moves it for exactly as long as the key was down
+    InputEvent event;
+    while (this->Input.Pop(time, event)) {
+        if (Recorder)
+            Recorder->RecordEvent(event);
+        if (event.Time > this->inputTime) {
+            this->movePaddle(event.Time - this->inputTime);
+            this->inputTime = event.Time;
+        }
+        if (event.Key < 0 || event.Key >= 1024)
+            continue;
+        this->Keys[event.Key] = event.Pressed;
+        if ((event.Key == GLFW_KEY_A || event.Key == GLFW_KEY_D) && this->undrawnInput < 0.0)
+            this->undrawnInput = event.Time;
+    }
+    if (time > this->inputTime) {
+        this->movePaddle(time - this->inputTime);
+        this->inputTime = time;
     }
 }
 
-void Game::ResetLevel() {
-    if (this->Level == 0)
-        this->Levels[0].Load("../resources/levels/one.lvl", this->Width, this->Height / 2);
-    if (this->Level == 1)
-        this->Levels[1].Load("../resources/levels/two.lvl", this->Width, this->Height / 2);
-    if (this->Level == 2)
-        this->Levels[2].Load("../resourcse/levels/three.lvl", this->Width, this->Height / 2);
-    if (this->Level == 3)
-        this->Levels[3].Load("../resourcse/levels/four.lvl", this->Width, this->Height / 2);
-    if (this->Level == 4)
-        this->Levels[4].Load("../resourcse/levels/five.lvl", this->Width, this->Height / 2);
+void Game::LatchInput(double time) {
+    if (Recorder)
+        Recorder->Current().LatchTime = time;
+    this->advanceInput(time);
 }
 
-void Game::ResetPlayer() {
-    Player->Size = PLAYER_SIZE;
-    Player->Position = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
-    Ball->Reset(Player->Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f)), INITIAL_BALL_VELOCITY);
+void Game::movePaddle(double dt) {
+    if (this->State != GAME_ACTIVE)
+        return;
+    float direction = (this->Keys[GLFW_KEY_D] ? 1.0f : 0.0f) - (this->Keys[GLFW_KEY_A] ? 1.0f : 0.0f);
+    if (direction == 0.0f)
+        return;
+    float old = this->Paddle.Position.x;
+    float target = old + direction * PLAYER_VELOCITY * (float)dt;
+    this->Paddle.Position.x = std::max(0.0f, std::min(target, this->Width - this->Paddle.Size.x));
+    // stuck balls ride along with the paddle
+    float move = this->Paddle.Position.x - old;
+    for (unsigned int i = 0; i < this->Balls.Size(); ++i)
+        if (this->Balls.States[i].Stuck)
+            this->Balls.Transforms[i].Position.x += move;
 }
 
-bool CheckCollision(GameObject &one, GameObject &two);
-Collision CheckCollision(BallObject &one, GameObject &two);
-Direction VectorDirection(glm::vec2 target);
-void ActivatePowerUp(PowerUp &powerUp);
+void Game::Resize(unsigned int width, unsigned int height) {
+    if (Effects)
+        Effects->Resize(width, height);
+}
 
+void Game::SetAntiAliasing(AntiAliasing mode) {
+    this->AAMode = mode;
+    if (Effects)
+        Effects->SetAntiAliasing(mode);
+}
 
-void Game::DoCollisions() {
-    for (GameObject &box : this->Levels[this->Level].Bricks) {
-        if (!box.Destroyed) {
-            Collision collision = CheckCollision(*Ball, box);
-            if (std::get<0>(collision)) {
-                if (!box.IsSolid) {
-                    box.Destroyed = true;
-                    this->SpawnPowerUps(box);
-                }
-                else {
-                    shakeTime = 0.05f;
-                    Effects->Shake = true;
-                }
-
-                Direction dir = std::get<1>(collision);
-                glm::vec2 diff_vector = std::get<2>(collision);
-
-                if (!(Ball->PassThrough && !box.IsSolid)) {
-                    if (dir == LEFT || dir == RIGHT) {
-                        Ball->Velocity.x = -Ball->Velocity.x;
-                        float penetration = Ball->Radius - std::abs(diff_vector.x);
-                        if (dir == LEFT) 
-                            Ball->Position.x += penetration;
-                        else 
-                            Ball->Position.x -= penetration;
-                    }
-                    else {
-                        Ball->Velocity.y = -Ball->Velocity.y;
-                        float penetration = Ball->Radius - std::abs(diff_vector.y);
-                        if (dir == UP)
-                            Ball->Position.y -= penetration;
-                        else 
-                            Ball->Position.y += penetration;
-                    }
-                }
-            }
-        }
+void Game::SetGPUBudget(float milliseconds) {
+    this->GPUBudget = milliseconds;
+    if (Effects) {
+        Effects->DynamicResolution = milliseconds > 0.0f;
+        Effects->GPUBudget = milliseconds;
+    }
+}
+
+float Game::GPUTime() const {
+    return Effects ? Effects->GPUTime : 0.0f;
+}
+
+size_t Game::TargetBytes() const {
+    return Effects ? Effects->TargetBytes() : 0;
+}
+
+const StreamStats &Game::StreamBufferStats() const {
+    return Stream->Stats;
+}
+
+void Game::Present() {
+    if (!this->MeasureLatency)
+        return;
+    // wait for the GPU to finish the frame, the sample then covers everything but scanout
+    glFinish();
+    double time = glfwGetTime();
+    if (this->drawnInput >= 0.0) {
+        double latency = time - this->drawnInput;
+        this->latencySum += latency;
+        this->latencyMin = std::min(this->latencyMin, latency);
+        this->latencyMax = std::max(this->latencyMax, latency);
+        ++this->latencyCount;
+        this->drawnInput = -1.0;
+    }
+    if (time - this->latencyReport >= LATENCY_REPORT_INTERVAL) {
+        if (this->latencyCount > 0)
+            LOG_INFO("INPUT", "Latency", {{ "samples", this->latencyCount }, { "min_ms", this->latencyMin * 1000.0 },
+                { "avg_ms", this->latencySum / this->latencyCount * 1000.0 }, { "max_ms", this->latencyMax * 1000.0 }});
+        this->latencySum = this->latencyMax = 0.0;
+        this->latencyMin = 1e9;
+        this->latencyCount = 0;
+        this->latencyReport = time;
     }
-    Collision result = CheckCollision(*Ball, *Player);
-    if (!Ball->Stuck && std::get<0>(result)) {
-        float centerBoard = Player->Position.x + Player->Size.x / 2.0f;
-        float distance = (Ball->Position.x + Ball->Radius) - centerBoard;
-        float percentage = distance / (Player->Size.x / 2.0f);
-        float strength = 2.0f;
-        glm::vec2 oldVelocity = Ball->Velocity;
-        Ball->Velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength;
-        // Ball->Velocity.y = -Ball->Velocity.y;
-        Ball->Velocity.y = -1.0f * abs(Ball->Velocity.y);
-        Ball->Velocity = glm::normalize(Ball->Velocity) * glm::length(oldVelocity);
-        Ball->Stuck = Ball->Sticky;
-    }
-    for (PowerUp &powerUp : this->PowerUps) {
-        if (!powerUp.Destroyed) {
-            if (powerUp.Position.y >= this->Height)
-                powerUp.Destroyed = true;
-            if (CheckCollision(*Player, powerUp)) {
-                ActivatePowerUp(powerUp);
-                powerUp.Destroyed = true;
-                powerUp.Activated = true;
+}
+
+void Game::Render() {
+    AllocScope renderScope(ALLOC_RENDER);
+    if(this->State == GAME_ACTIVE) {
+        {
+            PerfScope renderTime(PERF_RENDER);
+            Effects->BeginRender();
+            bgRenderer->DrawSprite(*BackgroundTexture, glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f);
+            bgRenderer->Flush();
+            this->Levels[this->Level].Draw(*BrickShader);
+            if (this->LateLatch) {
+                // pick up input that arrived while the frame was simulated and recorded
+                glfwPollEvents();
+                this->LatchInput(glfwGetTime());
             }
+            Renderer->DrawSprite(*this->PaddleSprite.Texture, this->Paddle.Position, this->Paddle.Size, this->Paddle.Rotation, this->PaddleSprite.Color);
+            this->drawnInput = this->undrawnInput;
+            this->undrawnInput = -1.0;
+            Renderer->Flush();
+            Particles->Draw();
+            DrawSprites(*Renderer, this->Balls.Transforms, this->Balls.Sprites);
+            DrawSprites(*Renderer, this->PowerUps.Transforms, this->PowerUps.Sprites);
+            Renderer->Flush();
+            Effects->EndRender();
+            Effects->Render(glfwGetTime());
+        }
+        // over the letterbox in window pixels, untouched by the screen effects
+        if (this->ShowPerfHud) {
+            PerfScope hudTime(PERF_HUD);
+            Hud->Draw(Effects->Width, Effects->Height);
         }
+        Stream->EndFrame();
     }
 }
 
-bool CheckCollision(GameObject &one, GameObject &two) { // AABB - AABB collisions
-    bool collisionX = one.Position.x + one.Size.x >= two.Position.x &&
-        two.Position.x + two.Size.x >= one.Position.x;
-    bool collisionY = one.Position.y + one.Size.y >= two.Position.y &&
-        two.Position.y + two.Size.y >= one.Position.y;
-
-    return collisionX && collisionY;
-}
-
-Collision CheckCollision(BallObject &one, GameObject &two) { // AABB - Circle collisions
-    glm::vec2 center(one.Position + one.Radius);
-    glm::vec2 aabb_half_extents(two.Size.x / 2.0f, two.Size.y / 2.0f);
-    glm::vec2 aabb_center(
-            two.Position.x + aabb_half_extents.x,
-            two.Position.y + aabb_half_extents.y
-    );
-    glm::vec2 difference = center - aabb_center;
-    glm::vec2 clamped = glm::clamp(difference, -aabb_half_extents, aabb_half_extents);
-    glm::vec2 closest = aabb_center + clamped;
-    difference = closest - center;
-
-    if (glm::length(difference) <= one.Radius)
-        return std::make_tuple(true, VectorDirection(difference), difference);
-    else 
-        return std::make_tuple(false, UP, glm::vec2(0.0f, 0.0f));
-}
-
-Direction VectorDirection(glm::vec2 target) {
-    glm::vec2 compass[] = {
-        glm::vec2(0.0f, 1.0f),	// up
-        glm::vec2(1.0f, 0.0f),	// right
-        glm::vec2(0.0f, -1.0f),	// down
-        glm::vec2(-1.0f, 0.0f)	// left
-    };
-    float max = 0.0f;
-    unsigned int best_match = -1;
-    for (unsigned int i = 0; i < 4; ++i) {
-        float dot_product = glm::dot(glm::normalize(target), compass[i]);
-        if (dot_product > max) {
-            max = dot_product;
-            best_match = i;
+void Game::EndFrame() {
+    PerfSample sample = PerfSample();
+    const GLStats &gl = GLBackend::LastFrame();
+    sample.GPUTime = this->GPUTime();
+    sample.DrawCalls = gl.DrawCalls;
+    sample.Binds = gl.Binds;
+    sample.Uniforms = gl.UniformUploads;
+    sample.Particles = Particles->LiveCount();
+    sample.Bricks = this->Levels[this->Level].BricksLeft();
+    sample.Allocations = AllocTracker::LastFrame().TotalCount();
+    sample.GPUMemory = MemoryTracker::Stats().TotalGPUBytes();
+    sample.CPUMemory = MemoryTracker::Stats().TotalCPUBytes();
+    Hud->EndFrame(sample);
+    // the driver is only counted while someone looks
+    GLBackend::CountCalls(this->ShowPerfHud);
+    if (Recorder) {
+        FrameRecord &record = Recorder->Current();
+        record.Level = this->Level;
+        record.Balls = this->Balls.Size();
+        record.PowerUps = this->PowerUps.Size();
+        record.PaddleX = this->Paddle.Position.x;
+        record.Random = this->Rng.State;
+        record.StateHash = this->StateHash();
+        Recorder->EndFrame(sample);
+        if (GameSnapshot *keyframe = Recorder->Keyframe())
+            this->Save(*keyframe);
+    }
+}
+
+void Game::ReserveSnapshot(GameSnapshot &snapshot) const {
+    snapshot.Balls.Reserve(MAX_BALLS);
+    snapshot.PowerUps.Reserve(MAX_POWERUPS);
+    snapshot.Timers.reserve(this->Timers.Capacity());
+    unsigned int bricks = 0;
+    for (const GameLevel &level : this->Levels)
+        bricks += level.Bricks.Size();
+    snapshot.Destroyed.reserve(bricks);
+}
+
+void Game::Save(GameSnapshot &snapshot) const {
+    snapshot.State = this->State;
+    snapshot.Level = this->Level;
+    snapshot.StressBalls = this->StressBalls;
+    std::copy(this->Keys, this->Keys + 1024, snapshot.Keys);
+    snapshot.InputTime = this->inputTime;
+    snapshot.Random = this->Rng.State;
+    snapshot.Paddle = this->Paddle;
+    snapshot.PaddleColor = this->PaddleSprite.Color;
+    // assignments keep the snapshot's capacity
+    snapshot.Balls = this->Balls;
+    snapshot.PowerUps = this->PowerUps;
+    std::copy(this->ActiveEffects, this->ActiveEffects + POWERUP_TYPE_COUNT, snapshot.ActiveEffects);
+    snapshot.Shake = Effects->Shake;
+    snapshot.Confuse = Effects->Confuse;
+    snapshot.Chaos = Effects->Chaos;
+    snapshot.TimerElapsed = this->Timers.Elapsed();
+    snapshot.TimerTick = this->Timers.Tick();
+    snapshot.Timers.clear();
+    PendingTimer pending;
+    for (unsigned int slot = 0; slot < this->Timers.Capacity(); ++slot)
+        if (this->Timers.Pending(slot, pending)) {
+            GameTimer timer = { pending.Expires, pending.Callback == onShakeExpired ? TIMER_SHAKE_EXPIRED : TIMER_POWERUP_EXPIRED, pending.Data };
+            snapshot.Timers.push_back(timer);
         }
+    snapshot.Destroyed.clear();
+    for (const GameLevel &level : this->Levels)
+        for (const BrickState &brick : level.Bricks.States)
+            snapshot.Destroyed.push_back(brick.Destroyed);
+}
+
+void Game::Restore(const GameSnapshot &snapshot) {
+    this->State = snapshot.State;
+    this->Level = std::min(snapshot.Level, (unsigned int)this->Levels.size() - 1);
+    this->StressBalls = snapshot.StressBalls;
+    std::copy(snapshot.Keys, snapshot.Keys + 1024, this->Keys);
+    this->inputTime = snapshot.InputTime;
+    this->undrawnInput = this->drawnInput = -1.0;
+    this->Rng.State = snapshot.Random;
+    this->Paddle = snapshot.Paddle;
+    this->PaddleSprite.Color = snapshot.PaddleColor;
+    // textures are not part of the snapshot, every ball shares one and a power-up's follows its type
+    this->Balls = snapshot.Balls;
+    for (Sprite &sprite : this->Balls.Sprites)
+        sprite.Texture = BallTexture;
+    this->PowerUps = snapshot.PowerUps;
+    for (unsigned int i = 0; i < this->PowerUps.Size(); ++i)
+        this->PowerUps.Sprites[i].Texture = PowerUpTextures[this->PowerUps.Types[i]];
+    std::copy(snapshot.ActiveEffects, snapshot.ActiveEffects + POWERUP_TYPE_COUNT, this->ActiveEffects);
+    Effects->Shake = snapshot.Shake;
+    Effects->Confuse = snapshot.Confuse;
+    Effects->Chaos = snapshot.Chaos;
+    this->Timers.Reset(snapshot.TimerElapsed, snapshot.TimerTick);
+    this->shakeTimer = NO_TIMER;
+    for (const GameTimer &timer : snapshot.Timers) {
+        if (timer.Kind == TIMER_SHAKE_EXPIRED)
+            this->shakeTimer = this->Timers.ScheduleAt(timer.Expires, onShakeExpired, this, timer.Data);
+        else
+            this->Timers.ScheduleAt(timer.Expires, onPowerUpExpired, this, timer.Data);
+    }
+    unsigned int brick = 0;
+    for (GameLevel &level : this->Levels) {
+        level.Reset();
+        for (unsigned int i = 0; i < level.Bricks.Size() && brick < snapshot.Destroyed.size(); ++i, ++brick)
+            if (snapshot.Destroyed[brick])
+                level.Destroy(i);
     }
+}
 
-    return (Direction)best_match;
+// FNV-1a over 32-bit words, a trailing partial word is zero padded
+static unsigned int hashWords(unsigned int hash, const void *data, size_t bytes) {
+    const unsigned char *p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < bytes; i += 4) {
+        unsigned int word = 0;
+        std::memcpy(&word, p + i, std::min<size_t>(4, bytes - i));
+        hash = (hash ^ word) * 16777619u;
+    }
+    return hash;
 }
 
-bool IsOtherPowerUpActive(std::vector<PowerUp> &powerUps, std::string type);
+unsigned int Game::StateHash() const {
+    // field by field where structs have padding
+    unsigned int hash = 2166136261u;
+    hash = hashWords(hash, &this->Level, sizeof(this->Level));
+    hash = hashWords(hash, &this->Rng.State, sizeof(this->Rng.State));
+    hash = hashWords(hash, &this->Paddle, sizeof(this->Paddle));
+    hash = hashWords(hash, this->ActiveEffects, sizeof(this->ActiveEffects));
+    hash = hashWords(hash, this->Balls.Transforms.data(), this->Balls.Size() * sizeof(Transform));
+    hash = hashWords(hash, this->Balls.Motions.data(), this->Balls.Size() * sizeof(Motion));
+    for (const BallState &ball : this->Balls.States) {
+        unsigned int flags = ball.Stuck | ball.Sticky << 1 | ball.PassThrough << 2;
+        hash = hashWords(hash, &ball.Radius, sizeof(ball.Radius));
+        hash = hashWords(hash, &flags, sizeof(flags));
+    }
+    hash = hashWords(hash, this->PowerUps.Transforms.data(), this->PowerUps.Size() * sizeof(Transform));
+    hash = hashWords(hash, this->PowerUps.Types.data(), this->PowerUps.Size() * sizeof(PowerUpType));
+    const BrickTable &bricks = this->Levels[this->Level].Bricks;
+    hash = hashWords(hash, bricks.States.data(), bricks.Size() * sizeof(BrickState));
+    return hash;
+}
 
-void Game::UpdatePowerUps(float dt) {
-    for (PowerUp &powerUp : this->PowerUps) {
-        powerUp.Position += powerUp.Velocity * dt;
-        if (powerUp.Activated) {
-            powerUp.Duration -= dt;
-
-            if (powerUp.Duration <= 0.0f) {
-                powerUp.Activated = false;
-
-                if (powerUp.Type == "sticky") {
-                    if (!IsOtherPowerUpActive(this->PowerUps, "sticky")) {
-                        Ball->Sticky = false;
-                        Player->Color = glm::vec3(1.0f);        
-                    }
-                }
-                else if (powerUp.Type == "pass-through") {
-                    if (!IsOtherPowerUpActive(this->PowerUps, "pass-through")) {
-                        Ball->PassThrough = false;
-                        Ball->Color = glm::vec3(1.0f);
-                    }
-                }
-                else if (powerUp.Type == "confuse") {
-                    if (!IsOtherPowerUpActive(this->PowerUps, "confuse")) {
-                        Effects->Confuse = false;
-                    }
-                }
-                else if (powerUp.Type == "chaos") {
-                    if (!IsOtherPowerUpActive(this->PowerUps, "chaos")) {
-                        Effects->Chaos = false;
-                    }
-                }
-            }
-        }
+void Game::ResetLevel() {
+    // restore the bricks in place rather than reloading the level from disk
+    this->Levels[this->Level].Reset();
+}
+
+void Game::ResetPlayer() {
+    this->Paddle.Size = PLAYER_SIZE;
+    this->Paddle.Position = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
+    glm::vec2 ballPos = this->Paddle.Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f));
+    this->Balls.Clear();
+    this->Balls.Add(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY, *BallTexture);
+    // stress mode fans the extra balls out evenly over 120 degrees
+    float speed = glm::length(INITIAL_BALL_VELOCITY);
+    for (unsigned int i = 0; i < this->StressBalls; ++i) {
+        float angle = glm::radians(-60.0f + 120.0f * (i + 0.5f) / this->StressBalls);
+        this->SpawnBall(ballPos, glm::vec2(std::sin(angle), -std::cos(angle)) * speed);
     }
-    this->PowerUps.erase(std::remove_if(this->PowerUps.begin(), this->PowerUps.end(),
-                [](const PowerUp &powerUp) { return powerUp.Destroyed && !powerUp.Activated; }
-            ), this->PowerUps.end());
 }
 
-bool IsOtherPowerUpActive(std::vector<PowerUp> &powerUps, std::string type) {
-    for (const PowerUp &powerUp : powerUps) {
-        if (powerUp.Activated)
-            if (powerUp.Type == type)
-                return true;
+bool Game::SpawnBall(glm::vec2 position, glm::vec2 velocity) {
+    if (this->Balls.Size() >= MAX_BALLS)
+        return false;
+    unsigned int ball = this->Balls.Add(position, BALL_RADIUS, velocity, *BallTexture);
+    this->Balls.States[ball].Stuck = false;
+    // timed effects switch every ball in play, so a new ball picks up the ones still running
+    if (this->ActiveEffects[POWERUP_STICKY] > 0)
+        this->Balls.States[ball].Sticky = true;
+    if (this->ActiveEffects[POWERUP_PASS_THROUGH] > 0) {
+        this->Balls.States[ball].PassThrough = true;
+        this->Balls.Sprites[ball].Color = glm::vec3(1.0f, 0.5f, 0.5f);
     }
-    return false;
+    return true;
+}
+
+void Game::onStepBalls(void *game, unsigned int begin, unsigned int end) {
+    static_cast<Game*>(game)->stepBalls(begin, end);
 }
 
-bool ShouldSpawn(unsigned int chance) {
-    unsigned int random = rand() % chance;
-    return random == 0;
+void Game::stepBalls(unsigned int begin, unsigned int end) {
+    // bricks are read-only here, a brick destroyed this step still bounces every
+    // ball that reached it and DoCollisions credits the lowest numbered ball
+    const BrickTable &bricks = this->Levels[this->Level].Bricks;
+    for (unsigned int b = begin; b < end; ++b) {
+        this->contacts[b].Count = 0;
+        this->contacts[b].Paddle = false;
+        if (!this->Balls.States[b].Stuck)
+            this->sweepBall(b, bricks);
+    }
+}
+
+void Game::sweepBall(unsigned int b, const BrickTable &bricks) {
+    glm::vec2 &position = this->Balls.Transforms[b].Position;
+    glm::vec2 &velocity = this->Balls.Motions[b].Velocity;
+    BallState &ball = this->Balls.States[b];
+    BallContacts &contact = this->contacts[b];
+    glm::vec2 size = this->Balls.Transforms[b].Size;
+    // impacts are resolved in time order, each one restarts the sweep from the
+    // contact point with whatever is left of the step
+    float remaining = this->stepTime;
+    for (unsigned int impact = 0; impact < MAX_BALL_IMPACTS && remaining > 0.0f; ++impact) {
+        glm::vec2 center = position + ball.Radius;
+        glm::vec2 motion = velocity * remaining;
+        float time = 1.0f;
+        glm::vec2 normal(0.0f);
+        unsigned int hit = NO_HIT;
+        // walls, against the ball's bounding box like before
+        if (motion.x < 0.0f && -position.x / motion.x < time) {
+            time = std::max(-position.x / motion.x, 0.0f);
+            normal = glm::vec2(1.0f, 0.0f);
+            hit = HIT_WALL;
+        }
+        else if (motion.x > 0.0f && (this->Width - size.x - position.x) / motion.x < time) {
+            time = std::max((this->Width - size.x - position.x) / motion.x, 0.0f);
+            normal = glm::vec2(-1.0f, 0.0f);
+            hit = HIT_WALL;
+        }
+        if (motion.y < 0.0f && -position.y / motion.y < time) {
+            time = std::max(-position.y / motion.y, 0.0f);
+            normal = glm::vec2(0.0f, 1.0f);
+            hit = HIT_WALL;
+        }
+        // ties go to the lower brick
+        BrickSweep sweep = { &bricks, &contact };
+        unsigned int brick = SweepCircleBoxes(bricks.Bounds, center, ball.Radius, motion, canHit, &sweep, time, normal);
+        if (brick != NO_BOX)
+            hit = brick;
+        if (!contact.Paddle) {
+            float t;
+            glm::vec2 n;
+            if (SweepCircleAABB(center, ball.Radius, motion, this->Paddle.Position, this->Paddle.Position + this->Paddle.Size, t, n) && t < time) {
+                time = t;
+                hit = HIT_PADDLE;
+            }
+        }
+
+        position += motion * time;
+        remaining -= remaining * time;
+        if (hit == NO_HIT)
+            break;
+        if (hit == HIT_PADDLE) {
+            float centerBoard = this->Paddle.Position.x + this->Paddle.Size.x / 2.0f;
+            float distance = (position.x + ball.Radius) - centerBoard;
+            float percentage = distance / (this->Paddle.Size.x / 2.0f);
+            float strength = 2.0f;
+            glm::vec2 oldVelocity = velocity;
+            velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength;
+            velocity.y = -1.0f * abs(velocity.y);
+            velocity = glm::normalize(velocity) * glm::length(oldVelocity);
+            contact.Paddle = true;
+            ball.Stuck = ball.Sticky;
+            if (ball.Stuck)
+                break;
+            continue;
+        }
+        if (hit != HIT_WALL) {
+            contact.Bricks[contact.Count++] = hit;
+            if (ball.PassThrough && !bricks.States[hit].Solid)
+                continue;
+        }
+        // reflect and step off the surface so the next sweep starts clear of it
+        velocity -= 2.0f * glm::dot(velocity, normal) * normal;
+        position += normal * SWEEP_SKIN;
+    }
 }
 
-void Game::SpawnPowerUps(GameObject &block) {
-    if (ShouldSpawn(25)) // 1 in 75 chance
-        this->PowerUps.push_back(
-             PowerUp("speed", glm::vec3(1.0f), 0.0f, block.Position, ResourceManager::GetTexture("powerup_speed")
-         ));
-    if (ShouldSpawn(25))
-        this->PowerUps.push_back(
-            PowerUp("sticky", glm::vec3(1.0f), 20.0f, block.Position, ResourceManager::GetTexture("powerup_sticky")
-        ));
-    if (ShouldSpawn(25))
-        this->PowerUps.push_back(
-            PowerUp("pass-through", glm::vec3(1.0f), 10.0f, block.Position, ResourceManager::GetTexture("powerup_passthrough")
-        ));
-    if (ShouldSpawn(25))
-        this->PowerUps.push_back(
-            PowerUp("grow", glm::vec3(1.0f), 0.0f, block.Position, ResourceManager::GetTexture("powerup_grow")
-        ));
-    if (ShouldSpawn(15)) // negative powerups should spawn more often
-        this->PowerUps.push_back(
-            PowerUp("confuse", glm::vec3(1.0f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_confuse")
-        ));
-    if (ShouldSpawn(15))
-        this->PowerUps.push_back(
-            PowerUp("chaos", glm::vec3(1.0f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_chaos")
-        ));
+bool Game::canHit(void *sweep, unsigned int brick) {
+    const BrickSweep &ball = *static_cast<const BrickSweep*>(sweep);
+    // a breakable brick only counts once, it is gone by the end of the step
+    return !ball.Bricks->States[brick].Destroyed && (ball.Bricks->States[brick].Solid || !ball.Contact->Has(brick));
 }
 
-void ActivatePowerUp(PowerUp &powerUp) {
-    if (powerUp.Type == "speed") {
-        Ball->Velocity *= 1.2;
+void Game::DoCollisions() {
+    GameLevel &level = this->Levels[this->Level];
+    BrickTable &bricks = level.Bricks;
+    // in ball order, so the outcome never depends on how the step was split
+    for (unsigned int b = 0; b < this->Balls.Size(); ++b) {
+        const BallContacts &contact = this->contacts[b];
+        for (unsigned int i = 0; i < contact.Count; ++i) {
+            unsigned int brick = contact.Bricks[i];
+            if (bricks.States[brick].Solid) {
+                // every hit restarts the shake
+                this->Timers.Cancel(this->shakeTimer);
+                this->shakeTimer = this->Timers.Schedule(SHAKE_TIME, onShakeExpired, this);
+                Effects->Shake = true;
+                this->playSound(SolidSound, bricks.Transforms[brick].Position.x + bricks.Transforms[brick].Size.x * 0.5f, BRICK_PRIORITY);
+            }
+            else if (!bricks.States[brick].Destroyed) {
+                const Transform &box = bricks.Transforms[brick];
+                level.Destroy(brick);
+                Particles->Burst(BrickShatter, 24, box.Position + box.Size * 0.5f, glm::vec2(0.0f), bricks.Sprites[brick].Color);
+                this->SpawnPowerUps(box.Position);
+                this->playSound(BrickSound, box.Position.x + box.Size.x * 0.5f, BRICK_PRIORITY);
+            }
+        }
+        if (contact.Paddle) {
+            float radius = this->Balls.States[b].Radius;
+            Particles->Burst(PaddleSparks, 12, this->Balls.Transforms[b].Position + glm::vec2(radius, radius * 2.0f));
+            this->playSound(PaddleSound, this->Balls.Transforms[b].Position.x + radius, PADDLE_PRIORITY);
+        }
     }
-    else if (powerUp.Type == "sticky") {
-        Ball->Sticky = true;
-        Player->Color = glm::vec3(1.0f, 0.5f, 1.0f);
+    // walk backwards, removal swaps the last power-up into the current row
+    for (unsigned int i = this->PowerUps.Size(); i-- > 0; ) {
+        if (Overlaps(this->Paddle, this->PowerUps.Transforms[i])) {
+            this->activatePowerUp(this->PowerUps.Types[i]);
+            this->playSound(PowerUpSound, this->PowerUps.Transforms[i].Position.x + this->PowerUps.Transforms[i].Size.x * 0.5f, POWERUP_PRIORITY);
+            this->PowerUps.Remove(i);
+        }
+        else if (this->PowerUps.Transforms[i].Position.y >= this->Height)
+            this->PowerUps.Remove(i);
     }
-    else if (powerUp.Type == "pass-through") {
-        Ball->PassThrough = true;
-        Ball->Color = glm::vec3(1.0f, 0.5f, 0.5f);
+}
+
+void Game::playSound(unsigned int sound, float x, unsigned int priority) {
+    // queued for the mixer thread, never waits on it
+    if (Audio)
+        Audio->Play(sound, 1.0f, x / this->Width * 2.0f - 1.0f, priority);
+}
+
+void Game::UpdatePowerUps(float dt) {
+    MoveBodies(this->PowerUps.Transforms, this->PowerUps.Motions, dt);
+    for (unsigned int i = 0; i < this->PowerUps.Size(); ++i)
+        Particles->Emit(PowerUpTrail, dt, this->PowerUps.Transforms[i].Position + this->PowerUps.Transforms[i].Size * 0.5f, this->PowerUps.Motions[i].Velocity);
+}
+
+void Game::SpawnPowerUps(glm::vec2 position) {
+    for (unsigned int type = 0; type < POWERUP_TYPE_COUNT; ++type)
+        if (this->Rng.OneIn(POWERUP_DEFS[type].SpawnOdds))
+            this->spawnPowerUp((PowerUpType)type, position);
+}
+
+void Game::spawnPowerUp(PowerUpType type, glm::vec2 position) {
+    // capacity is reserved in Init, a full table drops the spawn instead of reallocating
+    if (this->PowerUps.Size() < MAX_POWERUPS)
+        this->PowerUps.Add(type, position, *PowerUpTextures[type]);
+}
+
+void Game::activatePowerUp(PowerUpType type) {
+    const PowerUpDef &def = POWERUP_DEFS[type];
+    if (def.Duration > 0.0f) {
+        // timed effects are reference counted per type, see deactivatePowerUp
+        if (this->Timers.Schedule(def.Duration, onPowerUpExpired, this, type) == NO_TIMER)
+            return; // no timer to ever switch it off again
+        ++this->ActiveEffects[type];
     }
-    else if (powerUp.Type == "grow") {
-        Player->Size.x += 50;
+    def.Activate(*this);
+}
+
+void Game::onPowerUpExpired(void *game, unsigned int type) {
+    static_cast<Game*>(game)->deactivatePowerUp((PowerUpType)type);
+}
+
+void Game::onShakeExpired(void *game, unsigned int data) {
+    static_cast<Game*>(game)->shakeTimer = NO_TIMER;
+    Effects->Shake = false;
+}
+
+void Game::deactivatePowerUp(PowerUpType type) {
+    if (this->ActiveEffects[type] > 0 && --this->ActiveEffects[type] == 0 && POWERUP_DEFS[type].Deactivate)
+        POWERUP_DEFS[type].Deactivate(*this);
+}
+
+// power-up effects
+
+void SpeedActivate(Game &game) {
+    for (Motion &motion : game.Balls.Motions)
+        motion.Velocity *= 1.2;
+}
+
+void StickyActivate(Game &game) {
+    for (BallState &ball : game.Balls.States)
+        ball.Sticky = true;
+    game.PaddleSprite.Color = glm::vec3(1.0f, 0.5f, 1.0f);
+}
+
+void StickyDeactivate(Game &game) {
+    for (BallState &ball : game.Balls.States)
+        ball.Sticky = false;
+    game.PaddleSprite.Color = glm::vec3(1.0f);
+}
+
+void PassThroughActivate(Game &game) {
+    for (unsigned int i = 0; i < game.Balls.Size(); ++i) {
+        game.Balls.States[i].PassThrough = true;
+        game.Balls.Sprites[i].Color = glm::vec3(1.0f, 0.5f, 0.5f);
     }
-    else if (powerUp.Type == "confuse") {
-        if (!Effects->Chaos)
-            Effects->Confuse = true;
+}
+
+void PassThroughDeactivate(Game &game) {
+    for (unsigned int i = 0; i < game.Balls.Size(); ++i) {
+        game.Balls.States[i].PassThrough = false;
+        game.Balls.Sprites[i].Color = glm::vec3(1.0f);
     }
-    else if (powerUp.Type == "chaos") {
-        if (!Effects->Confuse)
-            Effects->Chaos = true;
+}
+
+void GrowActivate(Game &game) {
+    game.Paddle.Size.x += 50;
+}
+
+void MultiBallActivate(Game &game) {
+    // every ball in play splits, rotated copies fan out to either side of it
+    unsigned int balls = game.Balls.Size();
+    for (unsigned int i = 0; i < balls; ++i) {
+        glm::vec2 position = game.Balls.Transforms[i].Position;
+        glm::vec2 velocity = game.Balls.Motions[i].Velocity;
+        if (game.Balls.States[i].Stuck)
+            velocity = INITIAL_BALL_VELOCITY;
+        for (unsigned int k = 0; k < MULTIBALL_SPLIT; ++k) {
+            float angle = MULTIBALL_ANGLE * (k / 2 + 1) * (k % 2 ? 1.0f : -1.0f);
+            float c = std::cos(angle), s = std::sin(angle);
+            if (!game.SpawnBall(position, glm::vec2(c * velocity.x - s * velocity.y, s * velocity.x + c * velocity.y)))
+                return;
+        }
     }
 }
 
+void ConfuseActivate(Game &game) {
+    if (!Effects->Chaos)
+        Effects->Confuse = true;
+}
+
+void ConfuseDeactivate(Game &game) {
+    Effects->Confuse = false;
+}
+
+void ChaosActivate(Game &game) {
+    if (!Effects->Confuse)
+        Effects->Chaos = true;
+}
+
+void ChaosDeactivate(Game &game) {
+    Effects->Chaos = false;
+}
+
+const PowerUpDef POWERUP_DEFS[POWERUP_TYPE_COUNT] = {
+    // texture               file                                        duration odds color            activate             deactivate
+    { "powerup_speed",       "resources/textures/speed.png",          0.0f,  25, glm::vec3(1.0f), SpeedActivate,       nullptr               },
+    { "powerup_sticky",      "resources/textures/sticky.png",         20.0f, 25, glm::vec3(1.0f), StickyActivate,      StickyDeactivate      },
+    { "powerup_passthrough", "resources/textures/pass-through.png",   10.0f, 25, glm::vec3(1.0f), PassThroughActivate, PassThroughDeactivate },
+    { "powerup_grow",        "resources/textures/grow.png",           0.0f,  25, glm::vec3(1.0f), GrowActivate,        nullptr               },
+    // negative powerups should spawn more often
+    { "powerup_confuse",     "resources/textures/confuse.png",        15.0f, 15, glm::vec3(1.0f), ConfuseActivate,     ConfuseDeactivate     },
+    { "powerup_chaos",       "resources/textures/chaos.png",          15.0f, 15, glm::vec3(1.0f), ChaosActivate,       ChaosDeactivate       },
+    // no icon of its own yet, the speed icon tinted green stands in
+    { "powerup_multiball",   "resources/textures/speed.png",          0.0f,  40, glm::vec3(0.5f, 1.0f, 0.5f), MultiBallActivate, nullptr      }
+};
@@ -1,47 +1,110 @@
 #include "../include/game_level.h"
 #include "../include/resource_manager.h"
+#include "../include/asset_pack.h"
+#include "../include/memory_tracker.h"
+#include "../include/log.h"
 
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
 
 
+GameLevel::GameLevel()
+    : dirtyBegin(0), dirtyEnd(0), textures(), textureCount(0) { }
+
 void GameLevel::Load(const char *file, unsigned int levelWidth, unsigned int levelHeight) {
     // clear old data
-    this->Bricks.clear();
-    // load from file
-    unsigned int tileCode;
-    GameLevel level;
-    std::string line;
-    std::ifstream fstream(file);
+    this->Bricks.Clear();
+    AssetData level(file);
+    if (!level.Valid()) {
+        // nothing to draw or reset until a level loads
+        this->upload();
+        return;
+    }
+    // one row per line of whitespace separated tile codes, parsed in place
     std::vector<std::vector<unsigned int>> tileData;
-    if (fstream)
-    {
-        while (std::getline(fstream, line))
-        {
-            std::istringstream sstream(line);
-            std::vector<unsigned int> row;
-            while (sstream >> tileCode)
-                row.push_back(tileCode);
-            tileData.push_back(row);
+    const char *text = level.Text();
+    const char *end = text + level.Size();
+    while (text < end) {
+        const char *lineEnd = std::find(text, end, '\n');
+        std::vector<unsigned int> row;
+        while (text < lineEnd) {
+            while (text < lineEnd && std::isspace((unsigned char)*text))
+                ++text;
+            if (text == lineEnd || !std::isdigit((unsigned char)*text))
+                break;
+            unsigned int tileCode = 0;
+            while (text < lineEnd && std::isdigit((unsigned char)*text))
+                tileCode = tileCode * 10 + (*text++ - '0');
+            row.push_back(tileCode);
         }
-        if (tileData.size() > 0)
-            this->init(tileData, levelWidth, levelHeight);
+        tileData.push_back(row);
+        text = lineEnd < end ? lineEnd + 1 : end;
+    }
+    if (tileData.size() > 0)
+        this->init(tileData, levelWidth, levelHeight);
+    this->upload();
+}
+
+void GameLevel::Reset() {
+    for (unsigned int i = 0; i < this->Bricks.Size(); ++i) {
+        this->Bricks.States[i].Destroyed = false;
+        this->Bricks.Bounds.Set(i, this->Bricks.Transforms[i].Position, this->Bricks.Transforms[i].Size);
+    }
+    std::fill(this->visible.begin(), this->visible.end(), 1);
+    this->dirtyBegin = 0;
+    this->dirtyEnd = this->visible.size();
+}
+
+void GameLevel::Destroy(unsigned int brick) {
+    this->Bricks.States[brick].Destroyed = true;
+    this->Bricks.Bounds.Disable(brick);
+    this->visible[brick] = 0;
+    if (this->dirtyBegin == this->dirtyEnd) {
+        this->dirtyBegin = brick;
+        this->dirtyEnd = brick + 1;
+    }
+    else {
+        this->dirtyBegin = std::min(this->dirtyBegin, brick);
+        this->dirtyEnd = std::max(this->dirtyEnd, brick + 1);
     }
 }
 
-void GameLevel::Draw(SpriteRenderer &renderer) {
-    for (GameObject &tile : this->Bricks)
-        if (!tile.Destroyed)
-            tile.Draw(renderer);
+void GameLevel::Draw(Shader &shader) {
+    if (this->visible.empty())
+        return;
+    if (this->dirtyBegin != this->dirtyEnd) {
+        glBindBuffer(GL_ARRAY_BUFFER, this->visibleVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, this->dirtyBegin, this->dirtyEnd - this->dirtyBegin, this->visible.data() + this->dirtyBegin);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        this->dirtyBegin = this->dirtyEnd = 0;
+    }
+    shader.Use();
+    for (unsigned int i = 0; i < this->textureCount; ++i) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        this->textures[i]->Bind();
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(this->VAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, this->visible.size());
+    glBindVertexArray(0);
 }
 
 bool GameLevel::IsCompleted() {
-    for (GameObject &tile : this->Bricks) 
-        if (!tile.IsSolid && !tile.Destroyed)
+    // only the state column is touched
+    for (const BrickState &brick : this->Bricks.States)
+        if (!brick.Solid && !brick.Destroyed)
             return false;
     return true;
 }
 
+unsigned int GameLevel::BricksLeft() const {
+    unsigned int left = 0;
+    for (const BrickState &brick : this->Bricks.States)
+        left += !brick.Solid && !brick.Destroyed;
+    return left;
+}
+
 void GameLevel::init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight)
 {
     // calculate dimensions
@@ -56,9 +119,7 @@ void GameLevel::init(std::vector<std::vector<unsigned int>> tileData, unsigned i
             {
                 glm::vec2 pos(unit_width * x, unit_height * y);
                 glm::vec2 size(unit_width, unit_height);
-                GameObject obj(pos, size, ResourceManager::GetTexture("block_solid"), glm::vec3(0.8f, 0.8f, 0.7f));
-                obj.IsSolid = true;
-                this->Bricks.push_back(obj);
+                this->Bricks.Add(pos, size, ResourceManager::GetTexture("block_solid"), glm::vec3(0.8f, 0.8f, 0.7f), true);
             }
             else if (tileData[y][x] > 1)
             {
@@ -74,8 +135,66 @@ void GameLevel::init(std::vector<std::vector<unsigned int>> tileData, unsigned i
 
                 glm::vec2 pos(unit_width * x, unit_height * y);
                 glm::vec2 size(unit_width, unit_height);
-                this->Bricks.push_back(GameObject(pos, size, ResourceManager::GetTexture("block"), color));
+                this->Bricks.Add(pos, size, ResourceManager::GetTexture("block"), color, false);
             }
         }
     }
 }
+
+void GameLevel::upload() {
+    MemoryScope memoryScope(MEMORY_LEVEL);
+    std::vector<BrickInstance> instances(this->Bricks.Size());
+    this->textureCount = 0;
+    for (unsigned int i = 0; i < this->Bricks.Size(); ++i) {
+        const Texture2D *texture = this->Bricks.Sprites[i].Texture;
+        unsigned int layer = 0;
+        while (layer < this->textureCount && this->textures[layer] != texture)
+            ++layer;
+        if (layer == this->textureCount) {
+            if (this->textureCount == BRICK_TEXTURES) {
+                LOG_ERROR("LEVEL", "Too many brick textures", {{ "limit", BRICK_TEXTURES }});
+                layer = 0;
+            }
+            else
+                this->textures[this->textureCount++] = texture;
+        }
+        instances[i].Position = this->Bricks.Transforms[i].Position;
+        instances[i].Size = this->Bricks.Transforms[i].Size;
+        instances[i].Color = PackColor(this->Bricks.Sprites[i].Color);
+        instances[i].Layer = layer;
+    }
+    this->visible.assign(this->Bricks.Size(), 1);
+    this->dirtyBegin = this->dirtyEnd = 0;
+    this->memory.Track("bricks", this->Bricks.Bytes() + this->visible.capacity());
+    if (instances.empty())
+        return;
+
+    if (this->VAO == 0) {
+        this->VAO = VertexArrayHandle::Create();
+        this->instanceVBO = BufferHandle::Create();
+        this->visibleVBO = BufferHandle::Create();
+    }
+    glBindVertexArray(this->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(BrickInstance), instances.data(), GL_STATIC_DRAW);
+    MemoryTracker::TrackBuffer(this->instanceVBO, instances.size() * sizeof(BrickInstance));
+    MemoryTracker::Label(GLOBJECT_BUFFER, this->instanceVBO, "brick instances");
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(BrickInstance), (void*)offsetof(BrickInstance, Position));
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BrickInstance), (void*)offsetof(BrickInstance, Color));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(BrickInstance), (void*)offsetof(BrickInstance, Layer));
+    glVertexAttribDivisor(2, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, this->visibleVBO);
+    glBufferData(GL_ARRAY_BUFFER, this->visible.size(), this->visible.data(), GL_DYNAMIC_DRAW);
+    MemoryTracker::TrackBuffer(this->visibleVBO, this->visible.size());
+    MemoryTracker::Label(GLOBJECT_BUFFER, this->visibleVBO, "brick visibility");
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 1, GL_UNSIGNED_BYTE, GL_FALSE, 1, (void*)0);
+    glVertexAttribDivisor(3, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
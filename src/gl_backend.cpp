@@ -0,0 +1,565 @@
+#include "../include/gl_backend.h"
+#include "../include/log.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// errors past this many are counted but not printed
+const unsigned int MAX_REPORTED_ERRORS = 32;
+const unsigned int MAX_TEXTURE_UNITS   = 32;
+
+static bool                              recording = false;
+static bool                              counting = false;
+static GLStats                           frame, lastFrame;
+static unsigned int                      errors = 0;
+static GLuint                            nextName = 1;
+static std::unordered_set<GLuint>        live[GLOBJECT_KIND_COUNT];
+static std::unordered_map<GLuint, std::vector<unsigned char>> bufferContents;
+static std::unordered_map<GLenum, GLuint> boundBuffers; // by target
+static std::unordered_map<GLuint, GLenum> mappedBuffers; // name to map access flags
+static GLuint                            boundProgram, boundVertexArray, boundReadFramebuffer, boundDrawFramebuffer, boundRenderbuffer;
+static GLuint                            boundTextures[MAX_TEXTURE_UNITS];
+static unsigned int                      activeUnit;
+
+static const char *KIND_NAMES[GLOBJECT_KIND_COUNT] = {
+    "buffer", "texture", "vertex array", "framebuffer", "renderbuffer", "query", "shader", "program", "sync"
+};
+
+static void error(const char *call, const char *message, GLuint name = 0) {
+    if (++errors <= MAX_REPORTED_ERRORS)
+        LOG_ERROR("GL_RECORDING", message, {{ "call", call }, { "name", name }});
+}
+
+static void create(GLObjectKind kind, GLsizei n, GLuint *names) {
+    for (GLsizei i = 0; i < n; ++i) {
+        names[i] = nextName++;
+        live[kind].insert(names[i]);
+    }
+}
+
+static void destroy(const char *call, GLObjectKind kind, GLuint name) {
+    // deleting 0 is allowed and ignored
+    if (name == 0)
+        return;
+    if (live[kind].erase(name) == 0)
+        error(call, "deleting a name that is not alive", name);
+}
+
+static void bind(const char *call, GLObjectKind kind, GLuint &binding, GLuint name) {
+    ++frame.Binds;
+    if (binding == name)
+        ++frame.RedundantBinds;
+    if (name != 0 && live[kind].count(name) == 0)
+        error(call, "binding a name that is not alive", name);
+    binding = name;
+}
+
+static GLuint &bufferBinding(GLenum target) {
+    return boundBuffers[target];
+}
+
+static std::vector<unsigned char> *boundContents(const char *call, GLenum target) {
+    GLuint buffer = bufferBinding(target);
+    if (buffer == 0) {
+        error(call, "no buffer bound to target", target);
+        return nullptr;
+    }
+    return &bufferContents[buffer];
+}
+
+static void draw(const char *call, GLsizei instances) {
+    ++frame.DrawCalls;
+    frame.Instances += instances;
+    // the core profile has no default vertex array
+    if (boundVertexArray == 0)
+        error(call, "drawing without a vertex array", 0);
+    if (boundProgram == 0)
+        error(call, "drawing without a program", 0);
+}
+
+// objects
+
+static void APIENTRY recGenBuffers(GLsizei n, GLuint *names) { create(GLOBJECT_BUFFER, n, names); }
+static void APIENTRY recGenTextures(GLsizei n, GLuint *names) { create(GLOBJECT_TEXTURE, n, names); }
+static void APIENTRY recGenVertexArrays(GLsizei n, GLuint *names) { create(GLOBJECT_VERTEX_ARRAY, n, names); }
+static void APIENTRY recGenFramebuffers(GLsizei n, GLuint *names) { create(GLOBJECT_FRAMEBUFFER, n, names); }
+static void APIENTRY recGenRenderbuffers(GLsizei n, GLuint *names) { create(GLOBJECT_RENDERBUFFER, n, names); }
+static void APIENTRY recGenQueries(GLsizei n, GLuint *names) { create(GLOBJECT_QUERY, n, names); }
+static GLuint APIENTRY recCreateShader(GLenum /*type*/) { GLuint name; create(GLOBJECT_SHADER, 1, &name); return name; }
+static GLuint APIENTRY recCreateProgram() { GLuint name; create(GLOBJECT_PROGRAM, 1, &name); return name; }
+
+static void APIENTRY recDeleteBuffers(GLsizei n, const GLuint *names) {
+    for (GLsizei i = 0; i < n; ++i) {
+        destroy("glDeleteBuffers", GLOBJECT_BUFFER, names[i]);
+        bufferContents.erase(names[i]);
+        mappedBuffers.erase(names[i]);
+        for (auto &binding : boundBuffers)
+            if (binding.second == names[i])
+                binding.second = 0;
+    }
+}
+static void APIENTRY recDeleteTextures(GLsizei n, const GLuint *names) {
+    for (GLsizei i = 0; i < n; ++i) {
+        destroy("glDeleteTextures", GLOBJECT_TEXTURE, names[i]);
+        for (GLuint &binding : boundTextures)
+            if (binding == names[i])
+                binding = 0;
+    }
+}
+static void APIENTRY recDeleteVertexArrays(GLsizei n, const GLuint *names) {
+    for (GLsizei i = 0; i < n; ++i) {
+        destroy("glDeleteVertexArrays", GLOBJECT_VERTEX_ARRAY, names[i]);
+        if (boundVertexArray == names[i])
+            boundVertexArray = 0;
+    }
+}
+static void APIENTRY recDeleteFramebuffers(GLsizei n, const GLuint *names) {
+    for (GLsizei i = 0; i < n; ++i) {
+        destroy("glDeleteFramebuffers", GLOBJECT_FRAMEBUFFER, names[i]);
+        if (boundReadFramebuffer == names[i])
+            boundReadFramebuffer = 0;
+        if (boundDrawFramebuffer == names[i])
+            boundDrawFramebuffer = 0;
+    }
+}
+static void APIENTRY recDeleteRenderbuffers(GLsizei n, const GLuint *names) {
+    for (GLsizei i = 0; i < n; ++i) {
+        destroy("glDeleteRenderbuffers", GLOBJECT_RENDERBUFFER, names[i]);
+        if (boundRenderbuffer == names[i])
+            boundRenderbuffer = 0;
+    }
+}
+static void APIENTRY recDeleteQueries(GLsizei n, const GLuint *names) {
+    for (GLsizei i = 0; i < n; ++i)
+        destroy("glDeleteQueries", GLOBJECT_QUERY, names[i]);
+}
+static void APIENTRY recDeleteShader(GLuint name) { destroy("glDeleteShader", GLOBJECT_SHADER, name); }
+static void APIENTRY recDeleteProgram(GLuint name) {
+    destroy("glDeleteProgram", GLOBJECT_PROGRAM, name);
+    if (boundProgram == name)
+        boundProgram = 0;
+}
+
+static GLsync APIENTRY recFenceSync(GLenum /*condition*/, GLbitfield /*flags*/) {
+    GLuint name;
+    create(GLOBJECT_SYNC, 1, &name);
+    return (GLsync)(uintptr_t)name;
+}
+static void APIENTRY recDeleteSync(GLsync sync) { destroy("glDeleteSync", GLOBJECT_SYNC, (GLuint)(uintptr_t)sync); }
+// nothing is ever pending
+static GLenum APIENTRY recClientWaitSync(GLsync /*sync*/, GLbitfield /*flags*/, GLuint64 /*timeout*/) { return GL_ALREADY_SIGNALED; }
+
+// binds
+
+static void APIENTRY recUseProgram(GLuint program) { bind("glUseProgram", GLOBJECT_PROGRAM, boundProgram, program); }
+static void APIENTRY recBindVertexArray(GLuint array) { bind("glBindVertexArray", GLOBJECT_VERTEX_ARRAY, boundVertexArray, array); }
+static void APIENTRY recBindBuffer(GLenum target, GLuint buffer) { bind("glBindBuffer", GLOBJECT_BUFFER, bufferBinding(target), buffer); }
+static void APIENTRY recBindBufferBase(GLenum target, GLuint /*index*/, GLuint buffer) {
+    bind("glBindBufferBase", GLOBJECT_BUFFER, bufferBinding(target), buffer);
+}
+static void APIENTRY recActiveTexture(GLenum texture) {
+    activeUnit = texture - GL_TEXTURE0;
+    if (activeUnit >= MAX_TEXTURE_UNITS) {
+        error("glActiveTexture", "texture unit out of range", activeUnit);
+        activeUnit = 0;
+    }
+}
+static void APIENTRY recBindTexture(GLenum /*target*/, GLuint texture) {
+    bind("glBindTexture", GLOBJECT_TEXTURE, boundTextures[activeUnit], texture);
+}
+static void APIENTRY recBindFramebuffer(GLenum target, GLuint framebuffer) {
+    if (target == GL_READ_FRAMEBUFFER)
+        bind("glBindFramebuffer", GLOBJECT_FRAMEBUFFER, boundReadFramebuffer, framebuffer);
+    else if (target == GL_DRAW_FRAMEBUFFER)
+        bind("glBindFramebuffer", GLOBJECT_FRAMEBUFFER, boundDrawFramebuffer, framebuffer);
+    else {
+        bind("glBindFramebuffer", GLOBJECT_FRAMEBUFFER, boundDrawFramebuffer, framebuffer);
+        boundReadFramebuffer = framebuffer;
+    }
+}
+static void APIENTRY recBindRenderbuffer(GLenum /*target*/, GLuint renderbuffer) {
+    bind("glBindRenderbuffer", GLOBJECT_RENDERBUFFER, boundRenderbuffer, renderbuffer);
+}
+
+// buffer data
+
+static void APIENTRY recBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum /*usage*/) {
+    std::vector<unsigned char> *contents = boundContents("glBufferData", target);
+    if (!contents)
+        return;
+    contents->resize(size);
+    if (data) {
+        std::memcpy(contents->data(), data, size);
+        frame.BytesUploaded += size;
+    }
+}
+#ifdef GL_ARB_buffer_storage
+static void APIENTRY recBufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield /*flags*/) {
+    recBufferData(target, size, data, GL_STATIC_DRAW);
+}
+#endif
+static void APIENTRY recBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+    std::vector<unsigned char> *contents = boundContents("glBufferSubData", target);
+    if (!contents)
+        return;
+    if (offset < 0 || size < 0 || (size_t)(offset + size) > contents->size()) {
+        error("glBufferSubData", "range outside the buffer of", bufferBinding(target));
+        return;
+    }
+    std::memcpy(contents->data() + offset, data, size);
+    frame.BytesUploaded += size;
+}
+static void *APIENTRY recMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    std::vector<unsigned char> *contents = boundContents("glMapBufferRange", target);
+    if (!contents)
+        return nullptr;
+    GLuint buffer = bufferBinding(target);
+    if (mappedBuffers.count(buffer)) {
+        error("glMapBufferRange", "buffer is mapped already", buffer);
+        return nullptr;
+    }
+    if (offset < 0 || length <= 0 || (size_t)(offset + length) > contents->size()) {
+        error("glMapBufferRange", "range outside the buffer of", buffer);
+        return nullptr;
+    }
+    if (!(access & GL_MAP_PERSISTENT_BIT))
+        mappedBuffers[buffer] = access;
+    // explicitly flushed ranges count as they are flushed, other writable maps
+    // as a whole, a persistent map only once
+    if ((access & GL_MAP_WRITE_BIT) && !(access & GL_MAP_FLUSH_EXPLICIT_BIT))
+        frame.BytesUploaded += length;
+    return contents->data() + offset;
+}
+static void APIENTRY recFlushMappedBufferRange(GLenum target, GLintptr /*offset*/, GLsizeiptr length) {
+    GLuint buffer = bufferBinding(target);
+    auto mapped = mappedBuffers.find(buffer);
+    if (mapped == mappedBuffers.end() || !(mapped->second & GL_MAP_FLUSH_EXPLICIT_BIT))
+        error("glFlushMappedBufferRange", "buffer not mapped for explicit flushes", buffer);
+    else
+        frame.BytesUploaded += length;
+}
+static GLboolean APIENTRY recUnmapBuffer(GLenum target) {
+    GLuint buffer = bufferBinding(target);
+    if (mappedBuffers.erase(buffer) == 0) {
+        error("glUnmapBuffer", "buffer is not mapped", buffer);
+        return GL_FALSE;
+    }
+    return GL_TRUE;
+}
+
+static void APIENTRY recTexImage2D(GLenum /*target*/, GLint /*level*/, GLint /*internalformat*/, GLsizei width, GLsizei height, GLint /*border*/, GLenum format, GLenum /*type*/, const void *pixels) {
+    if (boundTextures[activeUnit] == 0)
+        error("glTexImage2D", "no texture bound to unit", activeUnit);
+    unsigned int channels = format == GL_RGBA ? 4 : format == GL_RGB ? 3 : format == GL_RG ? 2 : 1;
+    if (pixels)
+        frame.BytesUploaded += (unsigned long long)width * height * channels;
+}
+
+// uniforms
+
+static GLint APIENTRY recGetUniformLocation(GLuint /*program*/, const GLchar *name) {
+    // any stable non-negative value, uniforms are never read back
+    GLint location = 0;
+    for (const GLchar *c = name; *c; ++c)
+        location = (location * 31 + *c) & 0x7FFF;
+    return location;
+}
+static void uniform() {
+    ++frame.UniformUploads;
+    if (boundProgram == 0)
+        error("glUniform", "no program in use", 0);
+}
+static void APIENTRY recUniform1f(GLint /*location*/, GLfloat /*v0*/) { uniform(); }
+static void APIENTRY recUniform2f(GLint /*location*/, GLfloat /*v0*/, GLfloat /*v1*/) { uniform(); }
+static void APIENTRY recUniform3f(GLint /*location*/, GLfloat /*v0*/, GLfloat /*v1*/, GLfloat /*v2*/) { uniform(); }
+static void APIENTRY recUniform4f(GLint /*location*/, GLfloat /*v0*/, GLfloat /*v1*/, GLfloat /*v2*/, GLfloat /*v3*/) { uniform(); }
+static void APIENTRY recUniform1i(GLint /*location*/, GLint /*v0*/) { uniform(); }
+static void APIENTRY recUniform1fv(GLint /*location*/, GLsizei /*count*/, const GLfloat */*value*/) { uniform(); }
+static void APIENTRY recUniform2fv(GLint /*location*/, GLsizei /*count*/, const GLfloat */*value*/) { uniform(); }
+static void APIENTRY recUniform1iv(GLint /*location*/, GLsizei /*count*/, const GLint */*value*/) { uniform(); }
+static void APIENTRY recUniformMatrix4fv(GLint /*location*/, GLsizei /*count*/, GLboolean /*transpose*/, const GLfloat */*value*/) { uniform(); }
+
+// draws
+
+static void APIENTRY recDrawArrays(GLenum /*mode*/, GLint /*first*/, GLsizei /*count*/) { draw("glDrawArrays", 1); }
+static void APIENTRY recDrawArraysInstanced(GLenum /*mode*/, GLint /*first*/, GLsizei /*count*/, GLsizei instancecount) {
+    draw("glDrawArraysInstanced", instancecount);
+}
+static void APIENTRY recBlitFramebuffer(GLint /*srcX0*/, GLint /*srcY0*/, GLint /*srcX1*/, GLint /*srcY1*/, GLint /*dstX0*/, GLint /*dstY0*/, GLint /*dstX1*/, GLint /*dstY1*/, GLbitfield /*mask*/, GLenum /*filter*/) {
+    ++frame.DrawCalls;
+}
+static void APIENTRY recClear(GLbitfield /*mask*/) { }
+
+// shaders always compile and link
+
+static void APIENTRY recShaderSource(GLuint /*shader*/, GLsizei /*count*/, const GLchar *const */*string*/, const GLint */*length*/) { }
+static void APIENTRY recCompileShader(GLuint /*shader*/) { }
+static void APIENTRY recAttachShader(GLuint /*program*/, GLuint /*shader*/) { }
+static void APIENTRY recLinkProgram(GLuint /*program*/) { }
+static void APIENTRY recTransformFeedbackVaryings(GLuint /*program*/, GLsizei /*count*/, const GLchar *const */*varyings*/, GLenum /*bufferMode*/) { }
+static void APIENTRY recGetShaderiv(GLuint /*shader*/, GLenum pname, GLint *params) { *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0; }
+static void APIENTRY recGetProgramiv(GLuint /*program*/, GLenum pname, GLint *params) { *params = pname == GL_LINK_STATUS ? GL_TRUE : 0; }
+static void APIENTRY recGetShaderInfoLog(GLuint /*shader*/, GLsizei bufSize, GLsizei */*length*/, GLchar *infoLog) { if (bufSize > 0) infoLog[0] = 0; }
+static void APIENTRY recGetProgramInfoLog(GLuint /*program*/, GLsizei bufSize, GLsizei */*length*/, GLchar *infoLog) { if (bufSize > 0) infoLog[0] = 0; }
+
+// queries report finished right away and no time spent
+
+static void APIENTRY recBeginQuery(GLenum /*target*/, GLuint /*id*/) { }
+static void APIENTRY recEndQuery(GLenum /*target*/) { }
+static void APIENTRY recGetQueryObjectiv(GLuint /*id*/, GLenum pname, GLint *params) { *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0; }
+static void APIENTRY recGetQueryObjectui64v(GLuint /*id*/, GLenum /*pname*/, GLuint64 *params) { *params = 0; }
+static void APIENTRY recGetIntegerv(GLenum pname, GLint *data) { *data = pname == GL_MAX_SAMPLES ? 8 : 0; }
+static GLenum APIENTRY recCheckFramebufferStatus(GLenum /*target*/) { return GL_FRAMEBUFFER_COMPLETE; }
+
+// state that is not counted
+
+static void APIENTRY recEnable(GLenum /*cap*/) { }
+static void APIENTRY recDisable(GLenum /*cap*/) { }
+static void APIENTRY recBlendFunc(GLenum /*sfactor*/, GLenum /*dfactor*/) { }
+static void APIENTRY recViewport(GLint /*x*/, GLint /*y*/, GLsizei /*width*/, GLsizei /*height*/) { }
+static void APIENTRY recClearColor(GLfloat /*red*/, GLfloat /*green*/, GLfloat /*blue*/, GLfloat /*alpha*/) { }
+static void APIENTRY recFinish() { }
+static void APIENTRY recTexParameteri(GLenum /*target*/, GLenum /*pname*/, GLint /*param*/) { }
+static void APIENTRY recRenderbufferStorageMultisample(GLenum /*target*/, GLsizei /*samples*/, GLenum /*internalformat*/, GLsizei /*width*/, GLsizei /*height*/) { }
+static void APIENTRY recFramebufferRenderbuffer(GLenum /*target*/, GLenum /*attachment*/, GLenum /*renderbuffertarget*/, GLuint /*renderbuffer*/) { }
+static void APIENTRY recFramebufferTexture2D(GLenum /*target*/, GLenum /*attachment*/, GLenum /*textarget*/, GLuint /*texture*/, GLint /*level*/) { }
+static void APIENTRY recEnableVertexAttribArray(GLuint /*index*/) { }
+static void APIENTRY recVertexAttribDivisor(GLuint /*index*/, GLuint /*divisor*/) { }
+static void APIENTRY recVertexAttribPointer(GLuint index, GLint /*size*/, GLenum /*type*/, GLboolean /*normalized*/, GLsizei /*stride*/, const void */*pointer*/) {
+    if (bufferBinding(GL_ARRAY_BUFFER) == 0)
+        error("glVertexAttribPointer", "no array buffer bound for attribute", index);
+}
+static void APIENTRY recVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void *pointer) {
+    recVertexAttribPointer(index, size, type, GL_FALSE, stride, pointer);
+}
+static void APIENTRY recBeginTransformFeedback(GLenum /*primitiveMode*/) { }
+static void APIENTRY recEndTransformFeedback() { }
+
+// counters in front of the driver, see CountCalls
+
+static PFNGLUSEPROGRAMPROC            driverUseProgram;
+static PFNGLBINDVERTEXARRAYPROC       driverBindVertexArray;
+static PFNGLBINDBUFFERPROC            driverBindBuffer;
+static PFNGLBINDBUFFERBASEPROC        driverBindBufferBase;
+static PFNGLBINDTEXTUREPROC           driverBindTexture;
+static PFNGLBINDFRAMEBUFFERPROC       driverBindFramebuffer;
+static PFNGLBINDRENDERBUFFERPROC      driverBindRenderbuffer;
+static PFNGLUNIFORM1FPROC             driverUniform1f;
+static PFNGLUNIFORM2FPROC             driverUniform2f;
+static PFNGLUNIFORM3FPROC             driverUniform3f;
+static PFNGLUNIFORM4FPROC             driverUniform4f;
+static PFNGLUNIFORM1IPROC             driverUniform1i;
+static PFNGLUNIFORM1FVPROC            driverUniform1fv;
+static PFNGLUNIFORM2FVPROC            driverUniform2fv;
+static PFNGLUNIFORM1IVPROC            driverUniform1iv;
+static PFNGLUNIFORMMATRIX4FVPROC      driverUniformMatrix4fv;
+static PFNGLDRAWARRAYSPROC            driverDrawArrays;
+static PFNGLDRAWARRAYSINSTANCEDPROC   driverDrawArraysInstanced;
+static PFNGLBLITFRAMEBUFFERPROC       driverBlitFramebuffer;
+
+static void APIENTRY countUseProgram(GLuint program) { ++frame.Binds; driverUseProgram(program); }
+static void APIENTRY countBindVertexArray(GLuint array) { ++frame.Binds; driverBindVertexArray(array); }
+static void APIENTRY countBindBuffer(GLenum target, GLuint buffer) { ++frame.Binds; driverBindBuffer(target, buffer); }
+static void APIENTRY countBindBufferBase(GLenum target, GLuint index, GLuint buffer) { ++frame.Binds; driverBindBufferBase(target, index, buffer); }
+static void APIENTRY countBindTexture(GLenum target, GLuint texture) { ++frame.Binds; driverBindTexture(target, texture); }
+static void APIENTRY countBindFramebuffer(GLenum target, GLuint framebuffer) { ++frame.Binds; driverBindFramebuffer(target, framebuffer); }
+static void APIENTRY countBindRenderbuffer(GLenum target, GLuint renderbuffer) { ++frame.Binds; driverBindRenderbuffer(target, renderbuffer); }
+static void APIENTRY countUniform1f(GLint location, GLfloat v0) { ++frame.UniformUploads; driverUniform1f(location, v0); }
+static void APIENTRY countUniform2f(GLint location, GLfloat v0, GLfloat v1) { ++frame.UniformUploads; driverUniform2f(location, v0, v1); }
+static void APIENTRY countUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) { ++frame.UniformUploads; driverUniform3f(location, v0, v1, v2); }
+static void APIENTRY countUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) { ++frame.UniformUploads; driverUniform4f(location, v0, v1, v2, v3); }
+static void APIENTRY countUniform1i(GLint location, GLint v0) { ++frame.UniformUploads; driverUniform1i(location, v0); }
+static void APIENTRY countUniform1fv(GLint location, GLsizei count, const GLfloat *value) { ++frame.UniformUploads; driverUniform1fv(location, count, value); }
+static void APIENTRY countUniform2fv(GLint location, GLsizei count, const GLfloat *value) { ++frame.UniformUploads; driverUniform2fv(location, count, value); }
+static void APIENTRY countUniform1iv(GLint location, GLsizei count, const GLint *value) { ++frame.UniformUploads; driverUniform1iv(location, count, value); }
+static void APIENTRY countUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+    ++frame.UniformUploads;
+    driverUniformMatrix4fv(location, count, transpose, value);
+}
+static void APIENTRY countDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    ++frame.DrawCalls;
+    ++frame.Instances;
+    driverDrawArrays(mode, first, count);
+}
+static void APIENTRY countDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+    ++frame.DrawCalls;
+    frame.Instances += instancecount;
+    driverDrawArraysInstanced(mode, first, count, instancecount);
+}
+static void APIENTRY countBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter) {
+    ++frame.DrawCalls;
+    driverBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+}
+
+// puts the counter in the table and keeps the driver entry point, or puts it back
+template <typename Entry>
+static void divert(Entry &entry, Entry &driver, Entry counter, bool count) {
+    if (count) {
+        driver = entry;
+        entry = counter;
+    }
+    else
+        entry = driver;
+}
+
+bool GLBackend::UseGLAD(GLADloadproc loader) {
+    recording = false;
+    counting = false;
+    return gladLoadGLLoader(loader) != 0;
+}
+
+void GLBackend::UseRecording() {
+    recording = true;
+    counting = false;
+    frame = lastFrame = GLStats();
+    errors = 0;
+    nextName = 1;
+    for (std::unordered_set<GLuint> &names : live)
+        names.clear();
+    bufferContents.clear();
+    boundBuffers.clear();
+    mappedBuffers.clear();
+    boundProgram = boundVertexArray = boundReadFramebuffer = boundDrawFramebuffer = boundRenderbuffer = 0;
+    std::memset(boundTextures, 0, sizeof(boundTextures));
+    activeUnit = 0;
+    // ranges are mapped one at a time, so their bytes can be counted
+    GLAD_GL_ARB_buffer_storage = 0;
+
+    // every entry point the game calls, anything else stays null
+    glad_glGenBuffers = recGenBuffers;
+    glad_glGenTextures = recGenTextures;
+    glad_glGenVertexArrays = recGenVertexArrays;
+    glad_glGenFramebuffers = recGenFramebuffers;
+    glad_glGenRenderbuffers = recGenRenderbuffers;
+    glad_glGenQueries = recGenQueries;
+    glad_glCreateShader = recCreateShader;
+    glad_glCreateProgram = recCreateProgram;
+    glad_glDeleteBuffers = recDeleteBuffers;
+    glad_glDeleteTextures = recDeleteTextures;
+    glad_glDeleteVertexArrays = recDeleteVertexArrays;
+    glad_glDeleteFramebuffers = recDeleteFramebuffers;
+    glad_glDeleteRenderbuffers = recDeleteRenderbuffers;
+    glad_glDeleteQueries = recDeleteQueries;
+    glad_glDeleteShader = recDeleteShader;
+    glad_glDeleteProgram = recDeleteProgram;
+    glad_glFenceSync = recFenceSync;
+    glad_glDeleteSync = recDeleteSync;
+    glad_glClientWaitSync = recClientWaitSync;
+    glad_glUseProgram = recUseProgram;
+    glad_glBindVertexArray = recBindVertexArray;
+    glad_glBindBuffer = recBindBuffer;
+    glad_glBindBufferBase = recBindBufferBase;
+    glad_glActiveTexture = recActiveTexture;
+    glad_glBindTexture = recBindTexture;
+    glad_glBindFramebuffer = recBindFramebuffer;
+    glad_glBindRenderbuffer = recBindRenderbuffer;
+    glad_glBufferData = recBufferData;
+#ifdef GL_ARB_buffer_storage
+    glad_glBufferStorage = recBufferStorage;
+#endif
+    glad_glBufferSubData = recBufferSubData;
+    glad_glMapBufferRange = recMapBufferRange;
+    glad_glFlushMappedBufferRange = recFlushMappedBufferRange;
+    glad_glUnmapBuffer = recUnmapBuffer;
+    glad_glTexImage2D = recTexImage2D;
+    glad_glGetUniformLocation = recGetUniformLocation;
+    glad_glUniform1f = recUniform1f;
+    glad_glUniform2f = recUniform2f;
+    glad_glUniform3f = recUniform3f;
+    glad_glUniform4f = recUniform4f;
+    glad_glUniform1i = recUniform1i;
+    glad_glUniform1fv = recUniform1fv;
+    glad_glUniform2fv = recUniform2fv;
+    glad_glUniform1iv = recUniform1iv;
+    glad_glUniformMatrix4fv = recUniformMatrix4fv;
+    glad_glDrawArrays = recDrawArrays;
+    glad_glDrawArraysInstanced = recDrawArraysInstanced;
+    glad_glBlitFramebuffer = recBlitFramebuffer;
+    glad_glClear = recClear;
+    glad_glShaderSource = recShaderSource;
+    glad_glCompileShader = recCompileShader;
+    glad_glAttachShader = recAttachShader;
+    glad_glLinkProgram = recLinkProgram;
+    glad_glTransformFeedbackVaryings = recTransformFeedbackVaryings;
+    glad_glGetShaderiv = recGetShaderiv;
+    glad_glGetProgramiv = recGetProgramiv;
+    glad_glGetShaderInfoLog = recGetShaderInfoLog;
+    glad_glGetProgramInfoLog = recGetProgramInfoLog;
+    glad_glBeginQuery = recBeginQuery;
+    glad_glEndQuery = recEndQuery;
+    glad_glGetQueryObjectiv = recGetQueryObjectiv;
+    glad_glGetQueryObjectui64v = recGetQueryObjectui64v;
+    glad_glGetIntegerv = recGetIntegerv;
+    glad_glCheckFramebufferStatus = recCheckFramebufferStatus;
+    glad_glEnable = recEnable;
+    glad_glDisable = recDisable;
+    glad_glBlendFunc = recBlendFunc;
+    glad_glViewport = recViewport;
+    glad_glClearColor = recClearColor;
+    glad_glFinish = recFinish;
+    glad_glTexParameteri = recTexParameteri;
+    glad_glRenderbufferStorageMultisample = recRenderbufferStorageMultisample;
+    glad_glFramebufferRenderbuffer = recFramebufferRenderbuffer;
+    glad_glFramebufferTexture2D = recFramebufferTexture2D;
+    glad_glEnableVertexAttribArray = recEnableVertexAttribArray;
+    glad_glVertexAttribDivisor = recVertexAttribDivisor;
+    glad_glVertexAttribPointer = recVertexAttribPointer;
+    glad_glVertexAttribIPointer = recVertexAttribIPointer;
+    glad_glBeginTransformFeedback = recBeginTransformFeedback;
+    glad_glEndTransformFeedback = recEndTransformFeedback;
+}
+
+bool GLBackend::Recording() {
+    return recording;
+}
+
+void GLBackend::CountCalls(bool count) {
+    if (recording || count == counting)
+        return;
+    counting = count;
+    frame = lastFrame = GLStats();
+    divert(glad_glUseProgram, driverUseProgram, countUseProgram, count);
+    divert(glad_glBindVertexArray, driverBindVertexArray, countBindVertexArray, count);
+    divert(glad_glBindBuffer, driverBindBuffer, countBindBuffer, count);
+    divert(glad_glBindBufferBase, driverBindBufferBase, countBindBufferBase, count);
+    divert(glad_glBindTexture, driverBindTexture, countBindTexture, count);
+    divert(glad_glBindFramebuffer, driverBindFramebuffer, countBindFramebuffer, count);
+    divert(glad_glBindRenderbuffer, driverBindRenderbuffer, countBindRenderbuffer, count);
+    divert(glad_glUniform1f, driverUniform1f, countUniform1f, count);
+    divert(glad_glUniform2f, driverUniform2f, countUniform2f, count);
+    divert(glad_glUniform3f, driverUniform3f, countUniform3f, count);
+    divert(glad_glUniform4f, driverUniform4f, countUniform4f, count);
+    divert(glad_glUniform1i, driverUniform1i, countUniform1i, count);
+    divert(glad_glUniform1fv, driverUniform1fv, countUniform1fv, count);
+    divert(glad_glUniform2fv, driverUniform2fv, countUniform2fv, count);
+    divert(glad_glUniform1iv, driverUniform1iv, countUniform1iv, count);
+    divert(glad_glUniformMatrix4fv, driverUniformMatrix4fv, countUniformMatrix4fv, count);
+    divert(glad_glDrawArrays, driverDrawArrays, countDrawArrays, count);
+    divert(glad_glDrawArraysInstanced, driverDrawArraysInstanced, countDrawArraysInstanced, count);
+    divert(glad_glBlitFramebuffer, driverBlitFramebuffer, countBlitFramebuffer, count);
+}
+
+void GLBackend::EndFrame() {
+    lastFrame = frame;
+    frame = GLStats();
+}
+
+const GLStats &GLBackend::LastFrame() {
+    return lastFrame;
+}
+
+unsigned int GLBackend::LiveObjects(GLObjectKind kind) {
+    return live[kind].size();
+}
+
+unsigned int GLBackend::Errors() {
+    return errors;
+}
+
+const char *GLBackend::KindName(GLObjectKind kind) {
+    return KIND_NAMES[kind];
+}
@@ -0,0 +1,21 @@
+#include "../include/input_queue.h"
+
+
+bool InputQueue::Push(int key, bool pressed, double time) {
+    if (this->tail - this->head == INPUT_QUEUE_SIZE) {
+        ++this->Dropped;
+        return false;
+    }
+    InputEvent &event = this->events[this->tail++ % INPUT_QUEUE_SIZE];
+    event.Time = time;
+    event.Key = key;
+    event.Pressed = pressed;
+    return true;
+}
+
+bool InputQueue::Pop(double time, InputEvent &event) {
+    if (this->Empty() || this->events[this->head % INPUT_QUEUE_SIZE].Time > time)
+        return false;
+    event = this->events[this->head++ % INPUT_QUEUE_SIZE];
+    return true;
+}
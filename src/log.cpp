@@ -0,0 +1,338 @@
+#include "../include/log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+// how long the writer sleeps with nothing to write, and Flush between checks
+const std::chrono::milliseconds LOG_IDLE_WAIT(5);
+const std::chrono::microseconds LOG_FLUSH_POLL(200);
+// FieldCount of the filler that skips the unused end of a ring
+const unsigned short RECORD_PADDING = 0xFFFF;
+
+// A record in a ring: the header, its fields, then their text back to back.
+struct RecordHeader {
+    unsigned int       Size;       // all of it, a multiple of 8
+    unsigned short     FieldCount; // or RECORD_PADDING
+    unsigned short     Level;
+    unsigned long long Sequence;   // across threads, the writer merges by it
+    double             Time;       // seconds since the first record
+    const char        *Category;
+    const char        *Message;
+};
+
+struct StoredField {
+    const char  *Key;
+    unsigned int Type;
+    unsigned int Length; // of the text, for LOG_VALUE_TEXT
+    union {
+        long long          Int;
+        unsigned long long UInt;
+        double             Float;
+        bool               Bool;
+    };
+};
+
+const unsigned int LOG_MAX_RECORD = sizeof(RecordHeader) + LOG_MAX_FIELDS * (sizeof(StoredField) + LOG_MAX_TEXT);
+
+// single producer, the thread that owns it, and single consumer, the writer
+struct LogRing {
+    std::atomic<bool>         Owned;
+    std::atomic<unsigned int> Head; // free running, wrapped on access
+    std::atomic<unsigned int> Tail;
+    alignas(8) char           Bytes[LOG_RING_BYTES];
+};
+
+// gives the ring back when its thread ends, whatever is left in it is still written
+struct ThreadRing {
+    LogRing *Ring;
+    ThreadRing() : Ring(nullptr) { }
+    ~ThreadRing() {
+        if (this->Ring)
+            this->Ring->Owned.store(false, std::memory_order_release);
+    }
+};
+
+static LogRing                         rings[LOG_MAX_THREADS];
+static thread_local ThreadRing         threadRing;
+static std::atomic<unsigned long long> sequence(0);
+static std::atomic<unsigned int>       dropped(0);
+static std::atomic<bool>               running(false), stopped(false);
+static std::atomic<unsigned int>       publishing(0); // Writes between the stopped check and Head, Shutdown waits them out
+static std::once_flag                  startOnce;
+static std::thread                     writer;
+static std::mutex                      mutex; // the writer's sleep, and writing without it
+static std::condition_variable         wake;
+static bool                            quit = false;
+alignas(8) static char                 syncRecord[LOG_MAX_RECORD];
+
+// counts a Write in publishing for as long as it is in scope
+struct Publishing {
+    Publishing() { publishing.fetch_add(1); }
+    ~Publishing() { publishing.fetch_sub(1, std::memory_order_release); }
+};
+
+static double now() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void run();
+
+static void start() {
+    if (stopped.load(std::memory_order_acquire))
+        return;
+    now();
+    writer = std::thread(run);
+    running.store(true, std::memory_order_release);
+}
+
+static LogRing *claimRing() {
+    if (!threadRing.Ring)
+        for (LogRing &ring : rings) {
+            bool expected = false;
+            if (ring.Owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                threadRing.Ring = &ring;
+                break;
+            }
+        }
+    return threadRing.Ring;
+}
+
+static void serialize(char *destination, unsigned int size, LogLevel level, const char *category, const char *message,
+                      std::initializer_list<LogField> fields, unsigned int count, const unsigned int *lengths) {
+    RecordHeader *header = reinterpret_cast<RecordHeader*>(destination);
+    header->Size = size;
+    header->FieldCount = count;
+    header->Level = level;
+    header->Sequence = sequence.fetch_add(1, std::memory_order_relaxed);
+    header->Time = now();
+    header->Category = category;
+    header->Message = message;
+    StoredField *stored = reinterpret_cast<StoredField*>(header + 1);
+    char *text = reinterpret_cast<char*>(stored + count);
+    unsigned int i = 0;
+    for (const LogField &field : fields) {
+        if (i == count)
+            break;
+        stored[i].Key = field.Key;
+        stored[i].Type = field.Type;
+        stored[i].Length = lengths[i];
+        if (field.Type == LOG_VALUE_TEXT) {
+            std::memcpy(text, field.Text, lengths[i]);
+            text += lengths[i];
+        }
+        else
+            stored[i].UInt = field.UInt; // the widest member carries any of them
+        ++i;
+    }
+}
+
+static bool needsQuotes(const char *text, unsigned int length) {
+    if (length == 0)
+        return true;
+    for (unsigned int i = 0; i < length; ++i)
+        if (text[i] == ' ' || text[i] == '=' || text[i] == '"' || text[i] == '\n' || text[i] == '\t')
+            return true;
+    return false;
+}
+
+static void format(const RecordHeader *record, FILE *out) {
+    std::fprintf(out, "[%10.3f] %s::%s: %s", record->Time, Log::LevelName((LogLevel)record->Level), record->Category, record->Message);
+    const StoredField *fields = reinterpret_cast<const StoredField*>(record + 1);
+    const char *text = reinterpret_cast<const char*>(fields + record->FieldCount);
+    for (unsigned int i = 0; i < record->FieldCount; ++i) {
+        const StoredField &field = fields[i];
+        std::fprintf(out, " %s=", field.Key);
+        switch (field.Type) {
+        case LOG_VALUE_INT:   std::fprintf(out, "%lld", field.Int); break;
+        case LOG_VALUE_UINT:  std::fprintf(out, "%llu", field.UInt); break;
+        case LOG_VALUE_FLOAT: std::fprintf(out, "%g", field.Float); break;
+        case LOG_VALUE_BOOL:  std::fputs(field.Bool ? "true" : "false", out); break;
+        default:
+            if (!needsQuotes(text, field.Length))
+                std::fwrite(text, 1, field.Length, out);
+            else {
+                // one line per record, whatever the text holds
+                std::fputc('"', out);
+                for (unsigned int c = 0; c < field.Length; ++c) {
+                    if (text[c] == '\n')
+                        std::fputs("\\n", out);
+                    else if (text[c] == '\t')
+                        std::fputs("\\t", out);
+                    else if (text[c] == '"' || text[c] == '\\') {
+                        std::fputc('\\', out);
+                        std::fputc(text[c], out);
+                    }
+                    else
+                        std::fputc(text[c], out);
+                }
+                std::fputc('"', out);
+            }
+            text += field.Length;
+        }
+    }
+    std::fputc('\n', out);
+}
+
+static const RecordHeader *at(LogRing &ring, unsigned int position) {
+    return reinterpret_cast<const RecordHeader*>(ring.Bytes + position % LOG_RING_BYTES);
+}
+
+// writes everything published so far, oldest first across the rings
+static bool drain() {
+    static unsigned int reported = 0;
+    bool wrote = false;
+    while (true) {
+        LogRing *oldest = nullptr;
+        const RecordHeader *record = nullptr;
+        for (LogRing &ring : rings) {
+            unsigned int tail = ring.Tail.load(std::memory_order_relaxed);
+            unsigned int head = ring.Head.load(std::memory_order_acquire);
+            while (tail != head && at(ring, tail)->FieldCount == RECORD_PADDING) {
+                tail += at(ring, tail)->Size;
+                ring.Tail.store(tail, std::memory_order_release);
+            }
+            if (tail != head && (!record || at(ring, tail)->Sequence < record->Sequence)) {
+                oldest = &ring;
+                record = at(ring, tail);
+            }
+        }
+        if (!oldest)
+            break;
+        format(record, stdout);
+        oldest->Tail.store(oldest->Tail.load(std::memory_order_relaxed) + record->Size, std::memory_order_release);
+        wrote = true;
+    }
+    unsigned int lost = dropped.load(std::memory_order_relaxed);
+    if (lost != reported) {
+        std::fprintf(stdout, "[%10.3f] WARNING::LOG: Records dropped, a ring was full or every ring taken dropped=%u\n", now(), lost - reported);
+        reported = lost;
+        wrote = true;
+    }
+    return wrote;
+}
+
+static void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        lock.unlock();
+        bool wrote = drain();
+        if (wrote)
+            std::fflush(stdout);
+        lock.lock();
+        if (!wrote) {
+            if (quit)
+                return;
+            wake.wait_for(lock, LOG_IDLE_WAIT);
+        }
+    }
+}
+
+static bool empty() {
+    for (LogRing &ring : rings)
+        if (ring.Tail.load(std::memory_order_acquire) != ring.Head.load(std::memory_order_acquire))
+            return false;
+    return true;
+}
+
+void Log::Write(LogLevel level, const char *category, const char *message, std::initializer_list<LogField> fields) {
+    if (!stopped.load(std::memory_order_acquire))
+        std::call_once(startOnce, start);
+    unsigned int count = std::min((unsigned int)fields.size(), LOG_MAX_FIELDS);
+    unsigned int lengths[LOG_MAX_FIELDS];
+    unsigned int size = sizeof(RecordHeader) + count * sizeof(StoredField);
+    unsigned int i = 0;
+    for (const LogField &field : fields) {
+        if (i == count)
+            break;
+        lengths[i] = field.Type == LOG_VALUE_TEXT ? strnlen(field.Text, LOG_MAX_TEXT) : 0;
+        size += lengths[i++];
+    }
+    size = (size + 7) & ~7u;
+
+    // counted before stopped is read, so Shutdown either sees this Write or this Write sees stopped
+    Publishing publish;
+    if (!running.load(std::memory_order_acquire) || stopped.load()) {
+        // no writer, or not any more
+        std::lock_guard<std::mutex> lock(mutex);
+        serialize(syncRecord, size, level, category, message, fields, count, lengths);
+        format(reinterpret_cast<const RecordHeader*>(syncRecord), stdout);
+        std::fflush(stdout);
+        return;
+    }
+    LogRing *ring = claimRing();
+    if (!ring) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    unsigned int head = ring->Head.load(std::memory_order_relaxed);
+    unsigned int tail = ring->Tail.load(std::memory_order_acquire);
+    unsigned int contiguous = LOG_RING_BYTES - head % LOG_RING_BYTES;
+    unsigned int needed = contiguous < size ? contiguous + size : size;
+    if (LOG_RING_BYTES - (head - tail) < needed) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (contiguous < size) {
+        // records never wrap, the rest of the ring is skipped
+        RecordHeader *padding = reinterpret_cast<RecordHeader*>(ring->Bytes + head % LOG_RING_BYTES);
+        padding->Size = contiguous;
+        padding->FieldCount = RECORD_PADDING;
+        head += contiguous;
+    }
+    serialize(ring->Bytes + head % LOG_RING_BYTES, size, level, category, message, fields, count, lengths);
+    ring->Head.store(head + size, std::memory_order_release);
+    // a burst gets the writer up before the ring fills, otherwise it wakes on its own
+    if (head - tail < LOG_RING_BYTES / 2 && head + size - tail >= LOG_RING_BYTES / 2)
+        wake.notify_one();
+}
+
+void Log::Flush() {
+    if (running.load(std::memory_order_acquire) && !stopped.load(std::memory_order_acquire)) {
+        wake.notify_one();
+        while (!empty())
+            std::this_thread::sleep_for(LOG_FLUSH_POLL);
+    }
+    std::fflush(stdout);
+}
+
+void Log::Shutdown() {
+    if (stopped.exchange(true))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+    if (writer.joinable())
+        writer.join();
+    // a Write that saw the writer still running may publish after its last drain
+    while (publishing.load(std::memory_order_acquire) != 0)
+        std::this_thread::yield();
+    {
+        // Writes from here on are synchronous and print under the lock
+        std::lock_guard<std::mutex> lock(mutex);
+        drain();
+    }
+    std::fflush(stdout);
+}
+
+unsigned int Log::Dropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+const char *Log::LevelName(LogLevel level) {
+    static const char *names[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+    return level <= LOG_LEVEL_ERROR ? names[level] : "UNKNOWN";
+}
+
+// everything logged before exit gets written
+static struct LogShutdown {
+    ~LogShutdown() { Log::Shutdown(); }
+} shutdownAtExit;
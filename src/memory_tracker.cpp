@@ -0,0 +1,220 @@
+#include "../include/memory_tracker.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../include/log.h"
+
+static MemoryRecord records[MEMORY_MAX_RECORDS];
+static unsigned int recordCount = 0;
+static unsigned int dropped = 0; // records that did not fit
+static MemoryStats  stats;
+static MemoryOwner  currentOwner = MEMORY_GENERAL;
+static unsigned int nextToken = 1;
+
+unsigned long long MemoryStats::TotalGPUBytes() const {
+    unsigned long long total = 0;
+    for (unsigned int i = 0; i < MEMORY_OWNER_COUNT; ++i)
+        total += this->GPUBytes[i];
+    return total;
+}
+
+unsigned long long MemoryStats::TotalCPUBytes() const {
+    unsigned long long total = 0;
+    for (unsigned int i = 0; i < MEMORY_OWNER_COUNT; ++i)
+        total += this->CPUBytes[i];
+    return total;
+}
+
+static unsigned int bytesPerPixel(unsigned int format) {
+    switch (format) {
+    case GL_RED: case GL_R8:
+        return 1;
+    case GL_RG: case GL_RG8:
+        return 2;
+    case GL_RGBA16F: case GL_RGB16F:
+        return 8;
+    case GL_RGBA32F: case GL_RGB32F:
+        return 16;
+    default: // RGB(8) is padded, RGBA8, depth-stencil and the 32-bit single channels
+        return 4;
+    }
+}
+
+static int find(GLObjectKind kind, unsigned int name) {
+    for (unsigned int i = 0; i < recordCount; ++i)
+        if (records[i].Kind == kind && records[i].Name == name)
+            return i;
+    return -1;
+}
+
+static void add(const MemoryRecord &record, int sign) {
+    unsigned long long *bytes = record.Kind == GLOBJECT_KIND_COUNT ? stats.CPUBytes : stats.GPUBytes;
+    if (sign > 0) {
+        bytes[record.Owner] += record.Bytes;
+        ++stats.Records[record.Owner];
+    }
+    else {
+        bytes[record.Owner] -= record.Bytes;
+        --stats.Records[record.Owner];
+    }
+    stats.PeakGPUBytes = std::max(stats.PeakGPUBytes, stats.TotalGPUBytes());
+    stats.PeakCPUBytes = std::max(stats.PeakCPUBytes, stats.TotalCPUBytes());
+}
+
+void MemoryTracker::track(MemoryOwner owner, GLObjectKind kind, unsigned int name, unsigned int format, unsigned int width, unsigned int height,
+                          unsigned int samples, unsigned long long bytes) {
+    int index = find(kind, name);
+    MemoryRecord *record;
+    if (index >= 0) {
+        record = &records[index];
+        add(*record, -1);
+    }
+    else if (recordCount < MEMORY_MAX_RECORDS) {
+        record = &records[recordCount++];
+        record->Label[0] = '\0';
+    }
+    else {
+        if (dropped++ == 0)
+            LOG_WARNING("MEMORY", "Ledger full, the rest go uncounted", {{ "records", MEMORY_MAX_RECORDS }});
+        return;
+    }
+    record->Owner = owner;
+    record->Kind = kind;
+    record->Name = name;
+    record->Format = format;
+    record->Width = width;
+    record->Height = height;
+    record->Samples = samples;
+    record->Bytes = bytes;
+    add(*record, 1);
+}
+
+void MemoryTracker::TrackTexture(unsigned int name, unsigned int format, unsigned int width, unsigned int height) {
+    track(currentOwner, GLOBJECT_TEXTURE, name, format, width, height, 1, (unsigned long long)width * height * bytesPerPixel(format));
+}
+
+void MemoryTracker::TrackRenderbuffer(unsigned int name, unsigned int format, unsigned int width, unsigned int height, unsigned int samples) {
+    samples = std::max(samples, 1u);
+    track(currentOwner, GLOBJECT_RENDERBUFFER, name, format, width, height, samples, (unsigned long long)width * height * bytesPerPixel(format) * samples);
+}
+
+void MemoryTracker::TrackBuffer(unsigned int name, unsigned long long bytes) {
+    track(currentOwner, GLOBJECT_BUFFER, name, 0, 0, 0, 1, bytes);
+}
+
+void MemoryTracker::Release(GLObjectKind kind, unsigned int name) {
+    int index = find(kind, name);
+    if (index < 0)
+        return;
+    add(records[index], -1);
+    records[index] = records[--recordCount];
+}
+
+void MemoryTracker::Label(GLObjectKind kind, unsigned int name, const char *label) {
+    int index = find(kind, name);
+    if (index < 0)
+        return;
+    std::strncpy(records[index].Label, label, MEMORY_LABEL_LENGTH - 1);
+    records[index].Label[MEMORY_LABEL_LENGTH - 1] = '\0';
+}
+
+const MemoryStats &MemoryTracker::Stats() {
+    return stats;
+}
+
+unsigned int MemoryTracker::RecordCount() {
+    return recordCount;
+}
+
+const MemoryRecord &MemoryTracker::Record(unsigned int index) {
+    return records[index];
+}
+
+static void printRecord(FILE *out, const MemoryRecord &record) {
+    const char *kind = record.Kind == GLOBJECT_KIND_COUNT ? "cpu" : GLBackend::KindName(record.Kind);
+    char size[32] = "";
+    if (record.Width > 0 && record.Samples > 1)
+        std::snprintf(size, sizeof(size), "%ux%u x%u", record.Width, record.Height, record.Samples);
+    else if (record.Width > 0)
+        std::snprintf(size, sizeof(size), "%ux%u", record.Width, record.Height);
+    std::fprintf(out, "  %-14s %-13s %-24s %-9s %-14s %10.1f KB\n", MemoryTracker::OwnerName(record.Owner), kind,
+        record.Label[0] ? record.Label : "-", record.Format ? MemoryTracker::FormatName(record.Format) : "-", size, record.Bytes / 1024.0);
+}
+
+void MemoryTracker::Report(FILE *out) {
+    std::fprintf(out, "  %-14s %-13s %-24s %-9s %-14s %13s\n", "owner", "kind", "label", "format", "size", "bytes");
+    for (unsigned int owner = 0; owner < MEMORY_OWNER_COUNT; ++owner)
+        for (unsigned int i = 0; i < recordCount; ++i)
+            if (records[i].Owner == owner)
+                printRecord(out, records[i]);
+    std::fprintf(out, "  %-14s %8s %12s %12s\n", "owner", "records", "gpu KB", "cpu KB");
+    for (unsigned int owner = 0; owner < MEMORY_OWNER_COUNT; ++owner)
+        if (stats.Records[owner] > 0)
+            std::fprintf(out, "  %-14s %8u %12.1f %12.1f\n", OwnerName((MemoryOwner)owner), stats.Records[owner],
+                stats.GPUBytes[owner] / 1024.0, stats.CPUBytes[owner] / 1024.0);
+    std::fprintf(out, "  %-14s %8u %12.1f %12.1f\n", "total", recordCount, stats.TotalGPUBytes() / 1024.0, stats.TotalCPUBytes() / 1024.0);
+    std::fprintf(out, "  %-14s %8s %12.1f %12.1f\n", "peak", "", stats.PeakGPUBytes / 1024.0, stats.PeakCPUBytes / 1024.0);
+    if (dropped > 0)
+        std::fprintf(out, "  %u records did not fit and are missing\n", dropped);
+}
+
+unsigned int MemoryTracker::CheckLeaks(const char *when, MemoryOwner owner) {
+    unsigned int leaks = 0;
+    for (unsigned int i = 0; i < recordCount; ++i)
+        if (owner == MEMORY_OWNER_COUNT || records[i].Owner == owner) {
+            const MemoryRecord &record = records[i];
+            LOG_ERROR("MEMORY", "Still held", {{ "after", when }, { "owner", OwnerName(record.Owner) },
+                { "kind", record.Kind == GLOBJECT_KIND_COUNT ? "cpu" : GLBackend::KindName(record.Kind) },
+                { "label", record.Label[0] ? record.Label : "-" }, { "bytes", record.Bytes }});
+            ++leaks;
+        }
+    return leaks;
+}
+
+const char *MemoryTracker::OwnerName(MemoryOwner owner) {
+    static const char *names[MEMORY_OWNER_COUNT] = {
+        "general", "assets", "render targets", "stream", "text", "particles", "level", "entities", "recorder", "rewind", "state stream", "audio"
+    };
+    return owner < MEMORY_OWNER_COUNT ? names[owner] : "unknown";
+}
+
+const char *MemoryTracker::FormatName(unsigned int format) {
+    switch (format) {
+    case GL_RED:     return "RED";
+    case GL_R8:      return "R8";
+    case GL_RG:      return "RG";
+    case GL_RG8:     return "RG8";
+    case GL_RGB:     return "RGB";
+    case GL_RGB8:    return "RGB8";
+    case GL_RGBA:    return "RGBA";
+    case GL_RGBA8:   return "RGBA8";
+    case GL_RGB16F:  return "RGB16F";
+    case GL_RGBA16F: return "RGBA16F";
+    case GL_RGB32F:  return "RGB32F";
+    case GL_RGBA32F: return "RGBA32F";
+    default:         return "other";
+    }
+}
+
+MemoryOwner MemoryTracker::CurrentOwner() {
+    return currentOwner;
+}
+
+void MemoryTracker::SetCurrentOwner(MemoryOwner owner) {
+    currentOwner = owner;
+}
+
+void MemoryToken::Track(const char *label, unsigned long long bytes) {
+    if (this->id == 0)
+        this->id = nextToken++;
+    MemoryTracker::track(currentOwner, GLOBJECT_KIND_COUNT, this->id, 0, 0, 0, 1, bytes);
+    MemoryTracker::Label(GLOBJECT_KIND_COUNT, this->id, label);
+}
+
+void MemoryToken::Reset() {
+    if (this->id != 0) {
+        MemoryTracker::Release(GLOBJECT_KIND_COUNT, this->id);
+        this->id = 0;
+    }
+}
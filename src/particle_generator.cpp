@@ -1,23 +1,108 @@
 #include "../include/particle_generator.h"
+#include "../include/memory_tracker.h"
 
-ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount)
-    : shader(shader), texture(texture), amount(amount)
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+
+ParticleGenerator::ParticleGenerator(Shader &shader, const Texture2D &texture, unsigned int amount)
+    : GPU(false), amount(amount), shader(shader), texture(texture), victimCursor(0), victimsBuilt(false), submitted(0), live(0), updateShader(nullptr), current(0)
+{
+    this->init();
+    this->trackMemory();
+}
+
+ParticleGenerator::ParticleGenerator(Shader &shader, Shader &updateShader, const Texture2D &texture, unsigned int amount)
+    : GPU(true), amount(amount), shader(shader), texture(texture), victimCursor(0), victimsBuilt(false), submitted(0), live(0), updateShader(&updateShader), current(0)
 {
     this->init();
+    this->initGPU();
+    this->trackMemory();
+}
+
+unsigned int ParticleGenerator::AddEmitter(const EmitterDesc &desc) {
+    if (this->emitters.size() >= MAX_EMITTERS)
+        return NO_EMITTER;
+    EmitterState state;
+    state.Desc = desc;
+    state.Live = 0;
+    state.Pending = 0;
+    this->emitters.push_back(state);
+    return this->emitters.size() - 1;
+}
+
+static float randomRange(float min, float max) {
+    return min + (rand() / static_cast<float>(RAND_MAX)) * (max - min);
+}
+
+void ParticleGenerator::Emit(unsigned int emitter, float dt, glm::vec2 position, glm::vec2 velocity) {
+    if (emitter >= this->emitters.size())
+        return;
+    float exact = this->emitters[emitter].Desc.Rate * dt;
+    unsigned int count = static_cast<unsigned int>(exact);
+    if (randomRange(0.0f, 1.0f) < exact - count)
+        ++count;
+    if (count > 0)
+        this->Burst(emitter, count, position, velocity);
+}
+
+void ParticleGenerator::Burst(unsigned int emitter, unsigned int count, glm::vec2 position, glm::vec2 velocity, glm::vec3 tint) {
+    if (emitter >= this->emitters.size())
+        return;
+    EmitterState &state = this->emitters[emitter];
+    // never queue more than the emitter may own
+    unsigned int used = state.Live + state.Pending;
+    unsigned int left = used < state.Desc.Budget ? state.Desc.Budget - used : 0;
+    count = std::min(count, left);
+    if (count == 0)
+        return;
+
+    SpawnRequest request = { emitter, count, this->submitted++, position, velocity, tint };
+    if (this->requests.size() < MAX_SPAWN_REQUESTS) {
+        this->requests.push_back(request);
+    }
+    else {
+        // queue is full, replace the lowest priority request if this one outranks it
+        unsigned int lowest = 0;
+        for (unsigned int i = 1; i < this->requests.size(); ++i)
+            if (this->emitters[this->requests[i].Emitter].Desc.Priority < this->emitters[this->requests[lowest].Emitter].Desc.Priority)
+                lowest = i;
+        SpawnRequest &replaced = this->requests[lowest];
+        if (this->emitters[replaced.Emitter].Desc.Priority >= state.Desc.Priority)
+            return;
+        this->emitters[replaced.Emitter].Pending -= replaced.Count;
+        replaced = request;
+    }
+    state.Pending += count;
 }
 
-void ParticleGenerator::Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset) {
-    for (unsigned int i = 0; i < newParticles; ++i) {
-        int unusedParticle = this->firstUnusedParticle();
-        this->respawnParticle(this->particles[unusedParticle], object, offset);
+void ParticleGenerator::Update(float dt) {
+    this->spawnRequests();
+
+    if (this->GPU) {
+        this->uploadSpawnBatch();
+        this->integrateGPU(dt);
+    }
+    else {
+        for (unsigned int i = 0; i < this->amount; ++i) {
+            Particle &p = this->particles[i];
+            p.Life -= dt;
+            if (p.Life > 0.0f) {
+                p.Position += p.Velocity * dt;
+                p.Color.a -= dt * p.Fade;
+            }
+        }
     }
 
+    // retire particles that died this frame, same arithmetic as the simulation itself
     for (unsigned int i = 0; i < this->amount; ++i) {
-        Particle &p = this->particles[i];
-        p.Life -= dt;
-        if (p.Life > 0.0f) {
-            p.Position -= p.Velocity * dt;
-            p.Color.a -= dt * 2.5f;
+        if (this->slotOwner[i] == NO_EMITTER)
+            continue;
+        this->slotLife[i] -= dt;
+        if (this->slotLife[i] <= 0.0f) {
+            this->releaseSlot(i);
+            this->freeSlots.push_back(i);
         }
     }
 }
@@ -26,21 +111,40 @@ void ParticleGenerator::Draw() {
     // GL_ONE is additive, for glow effect when particles stack
     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
     this->shader.Use();
-    for (Particle particle : this->particles) {
-        if (particle.Life > 0.0f) {
-            this->shader.SetVector2f("offset", particle.Position);
-            this->shader.SetVector4f("color", particle.Color);
-            this->texture.Bind();
-            glBindVertexArray(this->VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindVertexArray(0);
+    if (this->GPU) {
+        // dead particles are culled in the vertex shader, so the whole pool is one draw
+        this->texture.Bind();
+        glBindVertexArray(this->renderVAO[this->current]);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, this->amount);
+        glBindVertexArray(0);
+    }
+    else {
+        for (Particle particle : this->particles) {
+            if (particle.Life > 0.0f) {
+                this->shader.SetVector2f("offset", particle.Position);
+                this->shader.SetVector4f("color", particle.Color);
+                this->texture.Bind();
+                glBindVertexArray(this->VAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                glBindVertexArray(0);
+            }
         }
     }
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
+void ParticleGenerator::ReadBack(std::vector<Particle> &state) const {
+    state.resize(this->amount);
+    if (!this->GPU) {
+        std::copy(this->particles.begin(), this->particles.end(), state.begin());
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, this->stateVBO[this->current]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, this->amount * sizeof(Particle), state.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void ParticleGenerator::init() {
-    unsigned int VBO;
     float particle_quad[] = {
         0.0f, 1.0f, 0.0f, 1.0f,
         1.0f, 0.0f, 1.0f, 0.0f,
@@ -50,42 +154,210 @@ void ParticleGenerator::init() {
         1.0f, 1.0f, 1.0f, 1.0f,
         1.0f, 0.0f, 1.0f, 0.0f
     };
-    glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &VBO);
+    this->VAO = VertexArrayHandle::Create();
+    this->quadVBO = BufferHandle::Create();
     glBindVertexArray(this->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(particle_quad), particle_quad, GL_STATIC_DRAW);
+    MemoryScope memoryScope(MEMORY_PARTICLES);
+    MemoryTracker::TrackBuffer(this->quadVBO, sizeof(particle_quad));
+    MemoryTracker::Label(GLOBJECT_BUFFER, this->quadVBO, "particle quad");
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
     glBindVertexArray(0);
 
-    for (unsigned int i = 0; i < this->amount; ++i)
-        this->particles.push_back(Particle());
+    // everything is sized up front so emission never allocates
+    this->particles.resize(this->amount);
+    this->slotLife.assign(this->amount, 0.0f);
+    this->slotOwner.assign(this->amount, NO_EMITTER);
+    this->freeSlots.reserve(this->amount);
+    for (unsigned int i = this->amount; i > 0; --i)
+        this->freeSlots.push_back(i - 1);
+    this->victims.reserve(this->amount);
+    this->emitters.reserve(MAX_EMITTERS);
+    this->requests.reserve(MAX_SPAWN_REQUESTS);
 }
 
-unsigned int lastUsedParticle = 0;
-unsigned int ParticleGenerator::firstUnusedParticle() {
-    for (unsigned int i = lastUsedParticle; i < this->amount; ++i) {
-        if (particles[i].Life <= 0.0f) {
-            lastUsedParticle = i;
-            return i;
-        }
+void ParticleGenerator::initGPU() {
+    MemoryScope memoryScope(MEMORY_PARTICLES);
+    for (unsigned int i = 0; i < 2; ++i) {
+        this->stateVBO[i] = BufferHandle::Create();
+        this->updateVAO[i] = VertexArrayHandle::Create();
+        this->renderVAO[i] = VertexArrayHandle::Create();
+        glBindBuffer(GL_ARRAY_BUFFER, this->stateVBO[i]);
+        glBufferData(GL_ARRAY_BUFFER, this->amount * sizeof(Particle), this->particles.data(), GL_DYNAMIC_COPY);
+        MemoryTracker::TrackBuffer(this->stateVBO[i], this->amount * sizeof(Particle));
+        MemoryTracker::Label(GLOBJECT_BUFFER, this->stateVBO[i], "particle state");
+
+        // update: one vertex per particle, outputs captured into the other buffer
+        glBindVertexArray(this->updateVAO[i]);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Velocity));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Color));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Life));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Fade));
+
+        // render: shared quad plus per-instance particle state
+        glBindVertexArray(this->renderVAO[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, this->stateVBO[i]);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Position));
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Color));
+        glVertexAttribDivisor(2, 1);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, Life));
+        glVertexAttribDivisor(3, 1);
     }
-    for (unsigned int i = 0; i < lastUsedParticle; ++i) {
-        if (particles[i].Life <= 0.0f) {
-            lastUsedParticle = i;
-            return i;
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // the CPU copy is only needed as upload source
+    this->particles.clear();
+    this->particles.shrink_to_fit();
+    this->spawnBatch.reserve(this->amount);
+    this->uploadStaging.reserve(this->amount);
+}
+
+void ParticleGenerator::trackMemory() {
+    MemoryScope memoryScope(MEMORY_PARTICLES);
+    size_t bytes = this->particles.capacity() * sizeof(Particle) + this->slotLife.capacity() * sizeof(float)
+        + this->slotOwner.capacity() * sizeof(unsigned short) + (this->freeSlots.capacity() + this->victims.capacity()) * sizeof(unsigned int)
+        + this->emitters.capacity() * sizeof(EmitterState) + this->requests.capacity() * sizeof(SpawnRequest)
+        + this->spawnBatch.capacity() * sizeof(SpawnedParticle) + this->uploadStaging.capacity() * sizeof(Particle);
+    this->memory.Track("particle pool", bytes);
+}
+
+void ParticleGenerator::spawnRequests() {
+    // highest priority first, ties keep submission order; std::stable_sort would allocate
+    std::sort(this->requests.begin(), this->requests.end(), [this](const SpawnRequest &a, const SpawnRequest &b) {
+        unsigned int first = this->emitters[a.Emitter].Desc.Priority, second = this->emitters[b.Emitter].Desc.Priority;
+        return first != second ? first > second : a.Order < b.Order;
+    });
+    this->victimsBuilt = false;
+    for (const SpawnRequest &request : this->requests) {
+        EmitterState &state = this->emitters[request.Emitter];
+        state.Pending -= request.Count;
+        for (unsigned int i = 0; i < request.Count; ++i) {
+            int slot = this->allocateSlot(state.Desc.Priority);
+            if (slot < 0)
+                break;
+            Particle particle;
+            this->respawnParticle(particle, state.Desc, request);
+            this->slotOwner[slot] = request.Emitter;
+            this->slotLife[slot] = particle.Life;
+            ++state.Live;
+            ++this->live;
+            if (this->GPU)
+                this->spawnBatch.push_back({ static_cast<unsigned int>(slot), particle });
+            else
+                this->particles[slot] = particle;
         }
     }
-    lastUsedParticle = 0;
-    return 0;
+    this->requests.clear();
+    this->submitted = 0;
+}
+
+int ParticleGenerator::allocateSlot(unsigned int priority) {
+    if (!this->freeSlots.empty()) {
+        unsigned int slot = this->freeSlots.back();
+        this->freeSlots.pop_back();
+        return slot;
+    }
+    // pool is full, cull the least important particle below the requester's priority
+    if (!this->victimsBuilt)
+        this->buildVictims();
+    while (this->victimCursor < this->victims.size()) {
+        unsigned int slot = this->victims[this->victimCursor];
+        unsigned short owner = this->slotOwner[slot];
+        if (this->emitters[owner].Desc.Priority >= priority)
+            return -1; // sorted, nothing further down qualifies either
+        ++this->victimCursor;
+        this->releaseSlot(slot);
+        return slot;
+    }
+    return -1;
+}
+
+void ParticleGenerator::buildVictims() {
+    // only happens on frames where the global cap is hit: lowest priority first, then closest to dying
+    this->victims.clear();
+    for (unsigned int i = 0; i < this->amount; ++i)
+        if (this->slotOwner[i] != NO_EMITTER)
+            this->victims.push_back(i);
+    std::sort(this->victims.begin(), this->victims.end(), [this](unsigned int a, unsigned int b) {
+        unsigned int pa = this->emitters[this->slotOwner[a]].Desc.Priority;
+        unsigned int pb = this->emitters[this->slotOwner[b]].Desc.Priority;
+        if (pa != pb)
+            return pa < pb;
+        return this->slotLife[a] < this->slotLife[b];
+    });
+    this->victimCursor = 0;
+    this->victimsBuilt = true;
+}
+
+void ParticleGenerator::releaseSlot(unsigned int slot) {
+    --this->emitters[this->slotOwner[slot]].Live;
+    --this->live;
+    this->slotOwner[slot] = NO_EMITTER;
+    this->slotLife[slot] = 0.0f;
+}
+
+void ParticleGenerator::uploadSpawnBatch() {
+    if (this->spawnBatch.empty())
+        return;
+    // coalesce neighbouring slots so each contiguous run is a single upload
+    std::sort(this->spawnBatch.begin(), this->spawnBatch.end(), [](const SpawnedParticle &a, const SpawnedParticle &b) {
+        return a.Slot < b.Slot;
+    });
+    glBindBuffer(GL_ARRAY_BUFFER, this->stateVBO[this->current]);
+    unsigned int i = 0;
+    while (i < this->spawnBatch.size()) {
+        unsigned int first = this->spawnBatch[i].Slot;
+        this->uploadStaging.clear();
+        while (i < this->spawnBatch.size() && this->spawnBatch[i].Slot == first + this->uploadStaging.size())
+            this->uploadStaging.push_back(this->spawnBatch[i++].Data);
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(Particle), this->uploadStaging.size() * sizeof(Particle), this->uploadStaging.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    this->spawnBatch.clear();
+}
+
+void ParticleGenerator::integrateGPU(float dt) {
+    // current -> next, nothing is rasterized
+    unsigned int next = 1 - this->current;
+    this->updateShader->Use();
+    this->updateShader->SetFloat("dt", dt);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(this->updateVAO[this->current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, this->stateVBO[next]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, this->amount);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    this->current = next;
 }
 
-void ParticleGenerator::respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset) {
-    float random = ((rand() % 100) - 50) / 10.0f;
-    float rColor = 0.5f + ((rand() % 100) / 100.0f);
-    particle.Position = object.Position + random + offset;
-    particle.Color = glm::vec4(rColor, rColor, rColor, 1.0f);
-    particle.Life = 1.0f;
-    particle.Velocity = object.Velocity * 0.1f;
+void ParticleGenerator::respawnParticle(Particle &particle, const EmitterDesc &desc, const SpawnRequest &request) {
+    float angle = std::atan2(desc.Direction.y, desc.Direction.x) + glm::radians(randomRange(-desc.Spread, desc.Spread));
+    float speed = randomRange(desc.SpeedMin, desc.SpeedMax);
+    float brightness = randomRange(desc.BrightMin, desc.BrightMax);
+    glm::vec2 jitter(randomRange(-desc.Jitter, desc.Jitter), randomRange(-desc.Jitter, desc.Jitter));
+    glm::vec3 color = desc.Color * request.Tint * brightness;
+    particle.Position = request.Position + jitter;
+    particle.Velocity = glm::vec2(std::cos(angle), std::sin(angle)) * speed + request.Velocity * desc.Inherit;
+    particle.Color = glm::vec4(color, 1.0f);
+    particle.Life = randomRange(desc.LifeMin, desc.LifeMax);
+    particle.Fade = desc.Fade;
 }
@@ -0,0 +1,114 @@
+#include "../include/perf_hud.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+// layout in framebuffer pixels
+const float HUD_SCALE       = 2.0f;  // per font pixel
+const float HUD_MARGIN      = 10.0f;
+const float HUD_PADDING     = 6.0f;
+const float HUD_LINE        = (FONT_GLYPH_HEIGHT + 2) * HUD_SCALE;
+const unsigned int HUD_CHARS = 22;   // wide enough for the longest line
+const float GRAPH_BAR       = 2.0f;  // per frame
+const float GRAPH_HEIGHT    = 60.0f;
+const float GRAPH_RANGE     = 50.0f; // milliseconds at the top of the graph
+const float FRAME_60HZ      = 1000.0f / 60.0f;
+const float FRAME_30HZ      = 1000.0f / 30.0f;
+
+static const char *SECTION_NAMES[PERF_SECTION_COUNT] = { "update", "  collision", "  particles", "render", "hud" };
+
+// seconds per section of the current frame, only touched by the main thread
+static double sectionTime[PERF_SECTION_COUNT];
+
+PerfScope::~PerfScope() {
+    sectionTime[this->section] += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+}
+
+PerfHud::PerfHud(Shader &shader, StreamBuffer &stream)
+    : shader(shader), text(shader, stream), history(), newest(0), sum(), summed(0), lines(), lineCount(0), width(0), height(0), started(false) { }
+
+void PerfHud::EndFrame(PerfSample &sample) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (!this->started) {
+        this->started = true;
+        this->refreshed = now;
+        sample.FrameTime = 0.0f;
+    }
+    else
+        sample.FrameTime = std::chrono::duration<float, std::milli>(now - this->lastFrame).count();
+    this->lastFrame = now;
+    for (unsigned int section = 0; section < PERF_SECTION_COUNT; ++section) {
+        sample.Sections[section] = (float)(sectionTime[section] * 1000.0);
+        sectionTime[section] = 0.0;
+    }
+    this->newest = (this->newest + 1) % PERF_HISTORY;
+    this->history[this->newest] = sample;
+
+    this->sum.FrameTime += sample.FrameTime;
+    this->sum.GPUTime += sample.GPUTime;
+    for (unsigned int section = 0; section < PERF_SECTION_COUNT; ++section)
+        this->sum.Sections[section] += sample.Sections[section];
+    this->sum.DrawCalls += sample.DrawCalls;
+    this->sum.Binds += sample.Binds;
+    this->sum.Uniforms += sample.Uniforms;
+    this->sum.Allocations += sample.Allocations;
+    ++this->summed;
+    if (std::chrono::duration<double>(now - this->refreshed).count() >= PERF_REFRESH) {
+        this->refresh();
+        this->refreshed = now;
+    }
+}
+
+void PerfHud::refresh() {
+    // averages since the last refresh, the counts of live things are the newest
+    const PerfSample &latest = this->history[this->newest];
+    float frames = (float)this->summed;
+    float frameTime = this->sum.FrameTime / frames;
+    unsigned int line = 0;
+    std::snprintf(this->lines[line++], PERF_LINE_LENGTH, "fps %6.1f %7.2f ms", frameTime > 0.0f ? 1000.0f / frameTime : 0.0f, frameTime);
+    std::snprintf(this->lines[line++], PERF_LINE_LENGTH, "%-11s%7.2f ms", "gpu", this->sum.GPUTime / frames);
+    for (unsigned int section = 0; section < PERF_SECTION_COUNT; ++section)
+        std::snprintf(this->lines[line++], PERF_LINE_LENGTH, "%-11s%7.3f ms", SECTION_NAMES[section], this->sum.Sections[section] / frames);
+    std::snprintf(this->lines[line++], PERF_LINE_LENGTH, "%-11s%7.1f", "draws", this->sum.DrawCalls / frames);
+    std::snprintf(this->lines[line++], PERF_LINE_LENGTH, "%-11s%7.1f", "binds", this->sum.Binds / frames);
+    std::snprintf(this->lines[line++], PERF_LINE_LENGTH, "%-11s%7.1f", "uniforms", this->sum.Uniforms / frames);
+    std::snprintf(this->lines[line++], PERF_LINE_LENGTH, "%-11s%7.1f", "allocs", this->sum.Allocations / frames);
+    std::snprintf(this->lines[line++], PERF_LINE_LENGTH, "%-11s%5u", "particles", latest.Particles);
+    std::snprintf(this->lines[line++], PERF_LINE_LENGTH, "%-11s%5u", "bricks", latest.Bricks);
+    std::snprintf(this->lines[line++], PERF_LINE_LENGTH, "%-11s%7.1f MB", "gpu memory", latest.GPUMemory / (1024.0 * 1024.0));
+    std::snprintf(this->lines[line++], PERF_LINE_LENGTH, "%-11s%7.1f MB", "cpu memory", latest.CPUMemory / (1024.0 * 1024.0));
+    this->lineCount = line;
+    this->sum = PerfSample();
+    this->summed = 0;
+}
+
+void PerfHud::Draw(unsigned int width, unsigned int height) {
+    if (width != this->width || height != this->height) {
+        this->width = width;
+        this->height = height;
+        this->shader.Use().SetMatrix4("projection", glm::ortho(0.0f, (float)width, (float)height, 0.0f, -1.0f, 1.0f));
+    }
+    glViewport(0, 0, width, height);
+
+    glm::vec2 origin(HUD_MARGIN + HUD_PADDING);
+    float graphTop = origin.y + this->lineCount * HUD_LINE + HUD_PADDING;
+    glm::vec2 panel(std::max(HUD_CHARS * FONT_ADVANCE * HUD_SCALE, PERF_HISTORY * GRAPH_BAR), graphTop - origin.y + GRAPH_HEIGHT);
+    this->text.DrawRect(origin - HUD_PADDING, panel + 2.0f * HUD_PADDING, glm::vec3(0.0f), 0.6f);
+    for (unsigned int line = 0; line < this->lineCount; ++line)
+        this->text.DrawText(this->lines[line], origin + glm::vec2(0.0f, line * HUD_LINE), HUD_SCALE);
+
+    // frame times, oldest on the left, colored by the refresh rate they would hold
+    float graphBottom = graphTop + GRAPH_HEIGHT;
+    for (unsigned int i = 0; i < PERF_HISTORY; ++i) {
+        float frameTime = this->history[(this->newest + 1 + i) % PERF_HISTORY].FrameTime;
+        float bar = std::min(frameTime / GRAPH_RANGE, 1.0f) * GRAPH_HEIGHT;
+        glm::vec3 color = frameTime <= FRAME_60HZ ? glm::vec3(0.3f, 0.9f, 0.3f) : frameTime <= FRAME_30HZ ? glm::vec3(0.9f, 0.8f, 0.2f) : glm::vec3(0.9f, 0.2f, 0.2f);
+        this->text.DrawRect(glm::vec2(origin.x + i * GRAPH_BAR, graphBottom - bar), glm::vec2(GRAPH_BAR, bar), color, 0.9f);
+    }
+    float graphWidth = PERF_HISTORY * GRAPH_BAR;
+    this->text.DrawRect(glm::vec2(origin.x, graphBottom - FRAME_60HZ / GRAPH_RANGE * GRAPH_HEIGHT), glm::vec2(graphWidth, 1.0f), glm::vec3(1.0f), 0.5f);
+    this->text.DrawRect(glm::vec2(origin.x, graphBottom - FRAME_30HZ / GRAPH_RANGE * GRAPH_HEIGHT), glm::vec2(graphWidth, 1.0f), glm::vec3(1.0f), 0.5f);
+    this->text.Flush();
+}
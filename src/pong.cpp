@@ -3,18 +3,154 @@
 
 #include "../include/game.h"
 #include "../include/resource_manager.h"
+#include "../include/alloc_tracker.h"
+#include "../include/asset_pack.h"
+#include "../include/gl_backend.h"
+#include "../include/flight_recorder.h"
+#include "../include/memory_tracker.h"
+#include "../include/log.h"
 
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX // std::min and std::max are used below
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach-o/dyld.h>
+#else
+#include <unistd.h>
+#endif
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
+void runBenchmark(GLFWwindow* window);
+int  runNullGL(unsigned int frames);
+int  runReplay(const char *file);
+std::string executableDirectory(const char *path);
 
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
+// frames after which gameplay is expected to stop touching the heap
+const unsigned int STEADY_STATE_FRAME = 3;
+// frames rendered per anti-aliasing mode by --benchmark, after the warm-up ones
+const unsigned int BENCHMARK_WARMUP = 30;
+const unsigned int BENCHMARK_FRAMES = 300;
+const float        BENCHMARK_STEP = 1.0f / 60.0f;
+// looked for next to the executable, loose files are used without it
+const char *ASSET_PACK_FILE = "assets.pak";
+// frames either side of the hitch whose timings --replay prints
+const unsigned int REPLAY_CONTEXT = 5;
+// what a frame may cost under --null-gl before it fails, a whole level is one draw
+const unsigned int       NULL_GL_MAX_DRAWS = 10;
+const unsigned int       NULL_GL_MAX_BINDS = 64;
+const unsigned long long NULL_GL_MAX_BYTES = 64 << 10;
 
 Game Platphong(SCR_WIDTH, SCR_HEIGHT);
+// print the memory report before shutting down
+bool ReportMemory = false;
+// per-frame limits --null-gl checks, 0 for none
+GLStats NullGLBudget = { NULL_GL_MAX_DRAWS, 0, NULL_GL_MAX_BINDS, 0, 0, NULL_GL_MAX_BYTES };
 
 int main(int argc, char *argv[]) {
+    bool benchmark = false;
+    // assets are found relative to the executable, not the working directory
+    std::string directory = executableDirectory(argv[0]);
+    std::string pack = directory + ASSET_PACK_FILE;
+    bool loose = false;
+    unsigned int nullFrames = 0;
+    const char *replay = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        // --balls N serves N extra balls every time, for stress testing
+        if (std::strcmp(argv[i], "--balls") == 0 && i + 1 < argc) {
+            int balls = std::atoi(argv[++i]);
+            Platphong.StressBalls = balls > 0 ? std::min((unsigned int)balls, MAX_BALLS - 1) : 0;
+        }
+        else if (std::strcmp(argv[i], "--late-latch") == 0)
+            Platphong.LateLatch = true;
+        else if (std::strcmp(argv[i], "--latency") == 0)
+            Platphong.MeasureLatency = true;
+        // --hud starts with the performance overlay shown, F3 toggles it
+        else if (std::strcmp(argv[i], "--hud") == 0)
+            Platphong.ShowPerfHud = true;
+        // --gpu-budget MS sets the GPU time dynamic resolution aims for, 0 turns it off
+        else if (std::strcmp(argv[i], "--gpu-budget") == 0 && i + 1 < argc)
+            Platphong.GPUBudget = std::max((float)std::atof(argv[++i]), 0.0f);
+        // --aa off|fxaa|msaa2|msaa4|msaa8 picks the scene anti-aliasing
+        else if (std::strcmp(argv[i], "--aa") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            unsigned int mode = 0;
+            while (mode < AA_MODE_COUNT && std::strcmp(name, ANTI_ALIASING_NAMES[mode]) != 0)
+                ++mode;
+            if (mode < AA_MODE_COUNT)
+                Platphong.AAMode = (AntiAliasing)mode;
+            else
+                LOG_WARNING("OPTIONS", "Unknown anti-aliasing mode", {{ "mode", name }, { "keeping", ANTI_ALIASING_NAMES[Platphong.AAMode] }});
+        }
+        // --benchmark renders every anti-aliasing mode offscreen and prints the cost of each
+        else if (std::strcmp(argv[i], "--benchmark") == 0)
+            benchmark = true;
+        // --pack FILE loads assets from another pack, --loose always from the loose files
+        else if (std::strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+            pack = argv[++i];
+        else if (std::strcmp(argv[i], "--loose") == 0)
+            loose = true;
+        // --null-gl FRAMES plays without a window or GPU on the recording backend, reports the GL work per frame and fails on frames over budget
+        else if (std::strcmp(argv[i], "--null-gl") == 0 && i + 1 < argc)
+            nullFrames = std::max(std::atoi(argv[++i]), 1);
+        // --max-draws N, --max-binds N and --max-bytes N set what a --null-gl frame may cost, 0 for no limit
+        else if (std::strcmp(argv[i], "--max-draws") == 0 && i + 1 < argc)
+            NullGLBudget.DrawCalls = std::max(std::atoi(argv[++i]), 0);
+        else if (std::strcmp(argv[i], "--max-binds") == 0 && i + 1 < argc)
+            NullGLBudget.Binds = std::max(std::atoi(argv[++i]), 0);
+        else if (std::strcmp(argv[i], "--max-bytes") == 0 && i + 1 < argc)
+            NullGLBudget.BytesUploaded = std::max(std::atoll(argv[++i]), 0ll);
+        // --hitch-budget MS dumps the frames around any frame slower than MS into --hitch-dir DIR, 0 turns it off
+        else if (std::strcmp(argv[i], "--hitch-budget") == 0 && i + 1 < argc)
+            Platphong.HitchBudget = std::max((float)std::atof(argv[++i]), 0.0f);
+        else if (std::strcmp(argv[i], "--hitch-dir") == 0 && i + 1 < argc)
+            Platphong.HitchDirectory = argv[++i];
+        // --replay FILE plays a hitch dump back without a window and checks it plays out the same
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replay = argv[++i];
+        // --memory prints what is held in memory, by owner, before shutting down; F4 prints it any time
+        else if (std::strcmp(argv[i], "--memory") == 0)
+            ReportMemory = true;
+        // --rewind SECONDS keeps that much play to rewind through with Backspace, 0 turns it off
+        else if (std::strcmp(argv[i], "--rewind") == 0 && i + 1 < argc)
+            Platphong.RewindSeconds = std::max((float)std::atof(argv[++i]), 0.0f);
+        // --stream-shm NAME and --stream-socket PATH publish the state after every update, see tools/stream_viewer.cpp
+        else if (std::strcmp(argv[i], "--stream-shm") == 0 && i + 1 < argc)
+            Platphong.StreamName = argv[++i];
+        else if (std::strcmp(argv[i], "--stream-socket") == 0 && i + 1 < argc)
+            Platphong.StreamSocket = argv[++i];
+        // --audio null|FILE mixes sound into nothing or into a WAV file, there is no sound device output
+        else if (std::strcmp(argv[i], "--audio") == 0 && i + 1 < argc)
+            Platphong.AudioOutput = argv[++i];
+    }
+    AssetPack::SetRoot(directory + "../");
+    if (!loose && AssetPack::Open(pack.c_str())) {
+#ifndef NDEBUG
+        if (!AssetPack::Verify())
+            LOG_WARNING("ASSET_PACK", "Pack does not match its index, rebuild it with pack_assets", {{ "file", pack }});
+#endif
+    }
+    if (replay) {
+        int result = runReplay(replay);
+        AssetPack::Close();
+        return result;
+    }
+    if (nullFrames > 0) {
+        int result = runNullGL(nullFrames);
+        AssetPack::Close();
+        return result;
+    }
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -22,13 +158,18 @@ int main(int argc, char *argv[]) {
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
-    glfwWindowHint(GLFW_RESIZABLE, false);
+    glfwWindowHint(GLFW_RESIZABLE, true);
+    if (benchmark) {
+        glfwWindowHint(GLFW_VISIBLE, false);
+        // the benchmark runs over budget on purpose
+        Platphong.HitchBudget = 0.0f;
+    }
 
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Platphong", nullptr, nullptr); 
     glfwMakeContextCurrent(window);
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
+    if (!GLBackend::UseGLAD((GLADloadproc)glfwGetProcAddress)) {
+        LOG_ERROR("GLAD", "Failed to initialize");
         return -1;
     }
 
@@ -40,17 +181,35 @@ int main(int argc, char *argv[]) {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     Platphong.Init();
+    // the framebuffer can differ from the window size on high-DPI screens
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    Platphong.Resize(framebufferWidth, framebufferHeight);
+
+    if (benchmark) {
+        runBenchmark(window);
+        if (ReportMemory)
+            MemoryTracker::Report(stdout);
+        Platphong.Clear();
+        ResourceManager::Clear();
+        MemoryTracker::CheckLeaks("shutdown", MEMORY_OWNER_COUNT);
+        AssetPack::Close();
+        glfwTerminate();
+        return 0;
+    }
 
     float deltaTime = 0.0f;
-    float lastFrame = 0.0f;
+    double lastFrame = glfwGetTime();
+    unsigned int frameCount = 0;
 
     while (!glfwWindowShouldClose(window)) {
-        float currentFrame = glfwGetTime();
+        double currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
         glfwPollEvents();
 
-        Platphong.ProcessInput(deltaTime);
+        // input events are stamped on arrival, so integrate up to now rather than the frame start
+        Platphong.ProcessInput(glfwGetTime());
 
         Platphong.Update(deltaTime);
 
@@ -59,28 +218,223 @@ int main(int argc, char *argv[]) {
         Platphong.Render();
 
         glfwSwapBuffers(window);
+        Platphong.Present();
+
+        AllocTracker::EndFrame();
+        GLBackend::EndFrame();
+        Platphong.EndFrame();
+        if (++frameCount == STEADY_STATE_FRAME)
+            AllocTracker::SetSteadyState(true);
     }
 
+    if (ReportMemory)
+        MemoryTracker::Report(stdout);
+    Platphong.Clear();
     ResourceManager::Clear();
+    MemoryTracker::CheckLeaks("shutdown", MEMORY_OWNER_COUNT);
+    AssetPack::Close();
 
     glfwTerminate();
     return 0;
 }
 
+int runNullGL(unsigned int frames)
+{
+    GLBackend::UseRecording();
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    Platphong.HitchBudget = 0.0f;
+    Platphong.Init();
+    Platphong.Resize(SCR_WIDTH, SCR_HEIGHT);
+    // the first frame creates the render targets, it is not representative
+    GLStats peak = GLStats(), total = GLStats();
+    unsigned int overBudget = 0;
+    for (unsigned int frame = 0; frame <= frames; ++frame) {
+        Platphong.Update(BENCHMARK_STEP);
+        glClear(GL_COLOR_BUFFER_BIT);
+        Platphong.Render();
+        GLBackend::EndFrame();
+        Platphong.EndFrame();
+        if (frame == 0)
+            continue;
+        const GLStats &stats = GLBackend::LastFrame();
+        if ((NullGLBudget.DrawCalls > 0 && stats.DrawCalls > NullGLBudget.DrawCalls) || (NullGLBudget.Binds > 0 && stats.Binds > NullGLBudget.Binds)
+            || (NullGLBudget.BytesUploaded > 0 && stats.BytesUploaded > NullGLBudget.BytesUploaded)) {
+            // the first few are enough to go on
+            if (overBudget++ < 3)
+                LOG_ERROR("NULL_GL", "Frame over budget", {{ "frame", frame }, { "draws", stats.DrawCalls }, { "binds", stats.Binds },
+                    { "bytes", stats.BytesUploaded }});
+        }
+        peak.DrawCalls = std::max(peak.DrawCalls, stats.DrawCalls);
+        peak.Binds = std::max(peak.Binds, stats.Binds);
+        peak.RedundantBinds = std::max(peak.RedundantBinds, stats.RedundantBinds);
+        peak.UniformUploads = std::max(peak.UniformUploads, stats.UniformUploads);
+        peak.BytesUploaded = std::max(peak.BytesUploaded, stats.BytesUploaded);
+        total.DrawCalls += stats.DrawCalls;
+        total.Binds += stats.Binds;
+        total.RedundantBinds += stats.RedundantBinds;
+        total.UniformUploads += stats.UniformUploads;
+        total.BytesUploaded += stats.BytesUploaded;
+    }
+    // the tables go straight to stdout, after whatever was logged
+    Log::Flush();
+    std::printf("per frame        mean      max    limit\n");
+    std::printf("draws       %9.1f %8u %8u\n", (double)total.DrawCalls / frames, peak.DrawCalls, NullGLBudget.DrawCalls);
+    std::printf("binds       %9.1f %8u %8u\n", (double)total.Binds / frames, peak.Binds, NullGLBudget.Binds);
+    std::printf("  redundant %9.1f %8u\n", (double)total.RedundantBinds / frames, peak.RedundantBinds);
+    std::printf("uniforms    %9.1f %8u\n", (double)total.UniformUploads / frames, peak.UniformUploads);
+    std::printf("bytes       %9.1f %8llu %8llu\n", (double)total.BytesUploaded / frames, peak.BytesUploaded, NullGLBudget.BytesUploaded);
+    if (overBudget > 0)
+        std::printf("%u of %u frames over budget\n", overBudget, frames);
+    if (ReportMemory)
+        MemoryTracker::Report(stdout);
+
+    Platphong.Clear();
+    ResourceManager::Clear();
+    // everything created must be gone again
+    unsigned int leaks = MemoryTracker::CheckLeaks("shutdown", MEMORY_OWNER_COUNT);
+    Log::Flush();
+    for (unsigned int kind = 0; kind < GLOBJECT_KIND_COUNT; ++kind)
+        if (GLBackend::LiveObjects((GLObjectKind)kind) > 0) {
+            std::printf("leaked %u %s objects\n", GLBackend::LiveObjects((GLObjectKind)kind), GLBackend::KindName((GLObjectKind)kind));
+            leaks += GLBackend::LiveObjects((GLObjectKind)kind);
+        }
+    if (GLBackend::Errors() > 0)
+        std::printf("%u GL usage errors\n", GLBackend::Errors());
+    return leaks > 0 || GLBackend::Errors() > 0 || overBudget > 0 ? 1 : 0;
+}
+
+int runReplay(const char *file)
+{
+    FlightDump dump;
+    if (!FlightRecorder::Load(file, dump)) {
+        LOG_ERROR("FLIGHT", "Failed to read", {{ "file", file }});
+        return 1;
+    }
+    GLBackend::UseRecording();
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // the dump decides when input is taken, the game must not latch on its own
+    Platphong.HitchBudget = 0.0f;
+    Platphong.LateLatch = false;
+    Platphong.Init();
+    Platphong.Resize(SCR_WIDTH, SCR_HEIGHT);
+    Platphong.Restore(dump.Start);
+
+    unsigned int diverged = 0, firstDiverged = 0;
+    std::vector<float> updateTimes(dump.Frames.size());
+    for (unsigned int i = 0; i < dump.Frames.size(); ++i) {
+        const FrameRecord &record = dump.Frames[i];
+        for (unsigned int e = record.FirstEvent; e < record.FirstEvent + record.EventCount; ++e)
+            Platphong.Input.Push(dump.Events[e].Key, dump.Events[e].Pressed, dump.Events[e].Time);
+        if (record.InputTime >= 0.0)
+            Platphong.ProcessInput(record.InputTime);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Platphong.Update(record.Step);
+        updateTimes[i] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (record.LatchTime >= 0.0)
+            Platphong.LatchInput(record.LatchTime);
+        glClear(GL_COLOR_BUFFER_BIT);
+        Platphong.Render();
+        GLBackend::EndFrame();
+        if (Platphong.StateHash() != record.StateHash && diverged++ == 0)
+            firstDiverged = record.Frame;
+    }
+
+    Log::Flush();
+    std::printf("hitch at frame %u, budget %.1f ms, %u frames from frame %u\n", dump.HitchFrame, dump.Budget,
+        (unsigned int)dump.Frames.size(), dump.Frames[0].Frame);
+    std::printf("frame     frame ms   update   render      gpu   draws   replayed update\n");
+    unsigned int hitch = dump.HitchFrame - dump.Frames[0].Frame;
+    unsigned int first = hitch > REPLAY_CONTEXT ? hitch - REPLAY_CONTEXT : 0;
+    unsigned int last = std::min(hitch + REPLAY_CONTEXT, (unsigned int)dump.Frames.size() - 1);
+    for (unsigned int i = first; i <= last; ++i) {
+        const FrameRecord &record = dump.Frames[i];
+        std::printf("%-6u%s %8.2f %8.3f %8.3f %8.2f %7u %17.3f\n", record.Frame, i == hitch ? "*" : " ", record.Perf.FrameTime,
+            record.Perf.Sections[PERF_UPDATE], record.Perf.Sections[PERF_RENDER], record.Perf.GPUTime, record.Perf.DrawCalls, updateTimes[i]);
+    }
+    if (diverged > 0)
+        std::printf("replay diverged from frame %u on, %u of %u frames differ\n", firstDiverged, diverged, (unsigned int)dump.Frames.size());
+    else
+        std::printf("replay matches all %u frames\n", (unsigned int)dump.Frames.size());
+
+    Platphong.Clear();
+    ResourceManager::Clear();
+    MemoryTracker::CheckLeaks("shutdown", MEMORY_OWNER_COUNT);
+    return diverged > 0 ? 1 : 0;
+}
+
+std::string executableDirectory(const char *path)
+{
+    // argv[0] has no directory when the game was started from PATH, ask the system first
+    std::string directory;
+    char buffer[4096];
+#ifdef _WIN32
+    DWORD length = GetModuleFileNameA(nullptr, buffer, sizeof(buffer));
+    if (length > 0 && length < sizeof(buffer))
+        directory.assign(buffer, length);
+#elif defined(__APPLE__)
+    uint32_t length = sizeof(buffer);
+    if (_NSGetExecutablePath(buffer, &length) == 0)
+        directory = buffer;
+#else
+    ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer));
+    if (length > 0 && length < (ssize_t)sizeof(buffer))
+        directory.assign(buffer, length);
+#endif
+    if (directory.empty())
+        directory = path;
+    size_t separator = directory.find_last_of("/\\");
+    return separator == std::string::npos ? std::string() : directory.substr(0, separator + 1);
+}
+
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode)
 {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
-    if (key >= 0 && key < 1024)
-    {
-        if (action == GLFW_PRESS)
-            Platphong.Keys[key] = true;
-        else if (action == GLFW_RELEASE)
-            Platphong.Keys[key] = false;
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS)
+        Platphong.ShowPerfHud = !Platphong.ShowPerfHud;
+    if (key == GLFW_KEY_F4 && action == GLFW_PRESS) {
+        Log::Flush();
+        MemoryTracker::Report(stdout);
     }
+    if (key >= 0 && key < 1024 && action != GLFW_REPEAT)
+        Platphong.Input.Push(key, action == GLFW_PRESS, glfwGetTime());
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    // may run in the middle of a frame with late latching, the resize waits for the next one
+    Platphong.Resize(width, height);
+}
+
+void runBenchmark(GLFWwindow* window)
+{
+    // no vsync and a fixed resolution, so only the anti-aliasing differs between runs
+    glfwSwapInterval(0);
+    Platphong.SetGPUBudget(0.0f);
+    Log::Flush();
+    std::printf("mode    frame ms   gpu ms   targets KB   stream stalls\n");
+    for (unsigned int mode = 0; mode < AA_MODE_COUNT; ++mode) {
+        // also drops the targets of the last mode and returns to full resolution
+        Platphong.SetAntiAliasing((AntiAliasing)mode);
+        Platphong.ResetLevel();
+        Platphong.ResetPlayer();
+        unsigned int stalls = Platphong.StreamBufferStats().Stalls;
+        double start = 0.0;
+        for (unsigned int frame = 0; frame < BENCHMARK_WARMUP + BENCHMARK_FRAMES; ++frame) {
+            if (frame == BENCHMARK_WARMUP)
+                start = glfwGetTime();
+            Platphong.Update(BENCHMARK_STEP);
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            Platphong.Render();
+            glfwSwapBuffers(window);
+            // keep the driver from queueing frames, the wall time then includes the GPU
+            glFinish();
+        }
+        double frameTime = (glfwGetTime() - start) * 1000.0 / BENCHMARK_FRAMES;
+        std::printf("%-7s %8.3f %8.3f %12zu %15u\n", ANTI_ALIASING_NAMES[mode], frameTime, Platphong.GPUTime(), Platphong.TargetBytes() / 1024,
+            Platphong.StreamBufferStats().Stalls - stalls);
+    }
 }
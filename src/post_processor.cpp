@@ -1,26 +1,25 @@
 #include "../include/post_processor.h"
+#include "../include/memory_tracker.h"
+#include "../include/log.h"
 
-#include <iostream>
+#include <algorithm>
+#include <cmath>
 
-PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int height) 
-    : PostProcessingShader(shader), Texture(), Width(width), Height(height), Confuse(false), Chaos(false), Shake(false)
-{
-    glGenFramebuffers(1, &this->MSFBO);
-    glGenFramebuffers(1, &this->FBO);
-    glGenRenderbuffers(1, &this->RBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, this->RBO); 
-    glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_RGB, width, height);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->RBO);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "ERROR::POSTPROCESSOR: Failed to initialize MSFSBO" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
-    this->Texture.Generate(width, height, NULL);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->Texture.ID, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "ERROR:POSTPROCESSOR: Failed to initialize FBO";
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+const char *ANTI_ALIASING_NAMES[AA_MODE_COUNT] = { "off", "fxaa", "msaa2", "msaa4", "msaa8" };
 
+PostProcessor::PostProcessor(Shader &shader, Shader &fxaaShader, unsigned int width, unsigned int height, AntiAliasing antiAliasing) 
+    : PostProcessingShader(shader), Width(width), Height(height), Confuse(false), Chaos(false), Shake(false),
+      DynamicResolution(false), GPUBudget(12.0f), GPUTime(0.0f), FXAAShader(fxaaShader), step(0), cooldown(0),
+      antiAliasing(AA_OFF), samples(0), maxSamples(0), frame(0), resample(true), aspect((float)width / height), pendingWidth(0), pendingHeight(0)
+{
+    for (unsigned int i = 0; i < GPU_TIMER_QUERIES; ++i)
+        this->timers[i] = QueryHandle::Create();
+    int maxSamples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    this->maxSamples = maxSamples;
+    this->resize(width, height);
+    this->SetAntiAliasing(antiAliasing);
+    this->FXAAShader.SetInteger("scene", 0, true);
     this->initRenderData();
     this->PostProcessingShader.SetInteger("scene", 0, true);
     float offset = 1.0 / 300.0f;
@@ -50,36 +49,213 @@ PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int hei
     glUniform1fv(glGetUniformLocation(this->PostProcessingShader.ID, "blur_kernel"), 9, blur_kernel);
 }
 
+void PostProcessor::Resize(unsigned int width, unsigned int height) {
+    if (width == 0 || height == 0)
+        return; // minimized
+    this->pendingWidth = width;
+    this->pendingHeight = height;
+}
+
+void PostProcessor::resize(unsigned int width, unsigned int height) {
+    this->pendingWidth = this->pendingHeight = 0;
+    this->Width = width;
+    this->Height = height;
+    // largest rectangle of the world's aspect ratio, centred
+    this->viewportWidth = std::min(width, (unsigned int)std::lround(height * this->aspect));
+    this->viewportHeight = std::min(height, (unsigned int)std::lround(width / this->aspect));
+    this->viewportX = (width - this->viewportWidth) / 2;
+    this->viewportY = (height - this->viewportHeight) / 2;
+    this->releaseTargets();
+}
+
+void PostProcessor::SetAntiAliasing(AntiAliasing antiAliasing) {
+    unsigned int samples = 0;
+    if (antiAliasing == AA_MSAA_2)
+        samples = 2;
+    else if (antiAliasing == AA_MSAA_4)
+        samples = 4;
+    else if (antiAliasing == AA_MSAA_8)
+        samples = 8;
+    samples = std::min(samples, this->maxSamples);
+    if (antiAliasing >= AA_MSAA_2 && samples < 2) {
+        LOG_WARNING("POSTPROCESSOR", "MSAA not supported, anti-aliasing is off");
+        antiAliasing = AA_OFF;
+        samples = 0;
+    }
+    this->antiAliasing = antiAliasing;
+    this->samples = samples;
+    // the new mode starts at full resolution, its cost is not known yet
+    this->step = 0;
+    this->cooldown = 0;
+    this->resample = true;
+    this->releaseTargets();
+}
+
+void PostProcessor::releaseTargets() {
+    for (RenderTarget &target : this->targets) {
+        target.MSFBO.Reset();
+        target.FBO.Reset();
+        target.RBO.Reset();
+        target.Texture.ID.Reset();
+        target.FXAAFBO.Reset();
+        target.FXAATexture.ID.Reset();
+        target.Width = target.Height = 0;
+    }
+}
+
+size_t PostProcessor::TargetBytes() const {
+    size_t bytes = 0;
+    for (const RenderTarget &target : this->targets) {
+        size_t pixels = (size_t)target.Width * target.Height;
+        if (target.MSFBO != 0)
+            bytes += pixels * 4 * this->samples;
+        if (target.FBO != 0)
+            bytes += pixels * 4;
+        if (target.FXAAFBO != 0)
+            bytes += pixels * 4;
+    }
+    return bytes;
+}
+
+PostProcessor::RenderTarget &PostProcessor::target() {
+    RenderTarget &target = this->targets[this->step];
+    if (target.FBO != 0)
+        return target;
+    // first use of this step at the current size
+    MemoryScope memoryScope(MEMORY_RENDER_TARGETS);
+    target.Width = std::max(1u, (unsigned int)std::lround(this->viewportWidth * RESOLUTION_SCALES[this->step]));
+    target.Height = std::max(1u, (unsigned int)std::lround(this->viewportHeight * RESOLUTION_SCALES[this->step]));
+    if (this->samples > 0) {
+        target.MSFBO = FramebufferHandle::Create();
+        target.RBO = RenderbufferHandle::Create();
+        glBindFramebuffer(GL_FRAMEBUFFER, target.MSFBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, target.RBO); 
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, this->samples, GL_RGB, target.Width, target.Height);
+        MemoryTracker::TrackRenderbuffer(target.RBO, GL_RGB, target.Width, target.Height, this->samples);
+        MemoryTracker::Label(GLOBJECT_RENDERBUFFER, target.RBO, "msaa scene");
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.RBO);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            LOG_ERROR("POSTPROCESSOR", "Failed to initialize MSFSBO");
+    }
+    target.FBO = FramebufferHandle::Create();
+    glBindFramebuffer(GL_FRAMEBUFFER, target.FBO);
+    // FXAA must not wrap around the edges, the effects pass wants to (chaos)
+    target.Texture.Wrap_S = target.Texture.Wrap_T = this->antiAliasing == AA_FXAA ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+    target.Texture.Generate(target.Width, target.Height, NULL);
+    MemoryTracker::Label(GLOBJECT_TEXTURE, target.Texture.ID, "scene");
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.Texture.ID, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        LOG_ERROR("POSTPROCESSOR", "Failed to initialize FBO");
+    if (this->antiAliasing == AA_FXAA) {
+        target.FXAAFBO = FramebufferHandle::Create();
+        glBindFramebuffer(GL_FRAMEBUFFER, target.FXAAFBO);
+        target.FXAATexture.Generate(target.Width, target.Height, NULL);
+        MemoryTracker::Label(GLOBJECT_TEXTURE, target.FXAATexture.ID, "fxaa scene");
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.FXAATexture.ID, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            LOG_ERROR("POSTPROCESSOR", "Failed to initialize FXAA FBO");
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return target;
+}
+
 void PostProcessor::BeginRender() {
-    glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
+    // between frames, no target is in use
+    if (this->pendingWidth > 0)
+        this->resize(this->pendingWidth, this->pendingHeight);
+    this->readTimings();
+    glBeginQuery(GL_TIME_ELAPSED, this->timers[this->frame % GPU_TIMER_QUERIES]);
+    RenderTarget &target = this->target();
+    glBindFramebuffer(GL_FRAMEBUFFER, this->samples > 0 ? target.MSFBO : target.FBO);
+    // the projection stays in world units, so a smaller viewport is all it takes to scale the scene
+    glViewport(0, 0, target.Width, target.Height);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
 void PostProcessor::EndRender() {
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->MSFBO);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->FBO);
-    glBlitFramebuffer(0, 0, this->Width, this->Height, 0, 0, this->Width, this->Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    RenderTarget &target = this->targets[this->step];
+    if (this->samples > 0) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, target.MSFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.FBO);
+        glBlitFramebuffer(0, 0, target.Width, target.Height, 0, 0, target.Width, target.Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    if (this->antiAliasing == AA_FXAA) {
+        glBindFramebuffer(GL_FRAMEBUFFER, target.FXAAFBO);
+        this->FXAAShader.Use();
+        this->FXAAShader.SetVector2f("inverseSize", 1.0f / target.Width, 1.0f / target.Height);
+        glActiveTexture(GL_TEXTURE0);
+        target.Texture.Bind();
+        glBindVertexArray(this->VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindVertexArray(0);
+    }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
 }
 
 void PostProcessor::Render(float time) {
+    glViewport(this->viewportX, this->viewportY, this->viewportWidth, this->viewportHeight);
     this->PostProcessingShader.Use();
     this->PostProcessingShader.SetFloat("time", time);
     this->PostProcessingShader.SetInteger("confuse", this->Confuse);
     this->PostProcessingShader.SetInteger("chaos", this->Chaos);
     this->PostProcessingShader.SetInteger("shake", this->Shake);
 
+    // linear filtering does the upscale
     glActiveTexture(GL_TEXTURE0);
-    this->Texture.Bind();
+    const RenderTarget &target = this->targets[this->step];
+    if (this->antiAliasing == AA_FXAA)
+        target.FXAATexture.Bind();
+    else
+        target.Texture.Bind();
     glBindVertexArray(this->VAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
+    glEndQuery(GL_TIME_ELAPSED);
+    ++this->frame;
+}
+
+void PostProcessor::readTimings() {
+    // the query about to be reused was issued GPU_TIMER_QUERIES frames ago, only
+    // read it when the GPU is done with it so the CPU never waits
+    if (this->frame < GPU_TIMER_QUERIES)
+        return;
+    unsigned int query = this->timers[this->frame % GPU_TIMER_QUERIES];
+    int available = 0;
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return;
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+    this->updateScale(elapsed / 1000000.0f);
+}
+
+void PostProcessor::updateScale(float milliseconds) {
+    this->GPUTime = this->resample ? milliseconds : this->GPUTime * 0.9f + milliseconds * 0.1f;
+    this->resample = false;
+    if (this->cooldown > 0) {
+        --this->cooldown;
+        return;
+    }
+    unsigned int step = this->step;
+    if (!this->DynamicResolution)
+        step = 0;
+    else if (this->GPUTime > this->GPUBudget && step + 1 < RESOLUTION_STEPS)
+        ++step;
+    else if (step > 0) {
+        // cost follows the pixel count, so predict the larger step before taking it
+        float growth = RESOLUTION_SCALES[step - 1] / RESOLUTION_SCALES[step];
+        if (this->GPUTime * growth * growth < this->GPUBudget * RESOLUTION_HEADROOM)
+            --step;
+    }
+    if (step != this->step) {
+        this->step = step;
+        this->cooldown = RESOLUTION_COOLDOWN;
+        this->resample = true;
+    }
 }
 
 void PostProcessor::initRenderData() {
-    unsigned int VBO;
     float vertices[] = {
         // pos        // tex
         -1.0f, -1.0f, 0.0f, 0.0f,
@@ -90,11 +266,14 @@ void PostProcessor::initRenderData() {
          1.0f, -1.0f, 1.0f, 0.0f,
          1.0f,  1.0f, 1.0f, 1.0f
     };
-    glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &VBO);
+    this->VAO = VertexArrayHandle::Create();
+    this->VBO = BufferHandle::Create();
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    MemoryScope memoryScope(MEMORY_RENDER_TARGETS);
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    MemoryTracker::TrackBuffer(this->VBO, sizeof(vertices));
+    MemoryTracker::Label(GLOBJECT_BUFFER, this->VBO, "screen quad");
 
     glBindVertexArray(this->VAO);
     glEnableVertexAttribArray(0);
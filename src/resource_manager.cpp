@@ -1,73 +1,70 @@
 #include "../include/resource_manager.h"
 
-#include <iostream>
-#include <sstream>
-#include <fstream>
-
+#include "../include/asset_pack.h"
+#include "../include/log.h"
+#include "../include/memory_tracker.h"
 #include "../include/stb_image.h"
 
 // instantiate static variables
 std::map<std::string, Texture2D>    ResourceManager::Textures;
 std::map<std::string, Shader>       ResourceManager::Shaders;
 
-Shader ResourceManager::LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name) {
+Shader &ResourceManager::LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name) {
     Shaders[name] = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile);
     return Shaders[name];
 }
 
-Shader ResourceManager::GetShader(std::string name) {
+Shader &ResourceManager::LoadFeedbackShader(const char *vShaderFile, const char **varyings, unsigned int count, std::string name) {
+    Shaders[name] = loadFeedbackShaderFromFile(vShaderFile, varyings, count);
     return Shaders[name];
 }
 
-Texture2D ResourceManager::LoadTexture(const char *file, bool alpha, std::string name) {
-    Textures[name] = loadTextureFromFile(file, alpha);
-    return Textures[name];
+Shader &ResourceManager::GetShader(std::string name) {
+    return Shaders[name];
 }
 
-Texture2D ResourceManager::GetTexture(std::string name) {
+Texture2D &ResourceManager::LoadTexture(const char *file, bool alpha, std::string name) {
+    MemoryScope memoryScope(MEMORY_ASSETS);
+    Texture2D &texture = Textures[name] = loadTextureFromFile(file, alpha);
+    MemoryTracker::Label(GLOBJECT_TEXTURE, texture.ID, name.c_str());
+    return texture;
+}
+
+Texture2D &ResourceManager::GetTexture(std::string name) {
     return Textures[name];
 }
 
 void ResourceManager::Clear() {
-    for (auto iter : Shaders) 
-        glDeleteProgram(iter.second.ID);
-    for (auto iter : Textures)
-        glDeleteTextures(1, &iter.second.ID);
+    // the handles delete the GL objects
+    Shaders.clear();
+    Textures.clear();
+    MemoryTracker::CheckLeaks("ResourceManager::Clear", MEMORY_ASSETS);
 }
 
 Shader ResourceManager::loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile) {
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::string geometryCode;
-    try {
-        std::ifstream vertexShaderFile(vShaderFile);
-        std::ifstream fragmentShaderFile(fShaderFile);
-        std::stringstream vShaderStream, fShaderStream;
-        vShaderStream << vertexShaderFile.rdbuf();
-        fShaderStream << fragmentShaderFile.rdbuf();
-        vertexShaderFile.close();
-        fragmentShaderFile.close();
-        
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-
-        if (gShaderFile != nullptr) {
-            std::ifstream geometryShaderFile(gShaderFile);
-            std::stringstream gShaderStream;
-            gShaderStream << geometryShaderFile.rdbuf();
-            geometryShaderFile.close();
-            geometryCode = gShaderStream.str();
-        }
-    }
-    catch (std::exception e) {
-        std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
+    // the sources are compiled straight from the pack, both it and loose files are 0 terminated
+    AssetData vertexCode(vShaderFile);
+    AssetData fragmentCode(fShaderFile);
+    if (!vertexCode.Valid() || !fragmentCode.Valid())
+        LOG_ERROR("SHADER", "Failed to read shader files", {{ "vertex", vShaderFile }, { "fragment", fShaderFile }});
+    Shader shader;
+    if (gShaderFile != nullptr) {
+        AssetData geometryCode(gShaderFile);
+        shader.Compile(vertexCode.Text(), fragmentCode.Text(), geometryCode.Text());
     }
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
-    const char *gShaderCode = geometryCode.c_str();
+    else
+        shader.Compile(vertexCode.Text(), fragmentCode.Text(), nullptr);
+
+    return shader;
+}
+
+Shader ResourceManager::loadFeedbackShaderFromFile(const char *vShaderFile, const char **varyings, unsigned int count) {
+    AssetData vertexCode(vShaderFile);
+    if (!vertexCode.Valid())
+        LOG_ERROR("SHADER", "Failed to read shader files", {{ "vertex", vShaderFile }});
 
     Shader shader;
-    shader.Compile(vShaderCode, fShaderCode, gShaderFile != nullptr ? gShaderCode : nullptr);
+    shader.CompileFeedback(vertexCode.Text(), varyings, count);
 
     return shader;
 }
@@ -78,8 +75,11 @@ Texture2D ResourceManager::loadTextureFromFile(const char *file, bool alpha) {
         texture.Internal_Format = GL_RGBA;
         texture.Image_Format = GL_RGBA;
     }
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(file, &width, &height, &nrChannels, 0);
+    int width = 0, height = 0, nrChannels;
+    unsigned char* data = nullptr;
+    AssetData image(file);
+    if (image.Valid())
+        data = stbi_load_from_memory(image.Data(), (int)image.Size(), &width, &height, &nrChannels, 0);
     texture.Generate(width, height, data);
     stbi_image_free(data);
     
@@ -0,0 +1,112 @@
+#include "../include/rewind_buffer.h"
+#include "../include/state_codec.h"
+#include "../include/log.h"
+
+#include <algorithm>
+#include <cstring>
+
+const unsigned int NO_OFFSET = 0xFFFFFFFF;
+
+RewindBuffer::RewindBuffer(const Game &game, unsigned int capacity, unsigned int bytes)
+    : entries(std::max(capacity, 1u)), first(0), count(0), bytes(bytes), head(0), lost(0)
+{
+    unsigned int bricks = 0;
+    for (const GameLevel &level : game.Levels)
+        bricks += level.Bricks.Size();
+    unsigned int maxBytes = StateCodec::MaxBytes(bricks);
+    this->encoded.resize(maxBytes);
+    this->delta.resize(maxBytes);
+    this->rebuilt.resize(maxBytes);
+    MemoryScope memoryScope(MEMORY_REWIND);
+    this->memory.Track("rewind history", this->entries.capacity() * sizeof(Entry) + this->bytes.capacity() + 3 * maxBytes);
+}
+
+void RewindBuffer::Push(const GameSnapshot &snapshot) {
+    unsigned int size = StateCodec::Encode(snapshot, this->encoded.data());
+    const unsigned char *data = this->encoded.data();
+    Entry added = { 0, size, 0, 0, 0 };
+    if (this->count > 0 && this->entry(0).Distance + 1 < REWIND_KEYFRAME) {
+        const Entry &newest = this->entry(0);
+        Entry delta = { 0, 0, newest.Offset, newest.Size, 1 };
+        if (newest.Distance > 0) {
+            delta.Base = newest.Base;
+            delta.BaseSize = newest.BaseSize;
+            delta.Distance = newest.Distance + 1;
+        }
+        // a delta no smaller than the state is not worth it
+        delta.Size = StateCodec::Delta(&this->bytes[delta.Base], delta.BaseSize, data, size, this->delta.data(), size - 1);
+        if (delta.Size > 0) {
+            added = delta;
+            data = this->delta.data();
+        }
+    }
+    while (this->count == this->entries.size() || this->allocate(added.Size) == NO_OFFSET) {
+        if (this->count == 0) {
+            if (this->lost++ == 0)
+                LOG_WARNING("REWIND", "State larger than the history, not kept", {{ "bytes", size }, { "history", (unsigned int)this->bytes.size() }});
+            return;
+        }
+        // the keyframe about to go is the one the delta needs, the state is kept whole instead
+        if (added.Distance > 0 && this->entry(this->count - 1).Offset == added.Base) {
+            added = { 0, size, 0, 0, 0 };
+            data = this->encoded.data();
+        }
+        this->dropOldest();
+    }
+    added.Offset = this->allocate(added.Size);
+    std::memcpy(&this->bytes[added.Offset], data, added.Size);
+    this->head = added.Offset + added.Size;
+    ++this->count;
+    this->entry(0) = added;
+}
+
+bool RewindBuffer::Read(unsigned int back, GameSnapshot &snapshot) {
+    if (back >= this->count)
+        return false;
+    const Entry &state = this->entry(back);
+    if (state.Distance == 0)
+        return StateCodec::Decode(&this->bytes[state.Offset], state.Size, snapshot);
+    unsigned int size = StateCodec::Apply(&this->bytes[state.Base], state.BaseSize, &this->bytes[state.Offset], state.Size,
+        this->rebuilt.data(), this->rebuilt.size());
+    return size > 0 && StateCodec::Decode(this->rebuilt.data(), size, snapshot);
+}
+
+void RewindBuffer::Drop(unsigned int states) {
+    // the ring gives back what the newest took, any gap before a wrap included
+    for (states = std::min(states, this->count); states > 0; --states) {
+        this->head = this->entry(0).Offset;
+        --this->count;
+    }
+}
+
+void RewindBuffer::Clear() {
+    this->first = this->count = this->head = 0;
+}
+
+unsigned int RewindBuffer::UsedBytes() const {
+    if (this->count == 0)
+        return 0;
+    unsigned int tail = this->entry(this->count - 1).Offset;
+    return this->head > tail ? this->head - tail : this->bytes.size() - tail + this->head;
+}
+
+unsigned int RewindBuffer::allocate(unsigned int size) const {
+    if (this->count == 0)
+        return size <= this->bytes.size() ? 0 : NO_OFFSET;
+    // held bytes run from the oldest state's offset up to head, possibly around
+    // the end; head never catches up with the oldest, equal would mean empty
+    unsigned int tail = this->entry(this->count - 1).Offset;
+    if (this->head > tail) {
+        if (this->bytes.size() - this->head >= size)
+            return this->head;
+        return size < tail ? 0 : NO_OFFSET;
+    }
+    return this->head + size < tail ? this->head : NO_OFFSET;
+}
+
+void RewindBuffer::dropOldest() {
+    do {
+        this->first = (this->first + 1) % this->entries.size();
+        --this->count;
+    } while (this->count > 0 && this->entry(this->count - 1).Distance != 0);
+}
@@ -1,6 +1,6 @@
 #include "../include/shader.h"
 
-#include <iostream>
+#include "../include/log.h"
 
 Shader &Shader::Use()
 {
@@ -28,7 +28,7 @@ void Shader::Compile(const char* vertexSource, const char* fragmentSource, const
         glCompileShader(gShader);
         checkCompileErrors(gShader, "GEOMETRY");
     }
-    this->ID = glCreateProgram();
+    this->ID = ProgramHandle::Create();
     glAttachShader(this->ID, sVertex);
     glAttachShader(this->ID, sFragment);
     if (geometrySource != nullptr)
@@ -41,6 +41,28 @@ void Shader::Compile(const char* vertexSource, const char* fragmentSource, const
         glDeleteShader(gShader);
 }
 
+void Shader::CompileFeedback(const char *vertexSource, const char **varyings, unsigned int count)
+{
+    unsigned int sVertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(sVertex, 1, &vertexSource, NULL);
+    glCompileShader(sVertex);
+    checkCompileErrors(sVertex, "VERTEX");
+    this->ID = ProgramHandle::Create();
+    glAttachShader(this->ID, sVertex);
+    // varyings have to be declared before linking
+    glTransformFeedbackVaryings(this->ID, count, varyings, GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(this->ID);
+    checkCompileErrors(this->ID, "PROGRAM");
+    glDeleteShader(sVertex);
+}
+
+bool Shader::IsLinked() const
+{
+    int success = 0;
+    glGetProgramiv(this->ID, GL_LINK_STATUS, &success);
+    return success != 0;
+}
+
 void Shader::SetFloat(const char *name, float value, bool useShader)
 {
     if (useShader)
@@ -65,6 +87,12 @@ void Shader::SetVector2f(const char *name, const glm::vec2 &value, bool useShade
         this->Use();
     glUniform2f(glGetUniformLocation(this->ID, name), value.x, value.y);
 }
+void Shader::SetVector2fv(const char *name, const glm::vec2 *values, unsigned int count, bool useShader)
+{
+    if (useShader)
+        this->Use();
+    glUniform2fv(glGetUniformLocation(this->ID, name), count, &values[0].x);
+}
 void Shader::SetVector3f(const char *name, float x, float y, float z, bool useShader)
 {
     if (useShader)
@@ -107,9 +135,7 @@ void Shader::checkCompileErrors(unsigned int object, std::string type)
         if (!success)
         {
             glGetShaderInfoLog(object, 1024, NULL, infoLog);
-            std::cout << "| ERROR::SHADER: Compile-time error: Type: " << type << "\n"
-                << infoLog << "\n -- --------------------------------------------------- -- "
-                << std::endl;
+            LOG_ERROR("SHADER", "Compile-time error", {{ "type", type }, { "log", infoLog }});
         }
     }
     else
@@ -118,9 +144,7 @@ void Shader::checkCompileErrors(unsigned int object, std::string type)
         if (!success)
         {
             glGetProgramInfoLog(object, 1024, NULL, infoLog);
-            std::cout << "| ERROR::Shader: Link-time error: Type: " << type << "\n"
-                << infoLog << "\n -- --------------------------------------------------- -- "
-                << std::endl;
+            LOG_ERROR("SHADER", "Link-time error", {{ "type", type }, { "log", infoLog }});
         }
     }
 }
@@ -1,85 +1,74 @@
 #include "../include/sprite_renderer.h"
 
+#include <cstddef>
 
-SpriteRenderer::SpriteRenderer(Shader &&shader) {
-    this->shader = shader;
-    this->initRenderData();
-}
 
-SpriteRenderer::~SpriteRenderer() {
-    glDeleteVertexArrays(1, &this->quadVAO);
+unsigned int PackColor(glm::vec3 color, float alpha) {
+    glm::vec4 bytes = glm::clamp(glm::vec4(color, alpha), 0.0f, 1.0f) * 255.0f + 0.5f;
+    return (unsigned int)bytes.r | (unsigned int)bytes.g << 8 | (unsigned int)bytes.b << 16 | (unsigned int)bytes.a << 24;
 }
 
-void SpriteRenderer::DrawSprite(Texture2D &&texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color) {
-    // prepare transformations
-    this->shader.Use();
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(position, 0.0f));  // first translate (transformations are: scale happens first, then rotation, and then final translation happens; reversed order)
-
-    model = glm::translate(model, glm::vec3(0.5f * size.x, 0.5f * size.y, 0.0f)); // move origin of rotation to center of quad
-    model = glm::rotate(model, glm::radians(rotate), glm::vec3(0.0f, 0.0f, 1.0f)); // then rotate
-    model = glm::translate(model, glm::vec3(-0.5f * size.x, -0.5f * size.y, 0.0f)); // move origin back
-
-    model = glm::scale(model, glm::vec3(size, 1.0f));
-
-    this->shader.SetMatrix4("model", model);
-
-    this->shader.SetVector3f("spriteColor", color);
+SpriteRenderer::SpriteRenderer(Shader &shader, StreamBuffer &stream)
+    : shader(shader), stream(stream), instances(nullptr), count(0), texture(nullptr)
+{
+    this->initRenderData();
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    texture.Bind();
+void SpriteRenderer::DrawSprite(const Texture2D &texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color) {
+    SpriteInstance *instance = this->Queue(texture);
+    if (!instance)
+        return;
+    // written field by field, the mapping may be write-combined memory that should never be read
+    instance->Position = position;
+    instance->Size = size;
+    instance->Rotation = rotate != 0.0f ? glm::radians(rotate) : 0.0f;
+    instance->Color = PackColor(color);
+}
 
-    glBindVertexArray(this->quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+SpriteInstance *SpriteRenderer::Queue(const Texture2D &texture) {
+    if (this->texture != &texture || this->count == SPRITE_BATCH)
+        this->Flush();
+    if (!this->instances) {
+        this->instances = (SpriteInstance*)this->stream.Map(SPRITE_BATCH * sizeof(SpriteInstance));
+        if (!this->instances)
+            return nullptr;
+    }
+    this->texture = &texture;
+    return &this->instances[this->count++];
 }
 
-void SpriteRenderer::DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color) {
-    // prepare transformations
+void SpriteRenderer::Flush() {
+    if (!this->instances)
+        return;
+    unsigned int offset = this->stream.Unmap(this->count * sizeof(SpriteInstance));
+    unsigned int count = this->count;
+    this->instances = nullptr;
+    this->count = 0;
+    if (count == 0)
+        return;
     this->shader.Use();
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(position, 0.0f));  // first translate (transformations are: scale happens first, then rotation, and then final translation happens; reversed order)
-
-    model = glm::translate(model, glm::vec3(0.5f * size.x, 0.5f * size.y, 0.0f)); // move origin of rotation to center of quad
-    model = glm::rotate(model, glm::radians(rotate), glm::vec3(0.0f, 0.0f, 1.0f)); // then rotate
-    model = glm::translate(model, glm::vec3(-0.5f * size.x, -0.5f * size.y, 0.0f)); // move origin back
-
-    model = glm::scale(model, glm::vec3(size, 1.0f));
-
-    this->shader.SetMatrix4("model", model);
-
-    this->shader.SetVector3f("spriteColor", color);
-
     glActiveTexture(GL_TEXTURE0);
-    texture.Bind();
+    this->texture->Bind();
 
+    // the batch moves through the ring, so the attributes are pointed at it every time
     glBindVertexArray(this->quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindBuffer(GL_ARRAY_BUFFER, this->stream.ID());
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, Position)));
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, Rotation)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, Color)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
     glBindVertexArray(0);
 }
 
 void SpriteRenderer::initRenderData() {
-    unsigned int VBO;
-    float vertices[] = { 
-        // pos      // tex
-        0.0f, 1.0f, 0.0f, 1.0f,
-        1.0f, 0.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 0.0f, 0.0f, 
-
-        0.0f, 1.0f, 0.0f, 1.0f,
-        1.0f, 1.0f, 1.0f, 1.0f,
-        1.0f, 0.0f, 1.0f, 0.0f
-    };
-
-    glGenVertexArrays(1, &this->quadVAO);
-    glGenBuffers(1, &VBO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
+    // the quad corners come from gl_VertexID, the instances from the stream
+    // buffer, pointed at in Flush
+    this->quadVAO = VertexArrayHandle::Create();
     glBindVertexArray(this->quadVAO);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    for (unsigned int attribute = 0; attribute < 3; ++attribute) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
     glBindVertexArray(0);
 }
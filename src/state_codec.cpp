@@ -0,0 +1,320 @@
+#include "../include/state_codec.h"
+
+#include <cstring>
+
+// a zero run this short is cheaper left inside the literal bytes around it
+const unsigned int DELTA_MIN_ZEROS = 2;
+const unsigned int KEY_COUNT = 1024;
+
+// fields are raw and in host byte order, an encoding is read back by the build that wrote it
+
+struct Writer {
+    unsigned char *At;
+
+    template <typename T>
+    void Put(const T &value) {
+        std::memcpy(this->At, &value, sizeof(T));
+        this->At += sizeof(T);
+    }
+    template <typename T>
+    void PutColumn(const std::vector<T> &values) {
+        if (!values.empty())
+            std::memcpy(this->At, values.data(), values.size() * sizeof(T));
+        this->At += values.size() * sizeof(T);
+    }
+};
+
+struct Reader {
+    const unsigned char *At, *End;
+
+    bool Has(size_t bytes) const { return (size_t)(this->End - this->At) >= bytes; }
+    template <typename T>
+    bool Get(T &value) {
+        if (!this->Has(sizeof(T)))
+            return false;
+        std::memcpy(&value, this->At, sizeof(T));
+        this->At += sizeof(T);
+        return true;
+    }
+    // resizes within the reservation only, Decode never allocates
+    template <typename T>
+    bool GetColumn(std::vector<T> &values, unsigned int count) {
+        if (count > values.capacity() || !this->Has(count * sizeof(T)))
+            return false;
+        values.resize(count);
+        if (count > 0)
+            std::memcpy(values.data(), this->At, count * sizeof(T));
+        this->At += count * sizeof(T);
+        return true;
+    }
+};
+
+static void putBits(Writer &out, const bool *bits, unsigned int count) {
+    for (unsigned int i = 0; i < count; i += 8) {
+        unsigned char byte = 0;
+        for (unsigned int b = 0; b < 8 && i + b < count; ++b)
+            byte |= bits[i + b] << b;
+        out.Put(byte);
+    }
+}
+
+static bool getBits(Reader &in, bool *bits, unsigned int count) {
+    for (unsigned int i = 0; i < count; i += 8) {
+        unsigned char byte;
+        if (!in.Get(byte))
+            return false;
+        for (unsigned int b = 0; b < 8 && i + b < count; ++b)
+            bits[i + b] = byte >> b & 1;
+    }
+    return true;
+}
+
+static void putColors(Writer &out, const std::vector<Sprite> &sprites) {
+    for (const Sprite &sprite : sprites)
+        out.Put(sprite.Color);
+}
+
+static bool getColors(Reader &in, std::vector<Sprite> &sprites, unsigned int count) {
+    if (count > sprites.capacity() || !in.Has(count * sizeof(glm::vec3)))
+        return false;
+    sprites.resize(count);
+    for (Sprite &sprite : sprites) {
+        sprite.Texture = nullptr;
+        in.Get(sprite.Color);
+    }
+    return true;
+}
+
+static void putVelocities(Writer &out, const std::vector<Motion> &motions) {
+    for (const Motion &motion : motions)
+        out.Put(motion.Velocity);
+}
+
+static bool getVelocities(Reader &in, std::vector<Motion> &motions, unsigned int count) {
+    if (count > motions.capacity() || !in.Has(count * sizeof(glm::vec2)))
+        return false;
+    motions.resize(count);
+    for (Motion &motion : motions)
+        in.Get(motion.Velocity);
+    return true;
+}
+
+// bytes per row of each table
+const unsigned int BALL_BYTES    = sizeof(Transform) + sizeof(glm::vec2) + sizeof(glm::vec3) + sizeof(float) + 1;
+const unsigned int POWERUP_BYTES = sizeof(Transform) + sizeof(glm::vec2) + sizeof(glm::vec3) + 1;
+const unsigned int TIMER_BYTES   = sizeof(unsigned long long) + 1 + sizeof(unsigned int);
+const unsigned int FIXED_BYTES   = 1 + 1 + 2 + 4 + KEY_COUNT / 8 + 8 + 4 + sizeof(Transform) + sizeof(glm::vec3)
+                                 + 2 + 2 + POWERUP_TYPE_COUNT * 2 + 1 + 8 + 8 + 2 + 4;
+
+unsigned int StateCodec::MaxBytes(unsigned int bricks) {
+    return FIXED_BYTES + MAX_BALLS * BALL_BYTES + MAX_POWERUPS * POWERUP_BYTES + MAX_TIMERS * TIMER_BYTES + (bricks + 7) / 8;
+}
+
+unsigned int StateCodec::Encode(const GameSnapshot &snapshot, unsigned char *out) {
+    Writer writer = { out };
+    writer.Put(STATE_VERSION);
+    writer.Put((unsigned char)snapshot.State);
+    writer.Put((unsigned short)snapshot.Level);
+    writer.Put(snapshot.StressBalls);
+    putBits(writer, snapshot.Keys, KEY_COUNT);
+    writer.Put(snapshot.InputTime);
+    writer.Put(snapshot.Random);
+    writer.Put(snapshot.Paddle);
+    writer.Put(snapshot.PaddleColor);
+
+    const BallTable &balls = snapshot.Balls;
+    writer.Put((unsigned short)balls.Size());
+    writer.PutColumn(balls.Transforms);
+    putVelocities(writer, balls.Motions);
+    putColors(writer, balls.Sprites);
+    for (const BallState &ball : balls.States)
+        writer.Put(ball.Radius);
+    for (const BallState &ball : balls.States)
+        writer.Put((unsigned char)(ball.Stuck | ball.Sticky << 1 | ball.PassThrough << 2));
+
+    const PowerUpTable &powerUps = snapshot.PowerUps;
+    writer.Put((unsigned short)powerUps.Size());
+    writer.PutColumn(powerUps.Transforms);
+    putVelocities(writer, powerUps.Motions);
+    putColors(writer, powerUps.Sprites);
+    writer.PutColumn(powerUps.Types);
+
+    for (unsigned int type = 0; type < POWERUP_TYPE_COUNT; ++type)
+        writer.Put((unsigned short)snapshot.ActiveEffects[type]);
+    writer.Put((unsigned char)(snapshot.Shake | snapshot.Confuse << 1 | snapshot.Chaos << 2));
+    writer.Put(snapshot.TimerElapsed);
+    writer.Put(snapshot.TimerTick);
+    writer.Put((unsigned short)snapshot.Timers.size());
+    for (const GameTimer &timer : snapshot.Timers)
+        writer.Put(timer.Expires);
+    for (const GameTimer &timer : snapshot.Timers)
+        writer.Put((unsigned char)timer.Kind);
+    for (const GameTimer &timer : snapshot.Timers)
+        writer.Put(timer.Data);
+
+    unsigned int bricks = snapshot.Destroyed.size();
+    writer.Put(bricks);
+    for (unsigned int i = 0; i < bricks; i += 8) {
+        unsigned char byte = 0;
+        for (unsigned int b = 0; b < 8 && i + b < bricks; ++b)
+            byte |= (snapshot.Destroyed[i + b] != 0) << b;
+        writer.Put(byte);
+    }
+    return writer.At - out;
+}
+
+bool StateCodec::Decode(const unsigned char *data, unsigned int size, GameSnapshot &snapshot) {
+    Reader reader = { data, data + size };
+    unsigned char version, state, flags;
+    unsigned short level, count;
+    if (!reader.Get(version) || version != STATE_VERSION || !reader.Get(state) || !reader.Get(level) || !reader.Get(snapshot.StressBalls)
+        || !getBits(reader, snapshot.Keys, KEY_COUNT) || !reader.Get(snapshot.InputTime) || !reader.Get(snapshot.Random)
+        || !reader.Get(snapshot.Paddle) || !reader.Get(snapshot.PaddleColor))
+        return false;
+    snapshot.State = (GameState)state;
+    snapshot.Level = level;
+
+    BallTable &balls = snapshot.Balls;
+    if (!reader.Get(count) || count > balls.States.capacity() || !reader.GetColumn(balls.Transforms, count)
+        || !getVelocities(reader, balls.Motions, count) || !getColors(reader, balls.Sprites, count)
+        || !reader.Has(count * (sizeof(float) + 1)))
+        return false;
+    balls.States.resize(count);
+    for (BallState &ball : balls.States)
+        reader.Get(ball.Radius);
+    for (BallState &ball : balls.States) {
+        reader.Get(flags);
+        ball.Stuck = flags & 1;
+        ball.Sticky = flags >> 1 & 1;
+        ball.PassThrough = flags >> 2 & 1;
+    }
+
+    PowerUpTable &powerUps = snapshot.PowerUps;
+    if (!reader.Get(count) || !reader.GetColumn(powerUps.Transforms, count) || !getVelocities(reader, powerUps.Motions, count)
+        || !getColors(reader, powerUps.Sprites, count) || !reader.GetColumn(powerUps.Types, count))
+        return false;
+    for (PowerUpType type : powerUps.Types)
+        if (type >= POWERUP_TYPE_COUNT)
+            return false;
+
+    for (unsigned int type = 0; type < POWERUP_TYPE_COUNT; ++type) {
+        unsigned short active;
+        if (!reader.Get(active))
+            return false;
+        snapshot.ActiveEffects[type] = active;
+    }
+    if (!reader.Get(flags) || !reader.Get(snapshot.TimerElapsed) || !reader.Get(snapshot.TimerTick) || !reader.Get(count)
+        || count > snapshot.Timers.capacity() || !reader.Has(count * TIMER_BYTES))
+        return false;
+    snapshot.Shake = flags & 1;
+    snapshot.Confuse = flags >> 1 & 1;
+    snapshot.Chaos = flags >> 2 & 1;
+    snapshot.Timers.resize(count);
+    for (GameTimer &timer : snapshot.Timers)
+        reader.Get(timer.Expires);
+    for (GameTimer &timer : snapshot.Timers) {
+        unsigned char kind;
+        reader.Get(kind);
+        timer.Kind = kind;
+    }
+    for (GameTimer &timer : snapshot.Timers)
+        reader.Get(timer.Data);
+
+    unsigned int bricks;
+    if (!reader.Get(bricks) || bricks > snapshot.Destroyed.capacity() || !reader.Has((bricks + 7) / 8))
+        return false;
+    snapshot.Destroyed.resize(bricks);
+    for (unsigned int i = 0; i < bricks; i += 8) {
+        unsigned char byte;
+        reader.Get(byte);
+        for (unsigned int b = 0; b < 8 && i + b < bricks; ++b)
+            snapshot.Destroyed[i + b] = byte >> b & 1;
+    }
+    return reader.At == reader.End;
+}
+
+// LEB128, 7 bits a byte with the high bit set on all but the last
+
+static bool putVarint(unsigned char *&out, const unsigned char *end, unsigned int value) {
+    do {
+        if (out == end)
+            return false;
+        *out++ = (value & 0x7F) | (value >= 0x80 ? 0x80 : 0);
+        value >>= 7;
+    } while (value != 0);
+    return true;
+}
+
+static bool getVarint(const unsigned char *&in, const unsigned char *end, unsigned int &value) {
+    value = 0;
+    for (unsigned int shift = 0; shift < 32; shift += 7) {
+        if (in == end)
+            return false;
+        unsigned char byte = *in++;
+        value |= (unsigned int)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static unsigned char at(const unsigned char *data, unsigned int size, unsigned int i) {
+    return i < size ? data[i] : 0;
+}
+
+unsigned int StateCodec::Delta(const unsigned char *base, unsigned int baseSize, const unsigned char *state, unsigned int stateSize,
+                               unsigned char *out, unsigned int capacity) {
+    unsigned char *cursor = out, *end = out + capacity;
+    if (!putVarint(cursor, end, stateSize))
+        return 0;
+    // pairs of a zero run and the literal XOR bytes after it, the zeros at the end are implied
+    unsigned int i = 0;
+    while (true) {
+        unsigned int zeros = i;
+        while (zeros < stateSize && state[zeros] == at(base, baseSize, zeros))
+            ++zeros;
+        if (zeros == stateSize)
+            break;
+        unsigned int literal = zeros, same = 0;
+        while (literal < stateSize && same < DELTA_MIN_ZEROS) {
+            same = state[literal] == at(base, baseSize, literal) ? same + 1 : 0;
+            ++literal;
+        }
+        literal -= same;
+        if (!putVarint(cursor, end, zeros - i) || !putVarint(cursor, end, literal - zeros) || (unsigned int)(end - cursor) < literal - zeros)
+            return 0;
+        for (unsigned int b = zeros; b < literal; ++b)
+            *cursor++ = state[b] ^ at(base, baseSize, b);
+        i = literal;
+    }
+    return cursor - out;
+}
+
+unsigned int StateCodec::Apply(const unsigned char *base, unsigned int baseSize, const unsigned char *delta, unsigned int deltaSize,
+                               unsigned char *out, unsigned int capacity) {
+    const unsigned char *cursor = delta, *end = delta + deltaSize;
+    unsigned int stateSize;
+    if (!getVarint(cursor, end, stateSize) || stateSize > capacity)
+        return 0;
+    unsigned int i = 0;
+    while (cursor != end) {
+        unsigned int zeros, literal;
+        if (!getVarint(cursor, end, zeros) || !getVarint(cursor, end, literal) || zeros > stateSize - i || literal > stateSize - i - zeros
+            || (unsigned int)(end - cursor) < literal)
+            return 0;
+        for (unsigned int b = 0; b < zeros; ++b, ++i)
+            out[i] = at(base, baseSize, i);
+        for (unsigned int b = 0; b < literal; ++b, ++i)
+            out[i] = at(base, baseSize, i) ^ *cursor++;
+    }
+    for (; i < stateSize; ++i)
+        out[i] = at(base, baseSize, i);
+    return stateSize;
+}
+
+unsigned int StateCodec::Checksum(const unsigned char *data, unsigned int size) {
+    unsigned int hash = 2166136261u;
+    for (unsigned int i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
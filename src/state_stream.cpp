@@ -0,0 +1,170 @@
+#include "../include/state_stream.h"
+#include "../include/state_codec.h"
+#include "../include/log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+static_assert(std::atomic<unsigned long long>::is_always_lock_free, "the ring head is shared between processes");
+
+#ifndef _WIN32
+static bool socketAddress(const char *path, sockaddr_un &address) {
+    if (std::strlen(path) >= sizeof(address.sun_path))
+        return false;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path);
+    return true;
+}
+#endif
+
+StateStream::StateStream(const Game &game)
+    : Ticks(0), Dropped(0), header(nullptr), ring(nullptr), mappedBytes(0), socket(-1), previousSize(0)
+{
+    unsigned int bricks = 0;
+    for (const GameLevel &level : game.Levels)
+        bricks += level.Bricks.Size();
+    if (bricks > STREAM_MAX_BRICKS)
+        LOG_WARNING("STATE_STREAM", "More bricks than readers expect", {{ "bricks", bricks }, { "limit", STREAM_MAX_BRICKS }});
+    unsigned int maxBytes = StateCodec::MaxBytes(bricks);
+    this->previous.resize(maxBytes);
+    this->current.resize(maxBytes);
+    this->message.resize((sizeof(StreamMessage) + maxBytes + 7) & ~7u);
+    MemoryScope memoryScope(MEMORY_STATE_STREAM);
+    this->memory.Track("state stream", this->previous.size() + this->current.size() + this->message.size());
+}
+
+StateStream::~StateStream() {
+#ifndef _WIN32
+    if (this->header) {
+        munmap(this->header, this->mappedBytes);
+        shm_unlink(this->name.c_str());
+    }
+    if (this->socket >= 0)
+        close(this->socket);
+#endif
+}
+
+bool StateStream::OpenSharedMemory(const char *name) {
+#ifdef _WIN32
+    LOG_ERROR("STATE_STREAM", "Shared memory streaming needs POSIX");
+    return false;
+#else
+    if (this->header)
+        return false;
+    // a reader still mapping the old one keeps it alive until it lets go
+    shm_unlink(name);
+    int file = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (file < 0) {
+        LOG_ERROR("STATE_STREAM", "Failed to create shared memory", {{ "name", name }});
+        return false;
+    }
+    size_t bytes = sizeof(StreamHeader) + STREAM_RING_BYTES;
+    void *data = ftruncate(file, bytes) == 0 ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+    close(file);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("STATE_STREAM", "Failed to map shared memory", {{ "name", name }, { "bytes", bytes }});
+        shm_unlink(name);
+        return false;
+    }
+    this->name = name;
+    this->mappedBytes = bytes;
+    this->header = new (data) StreamHeader();
+    this->header->Version = STREAM_VERSION;
+    this->header->Capacity = STREAM_RING_BYTES;
+    // a write may pad out the end of the ring before its message
+    this->header->MaxMessage = 2 * this->message.size();
+    this->header->Head.store(0, std::memory_order_relaxed);
+    this->header->Reserved.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(this->header->Magic, "PSTM", 4);
+    this->ring = static_cast<unsigned char*>(data) + sizeof(StreamHeader);
+    MemoryScope memoryScope(MEMORY_STATE_STREAM);
+    this->memory.Track("state stream", this->previous.size() + this->current.size() + this->message.size() + bytes);
+    return true;
+#endif
+}
+
+bool StateStream::OpenSocket(const char *path) {
+#ifdef _WIN32
+    LOG_ERROR("STATE_STREAM", "Socket streaming needs POSIX");
+    return false;
+#else
+    sockaddr_un address;
+    if (this->socket >= 0 || !socketAddress(path, address)) {
+        LOG_ERROR("STATE_STREAM", "Bad socket path", {{ "path", path }});
+        return false;
+    }
+    this->socket = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (this->socket < 0) {
+        LOG_ERROR("STATE_STREAM", "Failed to create socket");
+        return false;
+    }
+    this->path = path;
+    return true;
+#endif
+}
+
+void StateStream::Publish(const GameSnapshot &snapshot) {
+    unsigned int size = StateCodec::Encode(snapshot, this->current.data());
+    StreamMessage *message = reinterpret_cast<StreamMessage*>(this->message.data());
+    unsigned char *payload = this->message.data() + sizeof(StreamMessage);
+    message->Type = STREAM_KEYFRAME_STATE;
+    message->Tick = this->Ticks;
+    message->Checksum = StateCodec::Checksum(this->current.data(), size);
+    message->PayloadSize = 0;
+    // readers that lost track pick up again at a keyframe
+    if (this->Ticks % STREAM_KEYFRAME != 0 && this->previousSize > 0)
+        message->PayloadSize = StateCodec::Delta(this->previous.data(), this->previousSize, this->current.data(), size, payload, size - 1);
+    if (message->PayloadSize > 0)
+        message->Type = STREAM_DELTA_STATE;
+    else {
+        std::memcpy(payload, this->current.data(), size);
+        message->PayloadSize = size;
+    }
+    message->Size = (sizeof(StreamMessage) + message->PayloadSize + 7) & ~7u;
+    this->write(this->message.data(), message->Size);
+    std::swap(this->previous, this->current);
+    this->previousSize = size;
+    ++this->Ticks;
+}
+
+void StateStream::write(const unsigned char *data, unsigned int size) {
+#ifndef _WIN32
+    if (this->header) {
+        unsigned long long head = this->header->Head.load(std::memory_order_relaxed);
+        unsigned int offset = head % STREAM_RING_BYTES;
+        unsigned int skip = STREAM_RING_BYTES - offset < size ? STREAM_RING_BYTES - offset : 0;
+        // a seqlock writer: a reader that sees any of the bytes below sees the region too
+        this->header->Reserved.store(head + skip + size, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        if (skip > 0) {
+            // messages never wrap, too little room for a header is skipped without one
+            if (skip >= sizeof(StreamMessage)) {
+                StreamMessage padding = { skip, STREAM_PADDING, 0, 0, 0 };
+                std::memcpy(this->ring + offset, &padding, sizeof(padding));
+            }
+            head += skip;
+            offset = 0;
+        }
+        std::memcpy(this->ring + offset, data, size);
+        this->header->Head.store(head + size, std::memory_order_release);
+    }
+    if (this->socket >= 0) {
+        sockaddr_un address;
+        socketAddress(this->path.c_str(), address);
+        // no receiver or no room in its queue, either way the game goes on
+        if (sendto(this->socket, data, size, MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != (ssize_t)size)
+            ++this->Dropped;
+    }
+#endif
+}
@@ -0,0 +1,181 @@
+#include "../include/state_stream.h"
+#include "../include/state_codec.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// the reading end links without the game, see tools/stream_viewer.cpp
+
+unsigned int StreamMaxMessage() {
+    return (sizeof(StreamMessage) + StateCodec::MaxBytes(STREAM_MAX_BRICKS) + 7) & ~7u;
+}
+
+#ifndef _WIN32
+static bool socketAddress(const char *path, sockaddr_un &address) {
+    if (std::strlen(path) >= sizeof(address.sun_path))
+        return false;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path);
+    return true;
+}
+#endif
+
+StateStreamReader::StateStreamReader()
+    : Tick(0), Missed(0), Verified(0), header(nullptr), ring(nullptr), mappedBytes(0), position(0), socket(-1), synced(false), stateSize(0)
+{
+    this->message.resize(StreamMaxMessage());
+    this->state.resize(StateCodec::MaxBytes(STREAM_MAX_BRICKS));
+    this->rebuilt.resize(this->state.size());
+}
+
+StateStreamReader::~StateStreamReader() {
+#ifndef _WIN32
+    if (this->header)
+        munmap(const_cast<StreamHeader*>(this->header), this->mappedBytes);
+    if (this->socket >= 0) {
+        close(this->socket);
+        unlink(this->path.c_str());
+    }
+#endif
+}
+
+bool StateStreamReader::OpenSharedMemory(const char *name) {
+#ifdef _WIN32
+    return false;
+#else
+    int file = shm_open(name, O_RDONLY, 0);
+    if (file < 0)
+        return false;
+    struct stat status;
+    void *data = fstat(file, &status) == 0 && (size_t)status.st_size >= sizeof(StreamHeader)
+        ? mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, file, 0) : MAP_FAILED;
+    close(file);
+    if (data == MAP_FAILED)
+        return false;
+    const StreamHeader *header = static_cast<const StreamHeader*>(data);
+    if (std::memcmp(header->Magic, "PSTM", 4) != 0 || header->Version != STREAM_VERSION || header->Capacity % 8 != 0
+        || (size_t)status.st_size < sizeof(StreamHeader) + header->Capacity || header->MaxMessage > header->Capacity / 2) {
+        munmap(data, status.st_size);
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    this->header = header;
+    this->ring = static_cast<const unsigned char*>(data) + sizeof(StreamHeader);
+    this->mappedBytes = status.st_size;
+    this->position = header->Head.load(std::memory_order_acquire);
+    return true;
+#endif
+}
+
+bool StateStreamReader::OpenSocket(const char *path) {
+#ifdef _WIN32
+    return false;
+#else
+    sockaddr_un address;
+    if (!socketAddress(path, address))
+        return false;
+    unlink(path);
+    this->socket = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (this->socket < 0)
+        return false;
+    if (bind(this->socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        close(this->socket);
+        this->socket = -1;
+        return false;
+    }
+    this->path = path;
+    return true;
+#endif
+}
+
+bool StateStreamReader::next() {
+#ifdef _WIN32
+    return false;
+#else
+    if (this->socket >= 0) {
+        ssize_t received = recv(this->socket, this->message.data(), this->message.size(), MSG_DONTWAIT);
+        const StreamMessage *message = reinterpret_cast<const StreamMessage*>(this->message.data());
+        return received >= (ssize_t)sizeof(StreamMessage) && message->PayloadSize <= (size_t)received - sizeof(StreamMessage);
+    }
+    if (!this->header)
+        return false;
+    unsigned int capacity = this->header->Capacity;
+    while (true) {
+        unsigned long long head = this->header->Head.load(std::memory_order_acquire);
+        if (this->position == head)
+            return false;
+        unsigned int offset = this->position % capacity;
+        StreamMessage message;
+        if (capacity - offset >= sizeof(StreamMessage))
+            std::memcpy(&message, this->ring + offset, sizeof(message));
+        else
+            message.Type = STREAM_PADDING, message.Size = capacity - offset;
+        bool fits = message.Size >= sizeof(StreamMessage) || message.Type == STREAM_PADDING;
+        fits = fits && message.Size <= capacity - offset && message.Size <= this->message.size() && message.Size % 8 == 0 && message.Size > 0;
+        if (fits && message.Type != STREAM_PADDING)
+            std::memcpy(this->message.data(), this->ring + offset, message.Size);
+        // whatever was copied counts only if the game has not started writing over it since
+        std::atomic_thread_fence(std::memory_order_acquire);
+        unsigned long long reserved = this->header->Reserved.load(std::memory_order_relaxed);
+        if (reserved - this->position > capacity || !fits) {
+            this->position = this->header->Head.load(std::memory_order_acquire);
+            this->synced = false;
+            continue;
+        }
+        this->position += message.Size;
+        if (message.Type != STREAM_PADDING)
+            return message.PayloadSize <= message.Size - sizeof(StreamMessage);
+    }
+#endif
+}
+
+bool StateStreamReader::apply() {
+    const StreamMessage *message = reinterpret_cast<const StreamMessage*>(this->message.data());
+    const unsigned char *payload = this->message.data() + sizeof(StreamMessage);
+    if (message->Tick != this->Tick + 1)
+        this->synced = false;
+    if (message->Type == STREAM_KEYFRAME_STATE && message->PayloadSize <= this->state.size()) {
+        std::memcpy(this->state.data(), payload, message->PayloadSize);
+        this->stateSize = message->PayloadSize;
+    }
+    else if (message->Type == STREAM_DELTA_STATE && this->synced) {
+        unsigned int size = StateCodec::Apply(this->state.data(), this->stateSize, payload, message->PayloadSize, this->rebuilt.data(), this->rebuilt.size());
+        if (size == 0) {
+            this->synced = false;
+            return false;
+        }
+        std::swap(this->state, this->rebuilt);
+        this->stateSize = size;
+    }
+    else // a delta with nothing to apply it to, wait for the next keyframe
+        return false;
+    if (StateCodec::Checksum(this->state.data(), this->stateSize) != message->Checksum) {
+        this->synced = false;
+        return false;
+    }
+    if (this->Verified > 0 && message->Tick > this->Tick + 1)
+        this->Missed += message->Tick - this->Tick - 1;
+    this->synced = true;
+    this->Tick = message->Tick;
+    ++this->Verified;
+    return true;
+}
+
+bool StateStreamReader::Read(const unsigned char *&state, unsigned int &size) {
+    while (this->next())
+        if (this->apply()) {
+            state = this->state.data();
+            size = this->stateSize;
+            return true;
+        }
+    return false;
+}
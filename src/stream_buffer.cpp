@@ -0,0 +1,153 @@
+#include "../include/stream_buffer.h"
+#include "../include/memory_tracker.h"
+#include "../include/log.h"
+
+// nanoseconds between checks while stalled
+const GLuint64 STREAM_WAIT_TIMEOUT = 1000000000;
+
+static unsigned int align(unsigned int bytes) {
+    return (bytes + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+}
+
+StreamBuffer::StreamBuffer(GLenum target, unsigned int size)
+    : Stats(), target(target), size(size), persistent(nullptr), head(0), frameBegin(0), frameBytes(0), mapped(0),
+      fences(), firstFence(0), fenceCount(0)
+{
+    this->buffer = BufferHandle::Create();
+    glBindBuffer(target, this->buffer);
+#ifdef GL_ARB_buffer_storage
+    if (GLAD_GL_ARB_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, size, NULL, flags);
+        this->persistent = (char*)glMapBufferRange(target, 0, size, flags);
+        if (!this->persistent) {
+            // storage is immutable, fall back on a fresh buffer
+            LOG_WARNING("STREAM_BUFFER", "Persistent mapping failed, mapping per range");
+            this->buffer = BufferHandle::Create();
+            glBindBuffer(target, this->buffer);
+        }
+    }
+#endif
+    if (!this->persistent)
+        glBufferData(target, size, NULL, GL_STREAM_DRAW);
+    glBindBuffer(target, 0);
+    MemoryScope memoryScope(MEMORY_STREAM);
+    MemoryTracker::TrackBuffer(this->buffer, size);
+    MemoryTracker::Label(GLOBJECT_BUFFER, this->buffer, "stream ring");
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (unsigned int i = 0; i < this->fenceCount; ++i)
+        glDeleteSync(this->fences[(this->firstFence + i) % STREAM_MAX_FENCES].Sync);
+}
+
+void *StreamBuffer::Map(unsigned int bytes) {
+    if (this->mapped != 0) {
+        LOG_ERROR("STREAM_BUFFER", "Map while a range is still mapped");
+        return nullptr;
+    }
+    if (align(bytes) > this->size) {
+        LOG_ERROR("STREAM_BUFFER", "Map exceeds the ring", {{ "bytes", bytes }, { "ring", this->size }});
+        return nullptr;
+    }
+    // ranges start aligned, so what a range may take is checked aligned as well
+    unsigned int reserve = align(bytes);
+    this->retire(false);
+    while (!this->fits(reserve)) {
+        // everything older is gone and the frame alone fills the ring, so the
+        // GPU has to finish part of this frame before it can continue
+        if (this->fenceCount == 0) {
+            ++this->Stats.Overflows;
+            this->fence();
+        }
+        ++this->Stats.Stalls;
+        this->retire(true);
+    }
+    if (this->head + reserve > this->size) {
+        // a frame with nothing written yet starts over at the front with its first range
+        if (this->head == this->frameBegin)
+            this->frameBegin = 0;
+        this->head = 0;
+        ++this->Stats.Wraps;
+    }
+    if (this->persistent) {
+        this->mapped = bytes;
+        return this->persistent + this->head;
+    }
+    glBindBuffer(this->target, this->buffer);
+    void *range = glMapBufferRange(this->target, this->head, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+    if (!range) {
+        // nothing is open, the next Map tries again
+        LOG_ERROR("STREAM_BUFFER", "Map failed", {{ "bytes", bytes }, { "offset", this->head }});
+        return nullptr;
+    }
+    this->mapped = bytes;
+    return range;
+}
+
+unsigned int StreamBuffer::Unmap(unsigned int used) {
+    if (used > this->mapped)
+        used = this->mapped;
+    if (!this->persistent) {
+        glBindBuffer(this->target, this->buffer);
+        if (used > 0)
+            glFlushMappedBufferRange(this->target, 0, used);
+        glUnmapBuffer(this->target);
+    }
+    unsigned int offset = this->head;
+    unsigned int advance = align(used);
+    this->head = offset + advance < this->size ? offset + advance : this->size;
+    this->frameBytes += advance;
+    this->mapped = 0;
+    return offset;
+}
+
+void StreamBuffer::EndFrame() {
+    if (this->frameBytes > this->Stats.PeakFrameBytes)
+        this->Stats.PeakFrameBytes = this->frameBytes;
+    this->frameBytes = 0;
+    if (this->head != this->frameBegin)
+        this->fence();
+}
+
+bool StreamBuffer::fits(unsigned int bytes) const {
+    // data still in flight starts at the oldest fenced frame, or this frame
+    unsigned int tail = this->fenceCount > 0 ? this->fences[this->firstFence].Begin : this->frameBegin;
+    bool empty = this->fenceCount == 0 && this->head == this->frameBegin;
+    if (empty)
+        return true;
+    if (this->head >= tail)
+        // room after the head, or at the start in front of the tail
+        return this->head + bytes <= this->size || bytes < tail;
+    return this->head + bytes < tail;
+}
+
+void StreamBuffer::fence() {
+    if (this->fenceCount == STREAM_MAX_FENCES) {
+        ++this->Stats.Stalls;
+        this->retire(true);
+    }
+    Fence &fence = this->fences[(this->firstFence + this->fenceCount) % STREAM_MAX_FENCES];
+    fence.Sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fence.Begin = this->frameBegin;
+    ++this->fenceCount;
+    this->frameBegin = this->head;
+}
+
+void StreamBuffer::retire(bool wait) {
+    while (this->fenceCount > 0) {
+        Fence &fence = this->fences[this->firstFence];
+        GLenum status = glClientWaitSync(fence.Sync, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? STREAM_WAIT_TIMEOUT : 0);
+        while (wait && status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(fence.Sync, GL_SYNC_FLUSH_COMMANDS_BIT, STREAM_WAIT_TIMEOUT);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return;
+        glDeleteSync(fence.Sync);
+        this->firstFence = (this->firstFence + 1) % STREAM_MAX_FENCES;
+        --this->fenceCount;
+        // one retired frame is enough room for a blocking caller to try again
+        if (wait)
+            return;
+    }
+}
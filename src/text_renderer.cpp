@@ -0,0 +1,152 @@
+#include "../include/text_renderer.h"
+#include "../include/memory_tracker.h"
+
+#include <vector>
+
+
+// 5x7 glyphs from the space to the underscore, one byte per row from the top,
+// bit 4 is the leftmost pixel
+static const unsigned char FONT_ROWS[FONT_GLYPHS][FONT_GLYPH_HEIGHT] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // space
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, // !
+    { 0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00 }, // "
+    { 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A }, // #
+    { 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04 }, // $
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // %
+    { 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D }, // &
+    { 0x0C, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00 }, // '
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, // (
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, // )
+    { 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 }, // *
+    { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 }, // +
+    { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 }, // ,
+    { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 }, // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C }, // .
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // /
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, // 0
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E }, // 1
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, // 2
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E }, // 3
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, // 4
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E }, // 5
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, // 6
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // 7
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, // 8
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }, // 9
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, // :
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08 }, // ;
+    { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, // <
+    { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 }, // =
+    { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, // >
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // ?
+    { 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E }, // @
+    { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 }, // A
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, // B
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, // C
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, // D
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, // E
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, // F
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, // G
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // H
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, // I
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C }, // J
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // K
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F }, // L
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, // M
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // N
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // O
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 }, // P
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, // Q
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 }, // R
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, // S
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // T
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // U
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 }, // V
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, // W
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 }, // X
+    { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 }, // Y
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }, // Z
+    { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E }, // [
+    { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 }, // backslash
+    { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E }, // ]
+    { 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00 }, // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F }  // _
+};
+
+TextRenderer::TextRenderer(Shader &shader, StreamBuffer &stream)
+    : sprites(shader, stream)
+{
+    this->initFont();
+    // texture coordinates of a cell and of the glyph inside it
+    shader.Use().SetInteger("image", 0);
+    shader.SetInteger("columns", FONT_COLUMNS);
+    shader.SetVector2f("cellSize", (float)FONT_CELL / this->font.Width, (float)FONT_CELL / this->font.Height);
+    shader.SetVector2f("glyphSize", (float)FONT_GLYPH_WIDTH / this->font.Width, (float)FONT_GLYPH_HEIGHT / this->font.Height);
+}
+
+float TextRenderer::DrawText(const char *text, glm::vec2 position, float scale, glm::vec3 color, float alpha) {
+    glm::vec2 size = glm::vec2(FONT_GLYPH_WIDTH, FONT_GLYPH_HEIGHT) * scale;
+    unsigned int packed = PackColor(color, alpha);
+    for (const char *c = text; *c; ++c) {
+        unsigned char code = *c;
+        if (code >= 'a' && code <= 'z')
+            code -= 'a' - 'A';
+        if (code < FONT_FIRST_CHAR || code >= FONT_FIRST_CHAR + FONT_GLYPHS)
+            code = '?';
+        // spaces only move the pen
+        if (code != ' ') {
+            SpriteInstance *instance = this->sprites.Queue(this->font);
+            if (!instance)
+                break;
+            instance->Position = position;
+            instance->Size = size;
+            instance->Rotation = (float)(code - FONT_FIRST_CHAR);
+            instance->Color = packed;
+        }
+        position.x += FONT_ADVANCE * scale;
+    }
+    return position.x;
+}
+
+void TextRenderer::DrawRect(glm::vec2 position, glm::vec2 size, glm::vec3 color, float alpha) {
+    SpriteInstance *instance = this->sprites.Queue(this->font);
+    if (!instance)
+        return;
+    instance->Position = position;
+    instance->Size = size;
+    instance->Rotation = (float)FONT_SOLID;
+    instance->Color = PackColor(color, alpha);
+}
+
+void TextRenderer::Flush() {
+    this->sprites.Flush();
+}
+
+void TextRenderer::initFont() {
+    // white glyphs on a transparent atlas, the sprite color tints them
+    unsigned int cells = FONT_GLYPHS + 1;
+    unsigned int width = FONT_COLUMNS * FONT_CELL;
+    unsigned int height = (cells + FONT_COLUMNS - 1) / FONT_COLUMNS * FONT_CELL;
+    std::vector<unsigned char> pixels(width * height * 4, 0);
+    for (unsigned int cell = 0; cell < cells; ++cell) {
+        unsigned int left = cell % FONT_COLUMNS * FONT_CELL;
+        unsigned int top = cell / FONT_COLUMNS * FONT_CELL;
+        for (unsigned int y = 0; y < FONT_GLYPH_HEIGHT; ++y)
+            for (unsigned int x = 0; x < FONT_GLYPH_WIDTH; ++x) {
+                bool set = cell == FONT_SOLID || (FONT_ROWS[cell][y] >> (FONT_GLYPH_WIDTH - 1 - x) & 1);
+                unsigned char *pixel = &pixels[((top + y) * width + left + x) * 4];
+                pixel[0] = pixel[1] = pixel[2] = 255;
+                pixel[3] = set ? 255 : 0;
+            }
+    }
+    // sharp pixels at any scale, and the empty cell border keeps neighbours out
+    this->font.Internal_Format = GL_RGBA;
+    this->font.Image_Format = GL_RGBA;
+    this->font.Wrap_S = GL_CLAMP_TO_EDGE;
+    this->font.Wrap_T = GL_CLAMP_TO_EDGE;
+    this->font.Filter_Min = GL_NEAREST;
+    this->font.Filter_Max = GL_NEAREST;
+    MemoryScope memoryScope(MEMORY_TEXT);
+    this->font.Generate(width, height, pixels.data());
+    MemoryTracker::Label(GLOBJECT_TEXTURE, this->font.ID, "font");
+}
@@ -0,0 +1,189 @@
+#include "../include/timer_wheel.h"
+
+#include <cmath>
+
+const unsigned int NO_NODE = 0xFFFFFFFF;
+
+TimerWheel::TimerWheel(unsigned int capacity)
+    : capacity(capacity), freeList(NO_NODE), active(0), currentTick(0), elapsed(0.0), dispatching(false)
+{
+    this->nodes.resize(capacity + TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS + 1);
+    for (unsigned int i = 0; i < capacity; ++i)
+        this->nodes[i].Generation = 1;
+    this->Clear();
+}
+
+unsigned int TimerWheel::sentinel(unsigned int level, unsigned int slot) const {
+    return this->capacity + level * TIMER_WHEEL_SLOTS + slot;
+}
+
+unsigned int TimerWheel::firingList() const {
+    return this->capacity + TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS;
+}
+
+void TimerWheel::Clear() {
+    // sentinels point to themselves, every timer goes back on the free list
+    for (unsigned int i = this->capacity; i < this->nodes.size(); ++i)
+        this->nodes[i].Prev = this->nodes[i].Next = i;
+    this->freeList = NO_NODE;
+    for (unsigned int i = this->capacity; i > 0; --i) {
+        Node &node = this->nodes[i - 1];
+        if (node.Callback)
+            ++node.Generation; // invalidate outstanding ids
+        node.Callback = nullptr;
+        node.Next = this->freeList;
+        this->freeList = i - 1;
+    }
+    this->active = 0;
+}
+
+TimerId TimerWheel::Schedule(float delay, TimerCallback callback, void *context, unsigned int data) {
+    // first tick at or after the deadline
+    double ticks = std::ceil((this->elapsed + (delay > 0.0f ? delay : 0.0f)) / TIMER_TICK);
+    return this->ScheduleAt(static_cast<unsigned long long>(ticks), callback, context, data);
+}
+
+TimerId TimerWheel::ScheduleAt(unsigned long long tick, TimerCallback callback, void *context, unsigned int data) {
+    if (this->freeList == NO_NODE)
+        return NO_TIMER;
+    unsigned int index = this->freeList;
+    Node &node = this->nodes[index];
+    this->freeList = node.Next;
+
+    node.Expires = tick;
+    node.Callback = callback;
+    node.Context = context;
+    node.Data = data;
+    this->insert(index);
+    ++this->active;
+    return (node.Generation << 16) | (index + 1);
+}
+
+bool TimerWheel::Pending(unsigned int slot, PendingTimer &timer) const {
+    const Node &node = this->nodes[slot];
+    if (!node.Callback)
+        return false;
+    timer.Expires = node.Expires;
+    timer.Callback = node.Callback;
+    timer.Context = node.Context;
+    timer.Data = node.Data;
+    return true;
+}
+
+void TimerWheel::Reset(double elapsed, unsigned long long tick) {
+    this->Clear();
+    this->elapsed = elapsed;
+    this->currentTick = tick;
+}
+
+bool TimerWheel::IsActive(TimerId timer) const {
+    unsigned int index = (timer & 0xFFFF) - 1;
+    if (timer == NO_TIMER || index >= this->capacity)
+        return false;
+    const Node &node = this->nodes[index];
+    return node.Callback && (node.Generation & 0xFFFF) == (timer >> 16);
+}
+
+bool TimerWheel::Cancel(TimerId timer) {
+    if (!this->IsActive(timer))
+        return false;
+    unsigned int index = (timer & 0xFFFF) - 1;
+    this->unlink(index);
+    this->release(index);
+    return true;
+}
+
+void TimerWheel::Advance(float dt) {
+    this->elapsed += dt;
+    unsigned long long target = static_cast<unsigned long long>(std::floor(this->elapsed / TIMER_TICK));
+    while (this->currentTick <= target) {
+        unsigned int slot = this->currentTick & (TIMER_WHEEL_SLOTS - 1);
+        // entering a new block of the finest wheel, pull the next block down from the coarser ones
+        if (slot == 0)
+            this->cascade(1);
+
+        // detach the due slot first, callbacks may schedule or cancel timers
+        unsigned int due = this->sentinel(0, slot), firing = this->firingList();
+        if (this->nodes[due].Next != due) {
+            this->nodes[firing].Next = this->nodes[due].Next;
+            this->nodes[firing].Prev = this->nodes[due].Prev;
+            this->nodes[this->nodes[firing].Next].Prev = firing;
+            this->nodes[this->nodes[firing].Prev].Next = firing;
+            this->nodes[due].Next = this->nodes[due].Prev = due;
+            this->dispatching = true;
+            while (this->nodes[firing].Next != firing) {
+                unsigned int index = this->nodes[firing].Next;
+                Node &node = this->nodes[index];
+                TimerCallback callback = node.Callback;
+                void *context = node.Context;
+                unsigned int data = node.Data;
+                this->unlink(index);
+                this->release(index);
+                callback(context, data);
+            }
+            this->dispatching = false;
+        }
+        ++this->currentTick;
+    }
+}
+
+void TimerWheel::cascade(unsigned int level) {
+    if (level >= TIMER_WHEEL_LEVELS)
+        return;
+    unsigned int slot = (this->currentTick >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    // the coarser wheel only needs to cascade when this one wraps too
+    if (slot == 0)
+        this->cascade(level + 1);
+    unsigned int list = this->sentinel(level, slot);
+    while (this->nodes[list].Next != list) {
+        unsigned int index = this->nodes[list].Next;
+        this->unlink(index);
+        this->insert(index);
+    }
+}
+
+void TimerWheel::insert(unsigned int index) {
+    Node &node = this->nodes[index];
+    if (node.Expires < this->currentTick)
+        node.Expires = this->currentTick;
+    // the slot for this tick is already detached, a timer due now joins the timers firing
+    if (this->dispatching && node.Expires == this->currentTick) {
+        this->link(this->firingList(), index);
+        return;
+    }
+    unsigned long long delta = node.Expires - this->currentTick;
+    unsigned int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ull << (TIMER_WHEEL_BITS * (level + 1))))
+        ++level;
+    if (level == TIMER_WHEEL_LEVELS - 1 && delta >= (1ull << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))) {
+        // out of range, fire as late as the wheel can represent
+        node.Expires = this->currentTick + (1ull << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    }
+    unsigned int slot = (node.Expires >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    this->link(this->sentinel(level, slot), index);
+}
+
+void TimerWheel::link(unsigned int list, unsigned int index) {
+    // append, timers due on the same tick fire in scheduling order
+    Node &node = this->nodes[index];
+    node.Prev = this->nodes[list].Prev;
+    node.Next = list;
+    this->nodes[node.Prev].Next = index;
+    this->nodes[list].Prev = index;
+}
+
+void TimerWheel::unlink(unsigned int index) {
+    Node &node = this->nodes[index];
+    this->nodes[node.Prev].Next = node.Next;
+    this->nodes[node.Next].Prev = node.Prev;
+    node.Prev = node.Next = index;
+}
+
+void TimerWheel::release(unsigned int index) {
+    Node &node = this->nodes[index];
+    node.Callback = nullptr;
+    ++node.Generation;
+    node.Next = this->freeList;
+    this->freeList = index;
+    --this->active;
+}
@@ -0,0 +1,74 @@
+#include "../include/worker_pool.h"
+
+#include <algorithm>
+
+const unsigned int MAX_WORKERS = 7;
+
+WorkerPool::WorkerPool(unsigned int threads)
+    : job(nullptr), context(nullptr), count(0), grain(1), next(0), pending(0), generation(0), quit(false)
+{
+    if (threads == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threads = std::min(hardware > 1 ? hardware - 1 : 0, MAX_WORKERS);
+    }
+    for (unsigned int i = 0; i < threads; ++i)
+        this->workers.push_back(std::thread(&WorkerPool::run, this));
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->quit = true;
+    }
+    this->wake.notify_all();
+    for (std::thread &worker : this->workers)
+        worker.join();
+}
+
+void WorkerPool::ParallelFor(unsigned int count, unsigned int grain, WorkerJob job, void *context) {
+    grain = std::max(grain, 1u);
+    if (this->workers.empty() || count <= grain) {
+        job(context, 0, count);
+        return;
+    }
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->job = job;
+    this->context = context;
+    this->count = count;
+    this->grain = grain;
+    this->next.store(0);
+    this->pending = this->workers.size();
+    ++this->generation;
+    lock.unlock();
+    this->wake.notify_all();
+    this->work();
+    // every worker checks in, even one that woke after the last chunk was taken,
+    // so none of them can still be reading this range when the next one starts
+    lock.lock();
+    this->done.wait(lock, [this] { return this->pending == 0; });
+}
+
+void WorkerPool::run() {
+    unsigned long long seen = 0;
+    std::unique_lock<std::mutex> lock(this->mutex);
+    for (;;) {
+        this->wake.wait(lock, [this, &seen] { return this->quit || this->generation != seen; });
+        if (this->quit)
+            return;
+        seen = this->generation;
+        lock.unlock();
+        this->work();
+        lock.lock();
+        if (--this->pending == 0)
+            this->done.notify_one();
+    }
+}
+
+void WorkerPool::work() {
+    for (;;) {
+        unsigned int begin = this->next.fetch_add(this->grain);
+        if (begin >= this->count)
+            return;
+        this->job(this->context, begin, std::min(begin + this->grain, this->count));
+    }
+}
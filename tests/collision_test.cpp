@@ -0,0 +1,168 @@
+// Checks the batched CollideCircleBoxes against CollideCircleBoxesScalar and
+// both against the CheckCollision and VectorDirection the game used before
+// the kernel, copied here as they were, over random boxes and circles.
+// The kernels must agree exactly; the old code takes a square root and
+// normalizes, so circles that only just touch a box or differences that lie
+// on a diagonal are left out of that comparison.
+// Exits with 1 on the first mismatch.
+// Build with the game's include paths and: g++ -std=c++17 -O2 -Iinclude tests/collision_test.cpp
+//     src/collision.cpp -o collision_test
+#include "../include/collision.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const unsigned int ROUNDS    = 2000;
+const unsigned int MAX_BOXES = 300;
+const unsigned int CIRCLES   = 50; // per round
+const float        WORLD     = 800.0f;
+const float        EDGE      = 1.0e-3f; // how close to touching is left to rounding
+
+static float uniform(float low, float high) {
+    return low + (high - low) * (float)std::rand() / RAND_MAX;
+}
+
+// the original, on a box given by position and size instead of a GameObject
+static Direction VectorDirection(glm::vec2 target) {
+    glm::vec2 compass[] = {
+        glm::vec2(0.0f, 1.0f),	// up
+        glm::vec2(1.0f, 0.0f),	// right
+        glm::vec2(0.0f, -1.0f),	// down
+        glm::vec2(-1.0f, 0.0f)	// left
+    };
+    float max = 0.0f;
+    unsigned int best_match = -1;
+    for (unsigned int i = 0; i < 4; ++i) {
+        float dot_product = glm::dot(glm::normalize(target), compass[i]);
+        if (dot_product > max) {
+            max = dot_product;
+            best_match = i;
+        }
+    }
+
+    return (Direction)best_match;
+}
+
+static Collision CheckCollision(glm::vec2 center, float radius, glm::vec2 position, glm::vec2 size) {
+    glm::vec2 aabb_half_extents(size.x / 2.0f, size.y / 2.0f);
+    glm::vec2 aabb_center(
+            position.x + aabb_half_extents.x,
+            position.y + aabb_half_extents.y
+    );
+    glm::vec2 difference = center - aabb_center;
+    glm::vec2 clamped = glm::clamp(difference, -aabb_half_extents, aabb_half_extents);
+    glm::vec2 closest = aabb_center + clamped;
+    difference = closest - center;
+
+    if (glm::length(difference) <= radius)
+        return std::make_tuple(true, VectorDirection(difference), difference);
+    else
+        return std::make_tuple(false, UP, glm::vec2(0.0f, 0.0f));
+}
+
+// distance from the circle's edge to the box, for leaving out near touches
+static float clearance(glm::vec2 center, float radius, glm::vec2 position, glm::vec2 size) {
+    glm::vec2 closest = glm::clamp(center, position, position + size);
+    return std::abs(glm::length(closest - center) - radius);
+}
+
+static bool onDiagonal(glm::vec2 difference) {
+    float x = std::abs(difference.x), y = std::abs(difference.y);
+    return std::abs(x - y) <= EDGE * std::max(x, y);
+}
+
+// every hit from first on, in calls of at most maxHits
+static std::vector<unsigned int> collect(bool batched, const BoxBounds &bounds, glm::vec2 center, float radius, unsigned int maxHits, unsigned int first) {
+    std::vector<unsigned int> hits, chunk(maxHits);
+    for (;;) {
+        unsigned int count = batched ? CollideCircleBoxes(bounds, center, radius, chunk.data(), maxHits, first)
+                                     : CollideCircleBoxesScalar(bounds, center, radius, chunk.data(), maxHits, first);
+        hits.insert(hits.end(), chunk.begin(), chunk.begin() + count);
+        if (count < maxHits)
+            return hits;
+        first = chunk[count - 1] + 1;
+    }
+}
+
+int main() {
+    std::srand(30);
+    unsigned long long tests = 0, hits = 0, compared = 0;
+    for (unsigned int round = 0; round < ROUNDS; ++round) {
+        unsigned int count = std::rand() % (MAX_BOXES + 1);
+        std::vector<glm::vec2> positions(count), sizes(count);
+        std::vector<bool> disabled(count);
+        BoxBounds bounds;
+        for (unsigned int box = 0; box < count; ++box) {
+            positions[box] = glm::vec2(uniform(0.0f, WORLD), uniform(0.0f, WORLD));
+            sizes[box] = glm::vec2(uniform(1.0f, 120.0f), uniform(1.0f, 60.0f));
+            bounds.Add(positions[box], sizes[box]);
+            if (std::rand() % 8 == 0) {
+                disabled[box] = true;
+                bounds.Disable(box);
+            }
+        }
+        for (unsigned int circle = 0; circle < CIRCLES; ++circle, ++tests) {
+            glm::vec2 center(uniform(-50.0f, WORLD + 50.0f), uniform(-50.0f, WORLD + 50.0f));
+            float radius = uniform(0.5f, 80.0f);
+            unsigned int maxHits = 1 + std::rand() % 16;
+            unsigned int first = count > 0 && std::rand() % 4 == 0 ? std::rand() % count : 0;
+
+            std::vector<unsigned int> batched = collect(true, bounds, center, radius, maxHits, first);
+            std::vector<unsigned int> scalar = collect(false, bounds, center, radius, maxHits, first);
+            if (batched != scalar) {
+                std::printf("round %u circle %u: CollideCircleBoxes found %zu boxes, the scalar kernel %zu\n",
+                            round, circle, batched.size(), scalar.size());
+                return 1;
+            }
+            hits += batched.size();
+
+            unsigned int next = 0;
+            for (unsigned int box = first; box < count; ++box) {
+                bool found = next < batched.size() && batched[next] == box;
+                if (found)
+                    ++next;
+                if (disabled[box]) {
+                    if (found) {
+                        std::printf("round %u circle %u: disabled box %u was hit\n", round, circle, box);
+                        return 1;
+                    }
+                    continue;
+                }
+                if (clearance(center, radius, positions[box], sizes[box]) <= EDGE)
+                    continue;
+                Collision original = CheckCollision(center, radius, positions[box], sizes[box]);
+                Collision single = CollideCircleAABB(center, radius, positions[box], positions[box] + sizes[box]);
+                ++compared;
+                if (found != std::get<0>(original) || std::get<0>(single) != std::get<0>(original)) {
+                    std::printf("round %u circle %u box %u: CheckCollision %d, CollideCircleBoxes %d, CollideCircleAABB %d\n",
+                                round, circle, box, (int)std::get<0>(original), (int)found, (int)std::get<0>(single));
+                    return 1;
+                }
+                if (!found)
+                    continue;
+                glm::vec2 difference = std::get<2>(original);
+                if (glm::length(std::get<2>(single) - difference) > EDGE) {
+                    std::printf("round %u circle %u box %u: difference (%g, %g) against (%g, %g)\n", round, circle, box,
+                                std::get<2>(single).x, std::get<2>(single).y, difference.x, difference.y);
+                    return 1;
+                }
+                // a center inside the box has no direction in the original
+                if (difference == glm::vec2(0.0f) || onDiagonal(difference))
+                    continue;
+                if (std::get<1>(single) != std::get<1>(original) || SignDirection(difference) != VectorDirection(difference)) {
+                    std::printf("round %u circle %u box %u: direction %d, VectorDirection %d\n", round, circle, box,
+                                (int)std::get<1>(single), (int)std::get<1>(original));
+                    return 1;
+                }
+            }
+            if (next != batched.size()) {
+                std::printf("round %u circle %u: hit %u is outside the boxes tested\n", round, circle, batched[next]);
+                return 1;
+            }
+        }
+    }
+    std::printf("%llu circles match, %llu hits, %llu box tests against CheckCollision\n", tests, hits, compared);
+    return 0;
+}
@@ -0,0 +1,181 @@
+// Runs the particle pool on the CPU and with the transform feedback update
+// shader from the same seed, with the same emitters, bursts and culling, and
+// compares the two pools after every step. The GPU pool is read back with
+// glGetBufferSubData. Needs a GL 3.3 core context, llvmpipe is enough:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run tests/particle_gpu_test [root]
+//
+// root holds shaders/, the working directory by default. Exits with 1 if a
+// particle differs by more than TOLERANCE or there is no context.
+// Build with the game's include paths and libraries and: g++ -std=c++17 -O2 -Iinclude
+//     tests/particle_gpu_test.cpp src/particle_generator.cpp src/resource_manager.cpp src/shader.cpp
+//     src/texture2D.cpp src/asset_pack.cpp src/gl_backend.cpp src/memory_tracker.cpp src/log.cpp
+//     -lglfw -o particle_gpu_test
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "../include/particle_generator.h"
+#include "../include/resource_manager.h"
+#include "../include/asset_pack.h"
+#include "../include/gl_backend.h"
+#include "../include/log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const unsigned int SEED      = 26;
+const unsigned int STEPS     = 600;
+const unsigned int POOL      = 600; // small enough that the pool fills and culls
+const float        STEP      = 1.0f / 60.0f;
+const float        TOLERANCE = 1.0e-3f; // relative, the GPU may round a little differently
+
+struct Scene {
+    unsigned int Trail, Shatter, Sparks;
+};
+
+static Scene addEmitters(ParticleGenerator &particles) {
+    Scene scene;
+    EmitterDesc trail;
+    trail.Rate = 400.0f;
+    trail.Budget = 800;
+    trail.Priority = 1;
+    trail.LifeMin = 0.3f;
+    trail.LifeMax = 0.9f;
+    trail.SpeedMax = 40.0f;
+    trail.Inherit = -0.2f;
+    trail.Jitter = 4.0f;
+    trail.BrightMin = 0.5f;
+    trail.Fade = 2.0f;
+    scene.Trail = particles.AddEmitter(trail);
+
+    EmitterDesc shatter;
+    shatter.Budget = 1000;
+    shatter.Priority = 2;
+    shatter.LifeMin = 0.5f;
+    shatter.LifeMax = 1.5f;
+    shatter.SpeedMin = 60.0f;
+    shatter.SpeedMax = 240.0f;
+    shatter.Color = glm::vec3(1.0f, 0.6f, 0.2f);
+    scene.Shatter = particles.AddEmitter(shatter);
+
+    EmitterDesc sparks;
+    sparks.Budget = 300;
+    sparks.Priority = 1;
+    sparks.LifeMin = 0.1f;
+    sparks.LifeMax = 0.4f;
+    sparks.SpeedMin = 100.0f;
+    sparks.SpeedMax = 200.0f;
+    sparks.Direction = glm::vec2(0.0f, -1.0f);
+    sparks.Spread = 45.0f;
+    scene.Sparks = particles.AddEmitter(sparks);
+    return scene;
+}
+
+// the same frames for both pools, the generator draws from rand() for the rest
+static void step(ParticleGenerator &particles, const Scene &scene, unsigned int frame) {
+    float time = frame * STEP;
+    glm::vec2 ball(640.0f + 300.0f * std::cos(time * 2.0f), 360.0f + 200.0f * std::sin(time * 3.0f));
+    glm::vec2 velocity(-600.0f * std::sin(time * 2.0f), 600.0f * std::cos(time * 3.0f));
+    particles.Emit(scene.Trail, STEP, ball, velocity);
+    if (frame % 20 == 0)
+        particles.Burst(scene.Shatter, 150, glm::vec2(100.0f + frame, 200.0f), glm::vec2(0.0f), glm::vec3(0.8f, 1.0f, 0.9f));
+    if (frame % 7 == 0)
+        particles.Burst(scene.Sparks, 25, glm::vec2(640.0f, 700.0f));
+    particles.Update(STEP);
+}
+
+static bool close(float a, float b) {
+    return std::abs(a - b) <= TOLERANCE * std::max(1.0f, std::max(std::abs(a), std::abs(b)));
+}
+
+static bool same(const Particle &a, const Particle &b) {
+    return close(a.Position.x, b.Position.x) && close(a.Position.y, b.Position.y)
+        && close(a.Velocity.x, b.Velocity.x) && close(a.Velocity.y, b.Velocity.y)
+        && close(a.Color.r, b.Color.r) && close(a.Color.g, b.Color.g) && close(a.Color.b, b.Color.b) && close(a.Color.a, b.Color.a)
+        && close(a.Life, b.Life) && close(a.Fade, b.Fade);
+}
+
+// every step of one pool, read back after each
+static std::vector<std::vector<Particle>> simulate(ParticleGenerator &particles) {
+    Scene scene = addEmitters(particles);
+    std::vector<std::vector<Particle>> steps(STEPS);
+    std::srand(SEED);
+    for (unsigned int frame = 0; frame < STEPS; ++frame) {
+        step(particles, scene, frame);
+        particles.ReadBack(steps[frame]);
+    }
+    return steps;
+}
+
+int main(int argc, char *argv[]) {
+    AssetPack::SetRoot(argc > 1 ? std::string(argv[1]) + "/" : std::string());
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, false);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "particle_gpu_test", nullptr, nullptr);
+    if (!window) {
+        std::printf("no GL 3.3 context\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!GLBackend::UseGLAD((GLADloadproc)glfwGetProcAddress)) {
+        std::printf("failed to load GL\n");
+        glfwTerminate();
+        return 1;
+    }
+    std::printf("%s\n", (const char*)glGetString(GL_RENDERER));
+
+    Shader &draw = ResourceManager::LoadShader("shaders/particle_trail_A_gpu.vs", "shaders/particle_trail_A.fs", nullptr, "pTrailA_gpu");
+    const char *varyings[] = { "outPosition", "outVelocity", "outColor", "outLife", "outFade" };
+    Shader &update = ResourceManager::LoadFeedbackShader("shaders/particle_update.vs", varyings, 5, "pUpdate");
+    if (!update.IsLinked()) {
+        std::printf("the update shader did not link\n");
+        glfwTerminate();
+        return 1;
+    }
+    int result = 0;
+    {
+        Texture2D texture; // never drawn
+        ParticleGenerator cpu(draw, texture, POOL);
+        ParticleGenerator gpu(draw, update, texture, POOL);
+        std::vector<std::vector<Particle>> expected = simulate(cpu);
+        std::vector<std::vector<Particle>> actual = simulate(gpu);
+
+        unsigned int live = 0, peak = 0;
+        for (unsigned int frame = 0; frame < STEPS && result == 0; ++frame) {
+            unsigned int alive = 0;
+            for (unsigned int slot = 0; slot < POOL; ++slot) {
+                const Particle &a = expected[frame][slot], &b = actual[frame][slot];
+                alive += a.Life > 0.0f;
+                if (!same(a, b)) {
+                    std::printf("step %u slot %u: CPU at (%g, %g) alpha %g life %g, GPU at (%g, %g) alpha %g life %g\n", frame, slot,
+                                a.Position.x, a.Position.y, a.Color.a, a.Life, b.Position.x, b.Position.y, b.Color.a, b.Life);
+                    result = 1;
+                    break;
+                }
+            }
+            live += alive;
+            peak = std::max(peak, alive);
+        }
+        if (cpu.LiveCount() != gpu.LiveCount()) {
+            std::printf("CPU pool has %u live particles, GPU pool %u\n", cpu.LiveCount(), gpu.LiveCount());
+            result = 1;
+        }
+        if (result == 0)
+            std::printf("%u steps match, %u particles alive on average, %u at most\n", STEPS, live / STEPS, peak);
+    }
+    ResourceManager::Clear();
+    Log::Flush();
+    glfwTerminate();
+    return result;
+}
@@ -0,0 +1,229 @@
+// Checks SweepCircleAABB's time of impact against stepping the circle along
+// its motion in small steps with CollideCircleAABB and bisecting the first
+// step that overlaps, for random approaches, paths that just graze or just
+// clip a corner, and circles that start inside the box. Then checks
+// SweepCircleBoxes against testing every box one by one, for sweeps whose
+// broad phase circle holds many more boxes than one batch of the kernel.
+// Exits with 1 on the first sweep that misses, hits where the reference does
+// not, or picks a different box or time.
+// Build with the game's include paths and: g++ -std=c++17 -O2 -Iinclude tests/sweep_test.cpp
+//     src/collision.cpp -o sweep_test
+#include "../include/collision.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const unsigned int GRID    = 40;    // boxes a side
+const float        CELL    = 12.0f; // box size and gap
+const float        GAP     = 1.0f;
+const unsigned int SWEEPS  = 20000;
+const unsigned int IMPACTS = 20000; // per kind of case
+const unsigned int STEPS   = 4096;  // of the reference along one motion
+// At a grazing contact a tiny difference in distance moves the impact far along
+// the path, so the sweep's impact must touch the box closely but need only be
+// near the reference's along the motion. In world units.
+const float        DEPTH   = 1.0e-3f;
+const float        REACH   = 5.0e-2f;
+const float        GRAZE   = 1.0e-4f; // overlaps shallower than this are rounding
+
+static std::vector<bool> skipped;
+
+static bool notSkipped(void *, unsigned int box) {
+    return !skipped[box];
+}
+
+static float uniform(float low, float high) {
+    return low + (high - low) * (float)std::rand() / RAND_MAX;
+}
+
+static bool overlaps(glm::vec2 center, float radius, glm::vec2 min, glm::vec2 max) {
+    return std::get<0>(CollideCircleAABB(center, radius, min, max));
+}
+
+// distance from the box, negative and the depth to the nearest side when the centre is inside
+static float signedDistance(glm::vec2 center, glm::vec2 min, glm::vec2 max) {
+    glm::vec2 closest = glm::clamp(center, min, max);
+    if (closest != center)
+        return glm::length(center - closest);
+    return -std::min(std::min(center.x - min.x, max.x - center.x), std::min(center.y - min.y, max.y - center.y));
+}
+
+// The reference: 0 for a circle that starts overlapping and moves deeper, else
+// the first of STEPS steps that overlaps, bisected down to the moment of contact.
+// Returns 1 for a miss, or -1 when the circle comes within a step of touching
+// or overlaps by less than rounding, or moves out along the surface, which the
+// steps cannot settle.
+static float stepImpact(glm::vec2 center, float radius, glm::vec2 motion, glm::vec2 min, glm::vec2 max) {
+    float length = glm::length(motion);
+    if (overlaps(center, radius, min, max)) {
+        float nudge = 1.0e-3f / length;
+        float before = signedDistance(center, min, max), after = signedDistance(center + motion * nudge, min, max);
+        if (std::abs(after - before) < 1.0e-5f)
+            return -1.0f;
+        return after < before ? 0.0f : 1.0f;
+    }
+    unsigned int first = 0;
+    float nearest = 1e30f;
+    for (unsigned int step = 1; step <= STEPS; ++step) {
+        glm::vec2 position = center + motion * ((float)step / STEPS);
+        if (first == 0 && overlaps(position, radius, min, max))
+            first = step;
+        nearest = std::min(nearest, signedDistance(position, min, max) - radius);
+    }
+    if (first == 0)
+        return nearest > length / STEPS ? 1.0f : -1.0f;
+    if (nearest > -GRAZE)
+        return -1.0f;
+    float lo = (float)(first - 1) / STEPS, hi = (float)first / STEPS;
+    for (unsigned int i = 0; i < 40; ++i) {
+        float mid = 0.5f * (lo + hi);
+        if (overlaps(center + motion * mid, radius, min, max))
+            hi = mid;
+        else
+            lo = mid;
+    }
+    return hi;
+}
+
+static unsigned int ambiguous = 0;
+static float        worst     = 0.0f;
+
+static bool checkImpact(const char *what, unsigned int test, glm::vec2 center, float radius, glm::vec2 motion, glm::vec2 min, glm::vec2 max) {
+    float expected = stepImpact(center, radius, motion, min, max);
+    if (expected < 0.0f) {
+        ++ambiguous;
+        return true;
+    }
+    float time = 1.0f;
+    glm::vec2 normal(0.0f);
+    bool hit = SweepCircleAABB(center, radius, motion, min, max, time, normal);
+    float error = 0.0f, gap = 0.0f;
+    if (hit) {
+        error = std::abs(time - expected) * glm::length(motion);
+        if (time > 0.0f)
+            gap = std::abs(signedDistance(center + motion * time, min, max) - radius);
+    }
+    if (hit != (expected < 1.0f) || error > REACH || gap > DEPTH) {
+        std::printf("FAILED: %s %u: circle at (%.9g, %.9g) radius %.9g moving (%.9g, %.9g) against (%.9g, %.9g)-(%.9g, %.9g) ", what, test,
+                    center.x, center.y, radius, motion.x, motion.y, min.x, min.y, max.x, max.y);
+        if (hit)
+            std::printf("hit at %g %g off the surface, ", time, gap);
+        else
+            std::printf("missed, ");
+        if (expected < 1.0f)
+            std::printf("the steps hit at %g\n", expected);
+        else
+            std::printf("the steps missed\n");
+        return false;
+    }
+    worst = std::max(worst, gap);
+    return true;
+}
+
+static bool impacts() {
+    for (unsigned int test = 0; test < IMPACTS; ++test) {
+        glm::vec2 min(uniform(-100.0f, 100.0f), uniform(-100.0f, 100.0f));
+        glm::vec2 max = min + glm::vec2(uniform(1.0f, 80.0f), uniform(1.0f, 80.0f));
+        float radius = uniform(0.5f, 30.0f);
+
+        // from anywhere around the box towards somewhere near it
+        glm::vec2 center(uniform(-250.0f, 250.0f), uniform(-250.0f, 250.0f));
+        glm::vec2 target(uniform(min.x - 40.0f, max.x + 40.0f), uniform(min.y - 40.0f, max.y + 40.0f));
+        if (!checkImpact("approach", test, center, radius, (target - center) * uniform(0.5f, 1.5f), min, max))
+            return false;
+
+        // past a corner, tangent to the grown box's rounded corner give or take a little
+        float angle = uniform(0.05f, 1.52f);
+        glm::vec2 out(std::cos(angle), std::sin(angle));
+        glm::vec2 corner = max;
+        if (std::rand() % 2) {
+            out.x = -out.x;
+            corner.x = min.x;
+        }
+        if (std::rand() % 2) {
+            out.y = -out.y;
+            corner.y = min.y;
+        }
+        float miss = std::rand() % 2 ? uniform(-0.05f, 0.05f) : uniform(-1.0e-3f, 1.0e-3f);
+        glm::vec2 along(-out.y, out.x);
+        if (std::rand() % 2)
+            along = -along;
+        float reach = uniform(5.0f, 150.0f);
+        glm::vec2 closest = corner + out * (radius + miss);
+        if (!checkImpact("graze", test, closest - along * reach, radius, along * reach * uniform(1.0f, 2.0f), min, max))
+            return false;
+
+        // starting inside the box or overlapping an edge, in any direction
+        glm::vec2 inside(uniform(min.x - radius * 0.7f, max.x + radius * 0.7f), uniform(min.y - radius * 0.7f, max.y + radius * 0.7f));
+        glm::vec2 motion(uniform(-100.0f, 100.0f), uniform(-100.0f, 100.0f));
+        if (!checkImpact("inside", test, inside, radius, motion, min, max))
+            return false;
+    }
+    std::printf("%u impacts match the steps, at most %g off the surface, %u too close to call\n", 3 * IMPACTS, worst, ambiguous);
+    return true;
+}
+
+// the earliest hit the slow way, ties to the lower box like SweepCircleBoxes
+static unsigned int bruteForce(const BoxBounds &bounds, glm::vec2 center, float radius, glm::vec2 motion, float &time, glm::vec2 &normal) {
+    unsigned int hit = NO_BOX;
+    for (unsigned int box = 0; box < bounds.Count; ++box) {
+        float t;
+        glm::vec2 n;
+        if (!skipped[box] && SweepCircleAABB(center, radius, motion, glm::vec2(bounds.MinX[box], bounds.MinY[box]),
+                                             glm::vec2(bounds.MaxX[box], bounds.MaxY[box]), t, n) && t < time) {
+            time = t;
+            normal = n;
+            hit = box;
+        }
+    }
+    return hit;
+}
+
+int main() {
+    std::srand(35);
+    if (!impacts())
+        return 1;
+
+    BoxBounds bounds;
+    for (unsigned int y = 0; y < GRID; ++y)
+        for (unsigned int x = 0; x < GRID; ++x)
+            bounds.Add(glm::vec2(x * CELL, y * CELL), glm::vec2(CELL - GAP));
+    skipped.assign(bounds.Count, false);
+
+    // straight through the middle row from the left: its first box is far past the first batch
+    float time = 1.0f;
+    glm::vec2 normal(0.0f);
+    unsigned int row = GRID / 2;
+    unsigned int hit = SweepCircleBoxes(bounds, glm::vec2(-50.0f, row * CELL + CELL * 0.5f), 4.0f, glm::vec2(GRID * CELL + 100.0f, 0.0f),
+                                        nullptr, nullptr, time, normal);
+    if (hit != row * GRID) {
+        std::printf("FAILED: a sweep along row %u hit box %d instead of %u\n", row, (int)hit, row * GRID);
+        return 1;
+    }
+
+    unsigned int crowded = 0;
+    std::vector<unsigned int> hits(bounds.Count);
+    for (unsigned int sweep = 0; sweep < SWEEPS; ++sweep) {
+        for (unsigned int box = 0; box < bounds.Count; ++box)
+            skipped[box] = std::rand() % 4 == 0;
+        float size = GRID * CELL;
+        glm::vec2 center(uniform(-20.0f, size + 20.0f), uniform(-20.0f, size + 20.0f));
+        glm::vec2 motion(uniform(-size, size), uniform(-size, size));
+        float radius = uniform(1.0f, 20.0f);
+        crowded += CollideCircleBoxesScalar(bounds, center + motion * 0.5f, radius + glm::length(motion) * 0.5f, hits.data(), bounds.Count) > SWEEP_BATCH;
+
+        float expectedTime = 1.0f, actualTime = 1.0f;
+        glm::vec2 expectedNormal(0.0f), actualNormal(0.0f);
+        unsigned int expected = bruteForce(bounds, center, radius, motion, expectedTime, expectedNormal);
+        unsigned int actual = SweepCircleBoxes(bounds, center, radius, motion, notSkipped, nullptr, actualTime, actualNormal);
+        if (actual != expected || actualTime != expectedTime || actualNormal != expectedNormal) {
+            std::printf("FAILED: sweep %u from (%g, %g) by (%g, %g) radius %g hit box %d at %g, expected %d at %g\n", sweep,
+                        center.x, center.y, motion.x, motion.y, radius, (int)actual, actualTime, (int)expected, expectedTime);
+            return 1;
+        }
+    }
+    std::printf("%u sweeps match, %u with more than %u boxes in the broad phase\n", SWEEPS, crowded, SWEEP_BATCH);
+    return 0;
+}
@@ -0,0 +1,157 @@
+// Checks that TimerWheel fires every timer on the tick it was scheduled for:
+// timers far enough out to start in the coarser wheels and be cascaded down,
+// random ones against the tick they asked for, and timers scheduled, for now
+// or later, from inside a callback.
+// Exits with 1 on the first timer that fires late, early, twice or never.
+// Build with the game's include paths and: g++ -std=c++17 -O2 -Iinclude tests/timer_wheel_test.cpp
+//     src/timer_wheel.cpp -o timer_wheel_test
+#include "../include/timer_wheel.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const unsigned int       CAPACITY = 4096;
+const unsigned int       RANDOM   = 3000;
+const unsigned long long HORIZON  = 1ull << (TIMER_WHEEL_BITS * 3 + 2); // well into the last wheel
+
+struct Fired {
+    TimerWheel                     *Wheel;
+    std::vector<unsigned long long> Expected;
+    std::vector<unsigned long long> Actual;
+    std::vector<unsigned int>       Order; // data in firing order
+};
+
+static void record(void *context, unsigned int data) {
+    Fired &fired = *static_cast<Fired *>(context);
+    fired.Actual[data] = fired.Wheel->Tick();
+    fired.Order.push_back(data);
+}
+
+static unsigned int expect(Fired &fired, unsigned long long tick) {
+    fired.Expected.push_back(tick);
+    fired.Actual.push_back(0);
+    return static_cast<unsigned int>(fired.Expected.size() - 1);
+}
+
+// one tick at a time, TIMER_TICK is a power of two so the clock stays exact
+static void run(TimerWheel &wheel, unsigned long long until) {
+    while (wheel.Tick() <= until)
+        wheel.Advance(TIMER_TICK);
+}
+
+static bool check(const Fired &fired, const char *what) {
+    if (fired.Order.size() != fired.Expected.size()) {
+        std::printf("FAILED: %s: %zu timers fired, expected %zu\n", what, fired.Order.size(), fired.Expected.size());
+        return false;
+    }
+    for (unsigned int timer = 0; timer < fired.Expected.size(); ++timer) {
+        if (fired.Actual[timer] != fired.Expected[timer]) {
+            std::printf("FAILED: %s: timer %u fired at tick %llu, expected %llu\n", what, timer, fired.Actual[timer], fired.Expected[timer]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// the ticks around every wheel boundary, from a clock that is not at zero
+static bool cascade() {
+    TimerWheel wheel(CAPACITY);
+    wheel.Reset(5 * TIMER_TICK, 5);
+    Fired fired;
+    fired.Wheel = &wheel;
+    for (unsigned int level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+        unsigned long long span = 1ull << (TIMER_WHEEL_BITS * (level + 1));
+        if (span > HORIZON)
+            break;
+        for (long long offset = -2; offset <= 2; ++offset) {
+            unsigned long long tick = wheel.Tick() + span + offset;
+            wheel.ScheduleAt(tick, record, &fired, expect(fired, tick));
+        }
+    }
+    run(wheel, HORIZON);
+    return check(fired, "cascade");
+}
+
+// random deadlines, including the current tick and several timers on one tick
+static bool deadlines() {
+    TimerWheel wheel(CAPACITY);
+    Fired fired;
+    fired.Wheel = &wheel;
+    for (unsigned int timer = 0; timer < RANDOM; ++timer) {
+        unsigned long long tick = std::rand() % 2 ? std::rand() % 200 : (unsigned long long)std::rand() % HORIZON;
+        wheel.ScheduleAt(tick, record, &fired, expect(fired, tick));
+    }
+    run(wheel, HORIZON);
+    if (!check(fired, "deadlines"))
+        return false;
+    for (unsigned int i = 1; i < fired.Order.size(); ++i) {
+        unsigned int a = fired.Order[i - 1], b = fired.Order[i];
+        if (fired.Expected[a] == fired.Expected[b] && a > b) {
+            std::printf("FAILED: deadlines: timers %u and %u are due on tick %llu and fired out of order\n", a, b, fired.Expected[a]);
+            return false;
+        }
+    }
+    if (wheel.ActiveCount() != 0) {
+        std::printf("FAILED: deadlines: %u timers still active\n", wheel.ActiveCount());
+        return false;
+    }
+    return true;
+}
+
+struct Chain {
+    Fired        Timers;
+    unsigned int Links; // reschedules left
+    unsigned int Delay; // in ticks
+};
+
+// schedules the next link from inside the callback
+static void relink(void *context, unsigned int data) {
+    Chain &chain = *static_cast<Chain *>(context);
+    record(&chain.Timers, data);
+    if (chain.Links == 0)
+        return;
+    --chain.Links;
+    unsigned long long tick = chain.Timers.Wheel->Tick() + chain.Delay;
+    chain.Timers.Wheel->ScheduleAt(tick, relink, &chain, expect(chain.Timers, tick));
+}
+
+// Schedule with no delay from a callback, it should fire on the same tick
+static void immediate(void *context, unsigned int data) {
+    Chain &chain = *static_cast<Chain *>(context);
+    record(&chain.Timers, data);
+    if (data == 0)
+        chain.Timers.Wheel->Schedule(0.0f, immediate, &chain, expect(chain.Timers, chain.Timers.Wheel->Tick()));
+}
+
+static bool reschedule() {
+    for (unsigned int delay = 0; delay < 3; ++delay) {
+        TimerWheel wheel(CAPACITY);
+        Chain chain;
+        chain.Timers.Wheel = &wheel;
+        chain.Links = 10;
+        chain.Delay = delay;
+        wheel.ScheduleAt(5, relink, &chain, expect(chain.Timers, 5));
+        run(wheel, 5 + 10 * delay + 2 * TIMER_WHEEL_SLOTS);
+        char what[32];
+        std::snprintf(what, sizeof(what), "reschedule by %u", delay);
+        if (!check(chain.Timers, what))
+            return false;
+    }
+
+    TimerWheel wheel(CAPACITY);
+    Chain chain;
+    chain.Timers.Wheel = &wheel;
+    run(wheel, 2);
+    wheel.Schedule(0.0f, immediate, &chain, expect(chain.Timers, wheel.Tick()));
+    run(wheel, 2 * TIMER_WHEEL_SLOTS);
+    return check(chain.Timers, "schedule now from a callback");
+}
+
+int main() {
+    std::srand(32);
+    if (!cascade() || !deadlines() || !reschedule())
+        return 1;
+    std::printf("all timers fired on their tick\n");
+    return 0;
+}
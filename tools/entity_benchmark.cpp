@@ -0,0 +1,304 @@
+// Compares the brick loops of the game over its component tables, see
+// include/ecs.h, with the same loops over the GameObjects the bricks used to
+// be: a virtual class holding its position, size, velocity, color, flags and
+// a whole Texture2D. Every loop runs over the same bricks, half of them
+// destroyed at random, and reports its time per pass and, where Linux lets
+// a process count them, the cache misses per brick. The collision loop tests
+// a few balls against every brick, with CheckCollision as DoCollisions called
+// it on each GameObject and with the kernel over the tables' packed bounds.
+//
+//   entity_benchmark [bricks] [passes]
+//
+// Build with the game's include paths and: g++ -std=c++17 -O2 -Iinclude tools/entity_benchmark.cpp
+//     src/collision.cpp -o entity_benchmark
+#include "../include/ecs.h"
+#include "../include/collision.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const unsigned int DEFAULT_BRICKS = 1 << 20;
+const unsigned int DEFAULT_PASSES = 50;
+const float        STEP = 1.0f / 60.0f;
+const unsigned int BALLS = 8;       // per pass of the collision loop
+const float        BALL_RADIUS = 12.5f;
+const unsigned int MAX_HITS = 64;   // CollideCircleBoxes' buffer, it resumes past a full one
+
+// the fields of Texture2D before the tables, it was held by value
+struct LegacyTexture {
+    unsigned int ID;
+    unsigned int Width, Height;
+    unsigned int Internal_Format;
+    unsigned int Image_Format;
+    unsigned int Wrap_S;
+    unsigned int Wrap_T;
+    unsigned int Filter_Min;
+    unsigned int Filter_Max;
+};
+
+// GameObject as the bricks were stored before the tables
+class LegacyGameObject
+{
+public:
+    glm::vec2     Position, Size, Velocity;
+    glm::vec3     Color;
+    float         Rotation;
+    bool          IsSolid;
+    bool          Destroyed;
+
+    LegacyTexture Sprite;
+
+    virtual ~LegacyGameObject() = default;
+};
+
+// the direction and collision test DoCollisions ran on each GameObject
+static Direction VectorDirection(glm::vec2 target) {
+    glm::vec2 compass[] = {
+        glm::vec2(0.0f, 1.0f),	// up
+        glm::vec2(1.0f, 0.0f),	// right
+        glm::vec2(0.0f, -1.0f),	// down
+        glm::vec2(-1.0f, 0.0f)	// left
+    };
+    float max = 0.0f;
+    unsigned int best_match = -1;
+    for (unsigned int i = 0; i < 4; ++i) {
+        float dot_product = glm::dot(glm::normalize(target), compass[i]);
+        if (dot_product > max) {
+            max = dot_product;
+            best_match = i;
+        }
+    }
+
+    return (Direction)best_match;
+}
+
+static Collision CheckCollision(glm::vec2 center, float radius, const LegacyGameObject &two) {
+    glm::vec2 aabb_half_extents(two.Size.x / 2.0f, two.Size.y / 2.0f);
+    glm::vec2 aabb_center(
+            two.Position.x + aabb_half_extents.x,
+            two.Position.y + aabb_half_extents.y
+    );
+    glm::vec2 difference = center - aabb_center;
+    glm::vec2 clamped = glm::clamp(difference, -aabb_half_extents, aabb_half_extents);
+    glm::vec2 closest = aabb_center + clamped;
+    difference = closest - center;
+
+    if (glm::length(difference) <= radius)
+        return std::make_tuple(true, VectorDirection(difference), difference);
+    else
+        return std::make_tuple(false, UP, glm::vec2(0.0f, 0.0f));
+}
+
+// keeps the loops from being optimized away
+static volatile float sink;
+
+// a hardware cache miss counter for this thread, -1 where there is none
+class MissCounter
+{
+public:
+    MissCounter() : fd(-1) {
+#ifdef __linux__
+        perf_event_attr attributes = {};
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof(attributes);
+        attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        this->fd = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+#endif
+    }
+    ~MissCounter() {
+#ifdef __linux__
+        if (this->fd >= 0)
+            close(this->fd);
+#endif
+    }
+    bool Available() const { return this->fd >= 0; }
+    void Start() {
+#ifdef __linux__
+        if (this->fd >= 0) {
+            ioctl(this->fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(this->fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    long long Stop() {
+        long long count = -1;
+#ifdef __linux__
+        if (this->fd >= 0) {
+            ioctl(this->fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(this->fd, &count, sizeof(count)) != sizeof(count))
+                count = -1;
+        }
+#endif
+        return count;
+    }
+private:
+    int fd;
+};
+
+struct Result {
+    double    Milliseconds; // per pass
+    long long Misses;       // over every pass, -1 if not counted
+};
+
+template <typename Loop>
+static Result measure(MissCounter &counter, unsigned int passes, Loop loop) {
+    loop(); // warm up
+    counter.Start();
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int pass = 0; pass < passes; ++pass)
+        loop();
+    auto end = std::chrono::steady_clock::now();
+    Result result;
+    result.Misses = counter.Stop();
+    result.Milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / passes;
+    return result;
+}
+
+static void report(const char *loop, Result objects, Result tables, unsigned int bricks, unsigned int passes) {
+    std::printf("%-16s %10.3f %10.3f %8.2fx", loop, objects.Milliseconds, tables.Milliseconds, objects.Milliseconds / tables.Milliseconds);
+    if (objects.Misses >= 0 && tables.Misses >= 0)
+        std::printf(" %12.3f %12.3f", (double)objects.Misses / passes / bricks, (double)tables.Misses / passes / bricks);
+    std::printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int bricks = argc > 1 ? (unsigned int)std::atoi(argv[1]) : DEFAULT_BRICKS;
+    unsigned int passes = argc > 2 ? (unsigned int)std::atoi(argv[2]) : DEFAULT_PASSES;
+    if (bricks == 0 || passes == 0) {
+        std::printf("usage: entity_benchmark [bricks] [passes]\n");
+        return 1;
+    }
+
+    // the same bricks both ways
+    std::srand(33);
+    std::vector<LegacyGameObject> objects(bricks);
+    BrickTable table;
+    std::vector<Motion> motions(bricks);
+    table.Transforms.resize(bricks);
+    table.Sprites.resize(bricks);
+    table.States.resize(bricks);
+    for (unsigned int i = 0; i < bricks; ++i) {
+        glm::vec2 position((float)(i % 1024) * 16.0f, (float)(i / 1024) * 8.0f);
+        glm::vec2 velocity((float)(std::rand() % 9) - 4.0f, (float)(std::rand() % 9) - 4.0f);
+        bool solid = std::rand() % 8 == 0, destroyed = std::rand() % 2 == 0;
+        LegacyGameObject &object = objects[i];
+        object.Position = position;
+        object.Size = glm::vec2(16.0f, 8.0f);
+        object.Velocity = velocity;
+        object.Color = glm::vec3(1.0f);
+        object.Rotation = 0.0f;
+        object.IsSolid = solid;
+        object.Destroyed = destroyed;
+        object.Sprite = LegacyTexture();
+        table.Transforms[i] = { position, glm::vec2(16.0f, 8.0f), 0.0f };
+        table.Sprites[i] = { nullptr, glm::vec3(1.0f) };
+        table.States[i] = { solid, destroyed };
+        motions[i].Velocity = velocity;
+    }
+
+    MissCounter counter;
+    std::printf("%u bricks, %u passes, GameObject %zu bytes, BrickState %zu bytes, Transform %zu bytes\n",
+                bricks, passes, sizeof(LegacyGameObject), sizeof(BrickState), sizeof(Transform));
+    std::printf("%-16s %10s %10s %9s", "loop", "objects ms", "tables ms", "speedup");
+    if (counter.Available())
+        std::printf(" %12s %12s", "object miss", "table miss");
+    std::printf("\n");
+
+    // GameLevel::BricksLeft, what IsCompleted reads
+    Result objectLeft = measure(counter, passes, [&]() {
+        unsigned int left = 0;
+        for (const LegacyGameObject &object : objects)
+            left += !object.IsSolid && !object.Destroyed;
+        sink = (float)left;
+    });
+    Result tableLeft = measure(counter, passes, [&]() {
+        unsigned int left = 0;
+        for (const BrickState &brick : table.States)
+            left += !brick.Solid && !brick.Destroyed;
+        sink = (float)left;
+    });
+    report("bricks left", objectLeft, tableLeft, bricks, passes);
+
+    // the rectangles of the bricks still standing, what drawing the level reads
+    Result objectLive = measure(counter, passes, [&]() {
+        glm::vec2 sum(0.0f);
+        for (const LegacyGameObject &object : objects)
+            if (!object.Destroyed)
+                sum += object.Position + object.Size;
+        sink = sum.x + sum.y;
+    });
+    Result tableLive = measure(counter, passes, [&]() {
+        glm::vec2 sum(0.0f);
+        for (unsigned int i = 0; i < table.Size(); ++i)
+            if (!table.States[i].Destroyed)
+                sum += table.Transforms[i].Position + table.Transforms[i].Size;
+        sink = sum.x + sum.y;
+    });
+    report("live rectangles", objectLive, tableLive, bricks, passes);
+
+    // the balls against every brick, DoCollisions before the sweep
+    std::vector<glm::vec2> balls(BALLS);
+    for (glm::vec2 &ball : balls)
+        ball = glm::vec2((float)(std::rand() % (1024 * 16)), (float)(std::rand() % (bricks / 1024 * 8 + 8)));
+    for (unsigned int i = 0; i < bricks; ++i) {
+        table.Bounds.Add(table.Transforms[i].Position, table.Transforms[i].Size);
+        if (table.States[i].Destroyed)
+            table.Bounds.Disable(i);
+    }
+    unsigned int objectHits = 0, tableHits = 0;
+    Result objectCollide = measure(counter, passes, [&]() {
+        objectHits = 0;
+        for (glm::vec2 ball : balls)
+            for (const LegacyGameObject &object : objects)
+                if (!object.Destroyed)
+                    objectHits += std::get<0>(CheckCollision(ball, BALL_RADIUS, object));
+        sink = (float)objectHits;
+    });
+    Result tableCollide = measure(counter, passes, [&]() {
+        unsigned int hits[MAX_HITS];
+        tableHits = 0;
+        for (glm::vec2 ball : balls) {
+            unsigned int count = 0, first = 0;
+            do {
+                count = CollideCircleBoxes(table.Bounds, ball, BALL_RADIUS, hits, MAX_HITS, first);
+                tableHits += count;
+                if (count > 0)
+                    first = hits[count - 1] + 1;
+            } while (count == MAX_HITS);
+        }
+        sink = (float)tableHits;
+    });
+    report("collide", objectCollide, tableCollide, bricks, passes);
+    if (objectHits != tableHits)
+        std::printf("the collision loops disagree: %u hits on GameObjects, %u in the tables\n", objectHits, tableHits);
+
+    // MoveBodies
+    Result objectMove = measure(counter, passes, [&]() {
+        for (LegacyGameObject &object : objects)
+            object.Position += object.Velocity * STEP;
+        sink = objects[0].Position.x;
+    });
+    Result tableMove = measure(counter, passes, [&]() {
+        for (unsigned int i = 0; i < table.Transforms.size(); ++i)
+            table.Transforms[i].Position += motions[i].Velocity * STEP;
+        sink = table.Transforms[0].Position.x;
+    });
+    report("move", objectMove, tableMove, bricks, passes);
+
+    if (!counter.Available())
+        std::printf("no cache miss counter here, see /proc/sys/kernel/perf_event_paranoid\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Builds the asset pack the game maps at startup, see include/asset_pack.h.
+//
+//   pack_assets <output> <project root> [directory...]
+//
+// Every file below the given directories of the project root, shaders and
+// resources by default, goes in under its path relative to the root.
+// Build with: g++ -std=c++17 -Iinclude tools/pack_assets.cpp src/asset_pack.cpp src/log.cpp -pthread -o pack_assets
+#include "../include/asset_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct PackedFile {
+    std::string                Name;
+    std::vector<unsigned char> Contents;
+};
+
+static unsigned long long alignUp(unsigned long long offset) {
+    return (offset + ASSET_ALIGNMENT - 1) & ~(unsigned long long)(ASSET_ALIGNMENT - 1);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cout << "usage: pack_assets <output> <project root> [directory...]" << std::endl;
+        return 1;
+    }
+    fs::path root = argv[2];
+    std::vector<std::string> directories;
+    for (int i = 3; i < argc; ++i)
+        directories.push_back(argv[i]);
+    if (directories.empty())
+        directories = { "shaders", "resources" };
+
+    std::vector<PackedFile> files;
+    for (const std::string &directory : directories) {
+        std::error_code error;
+        for (fs::recursive_directory_iterator it(root / directory, error), end; !error && it != end; it.increment(error)) {
+            if (!it->is_regular_file())
+                continue;
+            PackedFile file;
+            file.Name = it->path().lexically_relative(root).generic_string();
+            if (file.Name.size() >= ASSET_NAME_SIZE) {
+                std::cout << "ERROR: name longer than " << ASSET_NAME_SIZE - 1 << " characters: " << file.Name << std::endl;
+                return 1;
+            }
+            std::ifstream stream(it->path(), std::ios::binary);
+            file.Contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+            files.push_back(std::move(file));
+        }
+        if (error) {
+            std::cout << "ERROR: cannot read " << (root / directory).string() << ": " << error.message() << std::endl;
+            return 1;
+        }
+    }
+    // the game binary searches the index, the names have to be in strncmp order
+    std::sort(files.begin(), files.end(), [](const PackedFile &a, const PackedFile &b) {
+        return std::strcmp(a.Name.c_str(), b.Name.c_str()) < 0;
+    });
+
+    AssetPackHeader header = {};
+    std::memcpy(header.Magic, ASSET_PACK_MAGIC, sizeof(header.Magic));
+    header.Version = ASSET_PACK_VERSION;
+    header.Count = files.size();
+    std::vector<AssetEntry> index(files.size());
+    unsigned long long offset = alignUp(sizeof(AssetPackHeader) + files.size() * sizeof(AssetEntry));
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::memset(&index[i], 0, sizeof(AssetEntry));
+        std::memcpy(index[i].Name, files[i].Name.c_str(), files[i].Name.size());
+        index[i].Offset = offset;
+        index[i].Size = files[i].Contents.size();
+        index[i].Hash = HashAsset(files[i].Contents.data(), files[i].Contents.size());
+        offset = alignUp(offset + files[i].Contents.size() + 1);
+    }
+
+    std::ofstream output(argv[1], std::ios::binary);
+    output.write((const char*)&header, sizeof(header));
+    output.write((const char*)index.data(), index.size() * sizeof(AssetEntry));
+    unsigned long long written = sizeof(header) + index.size() * sizeof(AssetEntry);
+    const char padding[ASSET_ALIGNMENT] = {};
+    for (size_t i = 0; i < files.size(); ++i) {
+        output.write(padding, index[i].Offset - written);
+        output.write((const char*)files[i].Contents.data(), files[i].Contents.size());
+        // the 0 byte after every asset
+        output.write(padding, 1);
+        written = index[i].Offset + files[i].Contents.size() + 1;
+    }
+    output.write(padding, offset - written);
+    if (!output) {
+        std::cout << "ERROR: failed to write " << argv[1] << std::endl;
+        return 1;
+    }
+    std::cout << files.size() << " assets, " << offset << " bytes written to " << argv[1] << std::endl;
+    return 0;
+}
@@ -0,0 +1,128 @@
+// Follows the state the game publishes with --stream-shm or --stream-socket,
+// see include/state_stream.h, rebuilds it tick by tick and prints what
+// happened: bricks destroyed, power-ups, effects, balls and the paddle.
+//
+//   stream_viewer shm <name> [seconds]
+//   stream_viewer socket <path> [seconds]
+//
+// Every rebuilt state is checked against the checksum the game sent with it.
+// The game keeps no score, bricks destroyed are counted instead. Exits with 1
+// if a state that matched its checksum did not decode.
+// Build with the game's include paths and: g++ -std=c++17 -Iinclude tools/stream_viewer.cpp
+//     src/state_stream_reader.cpp src/state_codec.cpp -o stream_viewer
+#include "../include/state_stream.h"
+#include "../include/state_codec.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+static const char *POWERUP_NAMES[] = { "speed", "sticky", "pass-through", "grow", "confuse", "chaos", "multiball" };
+static_assert(sizeof(POWERUP_NAMES) / sizeof(POWERUP_NAMES[0]) == POWERUP_TYPE_COUNT, "a name per power-up type");
+
+// what Decode may fill, the viewer knows nothing of the levels
+static void reserve(GameSnapshot &snapshot) {
+    snapshot.Balls.Transforms.reserve(MAX_BALLS);
+    snapshot.Balls.Motions.reserve(MAX_BALLS);
+    snapshot.Balls.Sprites.reserve(MAX_BALLS);
+    snapshot.Balls.States.reserve(MAX_BALLS);
+    snapshot.PowerUps.Transforms.reserve(MAX_POWERUPS);
+    snapshot.PowerUps.Motions.reserve(MAX_POWERUPS);
+    snapshot.PowerUps.Sprites.reserve(MAX_POWERUPS);
+    snapshot.PowerUps.Types.reserve(MAX_POWERUPS);
+    snapshot.Timers.reserve(MAX_TIMERS);
+    snapshot.Destroyed.reserve(STREAM_MAX_BRICKS);
+}
+
+static unsigned int countDestroyed(const GameSnapshot &snapshot) {
+    unsigned int destroyed = 0;
+    for (unsigned char brick : snapshot.Destroyed)
+        destroyed += brick;
+    return destroyed;
+}
+
+// prints what changed from one tick to the next
+static void report(unsigned long long tick, const GameSnapshot &last, const GameSnapshot &now) {
+    if (now.Level != last.Level)
+        std::cout << tick << ": level " << now.Level + 1 << std::endl;
+    unsigned int destroyed = 0, restored = 0;
+    for (size_t i = 0; i < now.Destroyed.size() && i < last.Destroyed.size(); ++i) {
+        destroyed += now.Destroyed[i] && !last.Destroyed[i];
+        restored += !now.Destroyed[i] && last.Destroyed[i];
+    }
+    if (destroyed > 0)
+        std::cout << tick << ": " << destroyed << (destroyed == 1 ? " brick" : " bricks") << " destroyed" << std::endl;
+    if (restored > 0)
+        std::cout << tick << ": level reset, " << restored << " bricks back" << std::endl;
+    unsigned int lastTypes[POWERUP_TYPE_COUNT] = {}, nowTypes[POWERUP_TYPE_COUNT] = {};
+    for (PowerUpType type : last.PowerUps.Types)
+        ++lastTypes[type];
+    for (PowerUpType type : now.PowerUps.Types)
+        ++nowTypes[type];
+    for (unsigned int type = 0; type < POWERUP_TYPE_COUNT; ++type) {
+        if (nowTypes[type] > lastTypes[type])
+            std::cout << tick << ": " << POWERUP_NAMES[type] << " power-up dropped" << std::endl;
+        else if (nowTypes[type] < lastTypes[type])
+            std::cout << tick << ": " << POWERUP_NAMES[type] << " power-up caught or lost" << std::endl;
+        if ((now.ActiveEffects[type] > 0) != (last.ActiveEffects[type] > 0))
+            std::cout << tick << ": " << POWERUP_NAMES[type] << (now.ActiveEffects[type] > 0 ? " on" : " off") << std::endl;
+    }
+    if (now.Balls.Size() != last.Balls.Size())
+        std::cout << tick << ": " << now.Balls.Size() << (now.Balls.Size() == 1 ? " ball" : " balls") << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3 || (std::strcmp(argv[1], "shm") != 0 && std::strcmp(argv[1], "socket") != 0)) {
+        std::cout << "usage: stream_viewer shm <name> | socket <path> [seconds]" << std::endl;
+        return 1;
+    }
+    bool shared = std::strcmp(argv[1], "shm") == 0;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(), summary = start;
+    auto elapsed = [&start] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+    StateStreamReader reader;
+    // the game may not be up yet
+    bool open = shared ? reader.OpenSharedMemory(argv[2]) : reader.OpenSocket(argv[2]);
+    while (!open && shared && (seconds <= 0.0 || elapsed() < seconds)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        open = reader.OpenSharedMemory(argv[2]);
+    }
+    if (!open) {
+        std::cout << "ERROR: cannot open " << argv[2] << std::endl;
+        return 1;
+    }
+
+    GameSnapshot last, now;
+    reserve(last);
+    reserve(now);
+    bool synced = false;
+    unsigned long long undecoded = 0;
+    while (seconds <= 0.0 || elapsed() < seconds) {
+        const unsigned char *state;
+        unsigned int size;
+        while (reader.Read(state, size)) {
+            if (!StateCodec::Decode(state, size, now)) {
+                ++undecoded;
+                continue;
+            }
+            if (synced)
+                report(reader.Tick, last, now);
+            else
+                std::cout << reader.Tick << ": following, level " << now.Level + 1 << ", " << countDestroyed(now) << " bricks destroyed" << std::endl;
+            std::swap(last, now);
+            synced = true;
+        }
+        if (synced && std::chrono::steady_clock::now() - summary >= std::chrono::seconds(1)) {
+            summary = std::chrono::steady_clock::now();
+            std::cout << reader.Tick << ": paddle at " << last.Paddle.Position.x << ", " << last.Balls.Size() << " balls, "
+                << last.PowerUps.Size() << " power-ups falling, " << countDestroyed(last) << " bricks destroyed" << std::endl;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::cout << reader.Verified << " states verified, " << reader.Missed << " missed, " << undecoded << " did not decode" << std::endl;
+    return undecoded > 0 ? 1 : 0;
+}